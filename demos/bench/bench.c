@@ -0,0 +1,254 @@
+/*
+ *  GXemul demo:  Micro-benchmarks
+ *
+ *  This file is in the Public Domain.
+ *
+ *  Small bare-metal loops, each exercising one part of an emulated CPU:
+ *
+ *	alu		integer arithmetic and logic
+ *	loadstore	loads and stores to a small array in RAM
+ *	branch		data-dependent conditional branches
+ *	pages		accesses spread out over many pages, to stress the
+ *			emulator's virtual-to-host address translation
+ *	mmio		reads from a device register
+ *	devices		loads and stores alternating between two devices
+ *	codedata	loads and stores to a small array on the same page as
+ *			the code (only on MIPS, see below)
+ *
+ *  The kernel to run is selected at compile time, by defining BENCH_KERNEL
+ *  to the name of one of the bench_* functions below. When the loop is
+ *  done, a checksum is printed (so that it is possible to verify that the
+ *  emulation is still correct, and not only fast) and the machine is
+ *  halted. test/bench.sh runs the resulting binaries.
+ *
+ *  When compiled for the host with -DBENCH_HOST, all kernels are run
+ *  natively instead, and their checksums are printed. This is how the
+ *  reference checksums in test/bench.reference are generated.
+ *
+ *  (The MIPS kernels are in bench_mips.s instead, so that the pages kernel
+ *  can take TLB misses, and so that the codedata kernel can place its array
+ *  next to its code.)
+ */
+
+#ifdef BENCH_HOST
+#include <stdio.h>
+#else
+#include "dev_cons.h"
+#include "dev_disk.h"
+#include "dev_mp.h"
+#endif
+
+
+#ifdef ALPHA
+/*  The direct-mapped kernel segment, KSEG0:  */
+#define	PHYSADDR_OFFSET		((long)0xfffffc0000000000UL)
+#else
+#define	PHYSADDR_OFFSET		0
+#endif
+
+
+#ifdef BENCH_HOST
+/*  There is no emulated machine; cpu 0 is the only cpu:  */
+static volatile unsigned int host_whoami = 0;
+#define	WHOAMI			host_whoami
+static volatile unsigned int host_disk_id = 0;
+#define	DISK_ID			host_disk_id
+#else
+#define	PUTCHAR_ADDRESS		(PHYSADDR_OFFSET +		\
+				DEV_CONS_ADDRESS + DEV_CONS_PUTGETCHAR)
+#define	HALT_ADDRESS		(PHYSADDR_OFFSET +		\
+				DEV_CONS_ADDRESS + DEV_CONS_HALT)
+#define	WHOAMI_ADDRESS		(PHYSADDR_OFFSET +		\
+				DEV_MP_ADDRESS + DEV_MP_WHOAMI)
+#define	WHOAMI			(*((volatile unsigned int *) WHOAMI_ADDRESS))
+#define	DISK_ID_ADDRESS		(PHYSADDR_OFFSET +		\
+				DEV_DISK_ADDRESS + DEV_DISK_ID)
+#define	DISK_ID			(*((volatile unsigned int *) DISK_ID_ADDRESS))
+#endif
+
+
+#ifndef BENCH_KERNEL
+#define	BENCH_KERNEL		bench_alu
+#endif
+
+/*  Number of iterations of the outer loop of each kernel:  */
+#ifndef BENCH_N
+#define	BENCH_N			4000000
+#endif
+
+#define	SMALL_ARRAY_WORDS	1024
+#define	PAGE_SIZE		4096
+#define	N_PAGES			1024
+#define	CODE_DATA_WORDS		16
+
+static volatile unsigned int small_array[SMALL_ARRAY_WORDS];
+static volatile unsigned int code_data[CODE_DATA_WORDS];
+static volatile unsigned char pages[N_PAGES * PAGE_SIZE];
+
+
+#ifndef BENCH_HOST
+void printchar(char ch)
+{
+	*((volatile unsigned char *) PUTCHAR_ADDRESS) = ch;
+}
+
+
+void halt(void)
+{
+	*((volatile unsigned char *) HALT_ADDRESS) = 0;
+}
+
+
+void printstr(char *s)
+{
+	while (*s)
+		printchar(*s++);
+}
+
+
+void printhex(unsigned int x)
+{
+	int i;
+
+	for (i=28; i>=0; i-=4)
+		printchar("0123456789abcdef"[(x >> i) & 15]);
+}
+#endif
+
+
+unsigned int bench_alu(void)
+{
+	unsigned int a = 0x12345678, b = 0x9abcdef0;
+	int i;
+
+	for (i=0; i<BENCH_N; i++) {
+		a = (a ^ (a << 7)) + b;
+		b = (b ^ (b >> 3)) - (a | 0x55);
+		a = a * 33 + (b & 0xff);
+	}
+
+	return a ^ b;
+}
+
+
+unsigned int bench_loadstore(void)
+{
+	unsigned int sum = 0;
+	int i, j;
+
+	for (i=0; i<SMALL_ARRAY_WORDS; i++)
+		small_array[i] = i;
+
+	for (i=0; i<BENCH_N / 16; i++)
+		for (j=0; j<16; j++) {
+			unsigned int k = (i * 16 + j) & (SMALL_ARRAY_WORDS-1);
+			small_array[k] += sum;
+			sum += small_array[(k + 512) & (SMALL_ARRAY_WORDS-1)];
+		}
+
+	return sum;
+}
+
+
+unsigned int bench_branch(void)
+{
+	unsigned int lfsr = 0xace1, taken = 0, not_taken = 0;
+	int i;
+
+	for (i=0; i<BENCH_N; i++) {
+		lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xb400);
+		if (lfsr & 1)
+			taken ++;
+		else
+			not_taken += 3;
+		if (lfsr & 0x100)
+			taken ^= not_taken;
+	}
+
+	return taken + not_taken;
+}
+
+
+unsigned int bench_pages(void)
+{
+	unsigned int sum = 0;
+	int i, p;
+
+	for (i=0; i<BENCH_N / N_PAGES; i++)
+		for (p=0; p<N_PAGES; p++) {
+			/*  A different page, and cache line, every time:  */
+			int ofs = ((p * 97) & (N_PAGES-1)) * PAGE_SIZE
+			    + ((i * 64) & (PAGE_SIZE-1));
+			pages[ofs] += p;
+			sum += pages[ofs];
+		}
+
+	return sum;
+}
+
+
+unsigned int bench_mmio(void)
+{
+	unsigned int sum = 0;
+	int i;
+
+	for (i=0; i<BENCH_N / 4; i++)
+		sum += WHOAMI + i;
+
+	return sum;
+}
+
+
+unsigned int bench_devices(void)
+{
+	unsigned int sum = 0;
+	int i;
+
+	for (i=0; i<BENCH_N / 4; i++) {
+		DISK_ID = i * 3;
+		sum += WHOAMI + DISK_ID;
+	}
+
+	return sum;
+}
+
+
+unsigned int bench_codedata(void)
+{
+	unsigned int sum = 0;
+	int i;
+
+	for (i=0; i<BENCH_N / 4; i++) {
+		unsigned int k = i & (CODE_DATA_WORDS-1);
+		code_data[k] += i;
+		sum += code_data[k ^ 1];
+	}
+
+	return sum;
+}
+
+
+#ifdef BENCH_HOST
+int main(int argc, char *argv[])
+{
+	printf("alu %08x\n", bench_alu());
+	printf("loadstore %08x\n", bench_loadstore());
+	printf("branch %08x\n", bench_branch());
+	printf("pages %08x\n", bench_pages());
+	printf("mmio %08x\n", bench_mmio());
+	printf("devices %08x\n", bench_devices());
+	printf("codedata %08x\n", bench_codedata());
+
+	return 0;
+}
+#else
+void f(void)
+{
+	unsigned int checksum = BENCH_KERNEL();
+
+	printstr("checksum=");
+	printhex(checksum);
+	printstr("\n");
+	halt();
+}
+#endif
@@ -0,0 +1,330 @@
+#
+#  GXemul demo:  Micro-benchmarks, MIPS version
+#
+#  This file is in the Public Domain.
+#
+#  The same kernels as in bench.c, written in assembly language. The pages
+#  kernel here accesses its array via kuseg, i.e. through the TLB, and the
+#  array is much larger than what the TLB can map at once. Almost every
+#  access therefore takes a TLB refill exception. The codedata kernel's
+#  array is in the text section, on the same page as the code.
+#
+#  Each kernel has its own entry point, start_KERNEL, which is selected
+#  when linking (see README). The number of iterations can be changed by
+#  assembling with --defsym BENCH_N=...
+#
+#  Plain 32-bit MIPS code, for the testmips machine (big-endian).
+#
+
+	.set	noreorder
+	.set	noat
+
+	.ifndef	BENCH_N
+	.equ	BENCH_N, 4000000
+	.endif
+
+	.equ	CONS_ADDRESS, 0xb0000000	# DEV_CONS_ADDRESS in kseg1
+	.equ	CONS_HALT, 0x10
+	.equ	WHOAMI_ADDRESS, 0xb1000000	# DEV_MP_ADDRESS in kseg1
+	.equ	DISK_ID_ADDRESS, 0xb3000010	# DEV_DISK_ID in kseg1
+
+	.equ	SMALL_ARRAY_WORDS, 1024
+	.equ	PAGE_SIZE, 4096
+	.equ	N_PAGES, 1024
+	.equ	CODE_DATA_WORDS, 16
+
+	#  The pages array is at this kuseg address, and the TLB refill
+	#  handler maps it 1:1 to the same physical address:
+	.equ	PAGES_VADDR, 0x00400000
+
+	.text
+
+	.macro	entry name
+	.globl	start_\name
+start_\name:
+	jal	bench_\name
+	nop
+	j	print_checksum_and_halt
+	move	$s7, $v0
+	.endm
+
+	entry	alu
+	entry	loadstore
+	entry	branch
+	entry	pages
+	entry	mmio
+	entry	devices
+	entry	codedata
+
+
+#
+#  bench_alu:  Integer arithmetic and logic.
+#
+bench_alu:
+	li	$t0, 0x12345678		# a
+	li	$t1, 0x9abcdef0		# b
+	li	$t2, BENCH_N
+1:	sll	$t3, $t0, 7		# a = (a ^ (a << 7)) + b;
+	xor	$t0, $t0, $t3
+	addu	$t0, $t0, $t1
+	srl	$t3, $t1, 3		# b = (b ^ (b >> 3)) - (a | 0x55);
+	xor	$t1, $t1, $t3
+	ori	$t4, $t0, 0x55
+	subu	$t1, $t1, $t4
+	sll	$t3, $t0, 5		# a = a * 33 + (b & 0xff);
+	addu	$t0, $t3, $t0
+	andi	$t4, $t1, 0xff
+	addu	$t0, $t0, $t4
+	addiu	$t2, $t2, -1
+	bnez	$t2, 1b
+	nop
+	jr	$ra
+	xor	$v0, $t0, $t1
+
+
+#
+#  bench_loadstore:  Loads and stores to a small array in RAM.
+#
+bench_loadstore:
+	la	$s0, small_array
+	move	$t0, $zero
+	li	$t1, SMALL_ARRAY_WORDS
+	move	$t4, $s0
+1:	sw	$t0, 0($t4)		# small_array[i] = i;
+	addiu	$t0, $t0, 1
+	bne	$t0, $t1, 1b
+	addiu	$t4, $t4, 4
+
+	move	$v0, $zero		# sum
+	move	$t0, $zero		# i * 16 + j
+	li	$t2, (BENCH_N / 16) * 16
+2:	andi	$t3, $t0, SMALL_ARRAY_WORDS - 1
+	sll	$t3, $t3, 2
+	addu	$t4, $s0, $t3
+	lw	$t5, 0($t4)		# small_array[k] += sum;
+	addu	$t5, $t5, $v0
+	sw	$t5, 0($t4)
+	addiu	$t3, $t0, 512		# sum += small_array[(k + 512) & ...];
+	andi	$t3, $t3, SMALL_ARRAY_WORDS - 1
+	sll	$t3, $t3, 2
+	addu	$t4, $s0, $t3
+	lw	$t5, 0($t4)
+	addiu	$t0, $t0, 1
+	bne	$t0, $t2, 2b
+	addu	$v0, $v0, $t5
+	jr	$ra
+	nop
+
+
+#
+#  bench_branch:  Data-dependent conditional branches.
+#
+bench_branch:
+	li	$t0, 0xace1		# lfsr
+	move	$t1, $zero		# taken
+	move	$t2, $zero		# not_taken
+	li	$t3, BENCH_N
+1:	andi	$t4, $t0, 1		# lfsr = (lfsr >> 1) ^
+	subu	$t4, $zero, $t4		#     (-(lfsr & 1) & 0xb400);
+	andi	$t4, $t4, 0xb400
+	srl	$t0, $t0, 1
+	xor	$t0, $t0, $t4
+	andi	$t4, $t0, 1
+	beqz	$t4, 2f
+	nop
+	b	3f
+	addiu	$t1, $t1, 1		# taken ++;
+2:	addiu	$t2, $t2, 3		# not_taken += 3;
+3:	andi	$t4, $t0, 0x100
+	beqz	$t4, 4f
+	nop
+	xor	$t1, $t1, $t2		# taken ^= not_taken;
+4:	addiu	$t3, $t3, -1
+	bnez	$t3, 1b
+	nop
+	jr	$ra
+	addu	$v0, $t1, $t2
+
+
+#
+#  bench_pages:  Accesses spread out over many pages. Every access is to
+#  a different page than the previous one, and goes through the TLB.
+#
+bench_pages:
+	#  Install the TLB refill handler at the exception vector:
+	li	$t0, 0x80000000
+	la	$t1, tlb_refill
+	la	$t2, tlb_refill_end
+1:	lw	$t3, 0($t1)
+	addiu	$t1, $t1, 4
+	sw	$t3, 0($t0)
+	bne	$t1, $t2, 1b
+	addiu	$t0, $t0, 4
+
+	#  Kernel mode, exception vectors in RAM, ASID 0:
+	mtc0	$zero, $12		# Status
+	mtc0	$zero, $10		# EntryHi
+	nop
+	nop
+
+	li	$s0, PAGES_VADDR
+	move	$v0, $zero		# sum
+	move	$t0, $zero		# i
+	li	$t7, BENCH_N / N_PAGES
+	li	$t6, N_PAGES
+2:	move	$t1, $zero		# p
+	sll	$t2, $t0, 6		# (i * 64) & (PAGE_SIZE-1)
+	andi	$t2, $t2, PAGE_SIZE - 1
+	addu	$t2, $t2, $s0
+3:	sll	$t3, $t1, 5		# (p * 97) & (N_PAGES-1)
+	addu	$t3, $t3, $t1
+	sll	$t4, $t1, 6
+	addu	$t3, $t3, $t4
+	andi	$t3, $t3, N_PAGES - 1
+	sll	$t3, $t3, 12		# * PAGE_SIZE
+	addu	$t3, $t3, $t2
+	lbu	$t5, 0($t3)		# pages[ofs] += p;
+	addu	$t5, $t5, $t1
+	sb	$t5, 0($t3)
+	lbu	$t5, 0($t3)		# sum += pages[ofs];
+	addu	$v0, $v0, $t5
+	addiu	$t1, $t1, 1
+	bne	$t1, $t6, 3b
+	nop
+	addiu	$t0, $t0, 1
+	bne	$t0, $t7, 2b
+	nop
+	jr	$ra
+	nop
+
+	#  Maps the faulting even/odd page pair 1:1 to physical memory.
+	#  (Copied to 0x80000000 by bench_pages.)
+tlb_refill:
+	mfc0	$k0, $8			# BadVAddr
+	srl	$k0, $k0, 13		# the even page of the pair
+	sll	$k0, $k0, 13
+	srl	$k0, $k0, 6		# PFN << 6
+	ori	$k0, $k0, 0x1f		# cached, dirty, valid, global
+	mtc0	$k0, $2			# EntryLo0
+	addiu	$k0, $k0, 0x40		# the odd page
+	mtc0	$k0, $3			# EntryLo1
+	nop
+	tlbwr
+	nop
+	eret
+tlb_refill_end:
+
+
+#
+#  bench_mmio:  Reads from a device register.
+#
+bench_mmio:
+	li	$s0, WHOAMI_ADDRESS
+	move	$v0, $zero		# sum
+	move	$t0, $zero		# i
+	li	$t2, BENCH_N / 4
+1:	lw	$t3, 0($s0)		# sum += whoami + i;
+	addu	$t3, $t3, $t0
+	addiu	$t0, $t0, 1
+	bne	$t0, $t2, 1b
+	addu	$v0, $v0, $t3
+	jr	$ra
+	nop
+
+
+#
+#  bench_devices:  Loads and stores alternating between two devices.
+#
+bench_devices:
+	li	$s0, WHOAMI_ADDRESS
+	li	$s1, DISK_ID_ADDRESS
+	move	$v0, $zero		# sum
+	move	$t0, $zero		# i
+	move	$t1, $zero		# i * 3
+	li	$t2, BENCH_N / 4
+1:	sw	$t1, 0($s1)		# disk_id = i * 3;
+	lw	$t3, 0($s0)		# sum += whoami + disk_id;
+	lw	$t4, 0($s1)
+	addu	$t3, $t3, $t4
+	addiu	$t0, $t0, 1
+	addiu	$t1, $t1, 3
+	bne	$t0, $t2, 1b
+	addu	$v0, $v0, $t3
+	jr	$ra
+	nop
+
+
+#
+#  bench_codedata:  Loads and stores to a small array on the same page as
+#  the code, e.g. variables next to code in a ROM.
+#
+bench_codedata:
+	la	$s0, code_data
+	move	$v0, $zero		# sum
+	move	$t0, $zero		# i
+	li	$t2, BENCH_N / 4
+1:	andi	$t3, $t0, CODE_DATA_WORDS - 1
+	sll	$t3, $t3, 2
+	addu	$t4, $s0, $t3
+	lw	$t5, 0($t4)		# code_data[k] += i;
+	addu	$t5, $t5, $t0
+	sw	$t5, 0($t4)
+	xori	$t3, $t3, 4		# sum += code_data[k ^ 1];
+	addu	$t4, $s0, $t3
+	lw	$t5, 0($t4)
+	addiu	$t0, $t0, 1
+	bne	$t0, $t2, 1b
+	addu	$v0, $v0, $t5
+	jr	$ra
+	nop
+
+
+#
+#  print_checksum_and_halt:  Prints "checksum=XXXXXXXX" for the value in
+#  s7, and halts the machine.
+#
+print_checksum_and_halt:
+	li	$s0, CONS_ADDRESS
+	la	$t0, checksum_str
+1:	lbu	$t1, 0($t0)
+	beqz	$t1, 2f
+	addiu	$t0, $t0, 1
+	b	1b
+	sb	$t1, 0($s0)
+
+2:	la	$t2, hexdigits
+	li	$t0, 28
+3:	srlv	$t1, $s7, $t0
+	andi	$t1, $t1, 15
+	addu	$t1, $t1, $t2
+	lbu	$t1, 0($t1)
+	sb	$t1, 0($s0)
+	bnez	$t0, 3b
+	addiu	$t0, $t0, -4
+
+	li	$t1, 10
+	sb	$t1, 0($s0)
+	sb	$zero, CONS_HALT($s0)
+4:	b	4b
+	nop
+
+	#  On a different part of the page than the loop, so that the writes
+	#  don't also invalidate the loop's translations (see
+	#  INVALIDATE_PADDR_SUBPAGE in src/cpus/cpu_dyntrans.cc):
+	.align	8
+code_data:
+	.space	CODE_DATA_WORDS * 4
+
+
+	.data
+
+checksum_str:
+	.asciz	"checksum="
+hexdigits:
+	.ascii	"0123456789abcdef"
+
+	.bss
+
+	.align	2
+small_array:
+	.space	SMALL_ARRAY_WORDS * 4
@@ -305,6 +305,35 @@ bool MainbusComponent::WriteData(const uint64_t& data, Endianness endianness)
 }
 
 
+uint8_t* MainbusComponent::LookupHostPage(uint64_t address, uint64_t pageSize,
+	bool forWriting)
+{
+	if (!MakeSureMemoryMapExists())
+		return NULL;
+
+	for (size_t i=0; i<m_memoryMap.size(); ++i) {
+		MemoryMapEntry& mmEntry = m_memoryMap[i];
+
+		if (address < mmEntry.base ||
+		    address >= mmEntry.base + mmEntry.size)
+			continue;
+
+		// Only pages that are entirely within one component, and
+		// map 1:1 to the component's addresses, can be accessed
+		// directly.
+		if (mmEntry.addrMul != 1 ||
+		    (mmEntry.base & (pageSize - 1)) != 0 ||
+		    address + pageSize > mmEntry.base + mmEntry.size)
+			return NULL;
+
+		return mmEntry.addressDataBus->LookupHostPage(
+		    address - mmEntry.base, pageSize, forWriting);
+	}
+
+	return NULL;
+}
+
+
 /*****************************************************************************/
 
 
@@ -509,6 +538,47 @@ static void Test_MainbusComponent_Simple_With_AddrMul()
 	    "written to it yet! [3]", dataByte, 0);
 }
 
+static void Test_MainbusComponent_LookupHostPage()
+{
+	refcount_ptr<Component> mainbus =
+	    ComponentFactory::CreateComponent("mainbus");
+	refcount_ptr<Component> ram0 =
+	    ComponentFactory::CreateComponent("ram");
+	refcount_ptr<Component> ram1 =
+	    ComponentFactory::CreateComponent("ram");
+
+	mainbus->AddChild(ram0);
+	mainbus->AddChild(ram1);
+	ram0->SetVariableValue("memoryMappedSize", "0x10000");
+	ram0->SetVariableValue("memoryMappedBase", "0x10000");
+	ram1->SetVariableValue("memoryMappedSize", "0x1800");
+	ram1->SetVariableValue("memoryMappedBase", "0x20000");
+
+	AddressDataBus* bus = mainbus->AsAddressDataBus();
+
+	uint8_t* page = bus->LookupHostPage(0x12000, 0x1000, true);
+	UnitTest::Assert("page in ram0 should be directly accessible",
+	    page != NULL);
+
+	page[5] = 0x99;
+	uint8_t dataByte = 0;
+	bus->AddressSelect(0x12005);
+	bus->ReadData(dataByte);
+	UnitTest::Assert("host page should map to the right address",
+	    dataByte, 0x99);
+
+	UnitTest::Assert("unmapped page should not be accessible",
+	    bus->LookupHostPage(0x30000, 0x1000, true) == NULL);
+	UnitTest::Assert("page partially outside ram1 should not be "
+	    "accessible", bus->LookupHostPage(0x21000, 0x1000, true) == NULL);
+
+	ram0->SetVariableValue("memoryMappedAddrMul", "2");
+	mainbus->FlushCachedState();
+
+	UnitTest::Assert("page with addrMul 2 should not be accessible",
+	    bus->LookupHostPage(0x12000, 0x1000, true) == NULL);
+}
+
 static void Test_MainbusComponent_PreRunCheck()
 {
 	GXemul gxemul;
@@ -542,6 +612,7 @@ UNITTESTS(MainbusComponent)
 	UNITTEST(Test_MainbusComponent_Remapping);
 	UNITTEST(Test_MainbusComponent_Multiple_NonOverlapping);
 	UNITTEST(Test_MainbusComponent_Simple_With_AddrMul);
+	UNITTEST(Test_MainbusComponent_LookupHostPage);
 
 	// TODO: Write outside of mapped space
 	// TODO: Write PARTIALLY outside of mapped space!!! e.g. 64-bit
@@ -51,7 +51,10 @@ CPUComponent::CPUComponent(const string& className, const string& cpuArchitectur
 	, m_functionCallTraceDepth(0)
 	, m_nrOfTracedFunctionCalls(0)
 	, m_addressDataBus(NULL)
+	, m_hostPageShift(0)
 {
+	FlushHostPageCache();
+
 	AddVariable("architecture", &m_cpuArchitecture);
 	AddVariable("pc", &m_pc);
 	AddVariable("lastDumpAddr", &m_lastDumpAddr);
@@ -92,6 +95,8 @@ void CPUComponent::ResetState()
 
 	m_symbolRegistry.Clear();
 
+	FlushHostPageCache();
+
 	Component::ResetState();
 }
 
@@ -420,6 +425,7 @@ AddressDataBus * CPUComponent::AsAddressDataBus()
 void CPUComponent::FlushCachedStateForComponent()
 {
 	m_addressDataBus = NULL;
+	FlushHostPageCache();
 
 	Component::FlushCachedStateForComponent();
 }
@@ -495,6 +501,61 @@ void CPUComponent::ShowRegisters(GXemul* gxemul, const vector<string>& arguments
 }
 
 
+void CPUComponent::FlushHostPageCache()
+{
+	for (size_t i=0; i<N_HOST_PAGE_CACHE_ENTRIES; ++i) {
+		m_hostPageCache[i].vaddr = 0;
+		m_hostPageCache[i].hostPage = NULL;
+		m_hostPageCache[i].writable = false;
+	}
+}
+
+
+uint8_t* CPUComponent::HostPointerSlow(uint64_t vaddr, bool forWriting)
+{
+	if (m_pageSize <= 0 || !LookupAddressDataBus())
+		return NULL;
+
+	// First use, or the page size has changed?
+	if ((1 << m_hostPageShift) != m_pageSize) {
+		FlushHostPageCache();
+
+		m_hostPageShift = 0;
+		while (m_hostPageShift < 30 && (1 << m_hostPageShift) < m_pageSize)
+			m_hostPageShift ++;
+
+		// Only page sizes which are powers of two are supported.
+		if ((1 << m_hostPageShift) != m_pageSize)
+			return NULL;
+	}
+
+	uint64_t offset = vaddr & (m_pageSize - 1);
+	uint64_t paddr;
+	bool writable;
+	if (!VirtualToPhysical(vaddr - offset, paddr, writable))
+		return NULL;
+
+	if (forWriting && !writable)
+		return NULL;
+
+	uint8_t* hostPage = m_addressDataBus->LookupHostPage(paddr,
+	    m_pageSize, forWriting);
+	if (hostPage == NULL)
+		return NULL;
+
+	// Note: Pages looked up for reading are not marked as writable,
+	// since e.g. RAM which has not yet been written to may not be backed
+	// by any host memory until the first write.
+	HostPageCacheEntry& entry = m_hostPageCache[(vaddr >> m_hostPageShift)
+	    & (N_HOST_PAGE_CACHE_ENTRIES - 1)];
+	entry.vaddr = vaddr - offset;
+	entry.hostPage = hostPage;
+	entry.writable = forWriting;
+
+	return hostPage + offset;
+}
+
+
 void CPUComponent::AddressSelect(uint64_t address)
 {
 	m_addressSelect = address;
@@ -503,6 +564,12 @@ void CPUComponent::AddressSelect(uint64_t address)
 
 bool CPUComponent::ReadData(uint8_t& data, Endianness endianness)
 {
+	uint8_t* host = HostPointer(m_addressSelect, false);
+	if (host != NULL) {
+		data = HostByteOrder(*(uint8_t*)host, endianness);
+		return true;
+	}
+
 	if (!LookupAddressDataBus())
 		return false;
 
@@ -519,6 +586,12 @@ bool CPUComponent::ReadData(uint16_t& data, Endianness endianness)
 {
 	assert((m_addressSelect & 1) == 0);
 
+	uint8_t* host = HostPointer(m_addressSelect, false);
+	if (host != NULL) {
+		data = HostByteOrder(*(uint16_t*)host, endianness);
+		return true;
+	}
+
 	if (!LookupAddressDataBus())
 		return false;
 
@@ -535,6 +608,12 @@ bool CPUComponent::ReadData(uint32_t& data, Endianness endianness)
 {
 	assert((m_addressSelect & 3) == 0);
 
+	uint8_t* host = HostPointer(m_addressSelect, false);
+	if (host != NULL) {
+		data = HostByteOrder(*(uint32_t*)host, endianness);
+		return true;
+	}
+
 	if (!LookupAddressDataBus())
 		return false;
 
@@ -551,6 +630,12 @@ bool CPUComponent::ReadData(uint64_t& data, Endianness endianness)
 {
 	assert((m_addressSelect & 7) == 0);
 
+	uint8_t* host = HostPointer(m_addressSelect, false);
+	if (host != NULL) {
+		data = HostByteOrder(*(uint64_t*)host, endianness);
+		return true;
+	}
+
 	if (!LookupAddressDataBus())
 		return false;
 
@@ -565,6 +650,12 @@ bool CPUComponent::ReadData(uint64_t& data, Endianness endianness)
 
 bool CPUComponent::WriteData(const uint8_t& data, Endianness endianness)
 {
+	uint8_t* host = HostPointer(m_addressSelect, true);
+	if (host != NULL) {
+		*(uint8_t*)host = HostByteOrder(data, endianness);
+		return true;
+	}
+
 	if (!LookupAddressDataBus())
 		return false;
 
@@ -581,6 +672,12 @@ bool CPUComponent::WriteData(const uint16_t& data, Endianness endianness)
 {
 	assert((m_addressSelect & 1) == 0);
 
+	uint8_t* host = HostPointer(m_addressSelect, true);
+	if (host != NULL) {
+		*(uint16_t*)host = HostByteOrder(data, endianness);
+		return true;
+	}
+
 	if (!LookupAddressDataBus())
 		return false;
 
@@ -597,6 +694,12 @@ bool CPUComponent::WriteData(const uint32_t& data, Endianness endianness)
 {
 	assert((m_addressSelect & 3) == 0);
 
+	uint8_t* host = HostPointer(m_addressSelect, true);
+	if (host != NULL) {
+		*(uint32_t*)host = HostByteOrder(data, endianness);
+		return true;
+	}
+
 	if (!LookupAddressDataBus())
 		return false;
 
@@ -613,6 +716,12 @@ bool CPUComponent::WriteData(const uint64_t& data, Endianness endianness)
 {
 	assert((m_addressSelect & 7) == 0);
 
+	uint8_t* host = HostPointer(m_addressSelect, true);
+	if (host != NULL) {
+		*(uint64_t*)host = HostByteOrder(data, endianness);
+		return true;
+	}
+
 	if (!LookupAddressDataBus())
 		return false;
 
@@ -1639,7 +1639,6 @@ template<bool store, typename T, bool doubleword, bool regofs, bool scaled, bool
 {
 	DYNTRANS_INSTR_HEAD(M88K_CPUComponent)
 
-	// TODO: fast lookups
 	// TODO: usr access
 
 	// TODO: place in M88K's "ongoing memory transaction" registers!
@@ -1654,17 +1653,34 @@ template<bool store, typename T, bool doubleword, bool regofs, bool scaled, bool
 		return;
 	}
 
-	cpu->AddressSelect(addr);
+	Endianness endianness = cpu->m_isBigEndian? BigEndian : LittleEndian;
+
+	// Fast path: RAM which can be accessed directly via a host pointer.
+	// (The second word of a double-word access must be in the same page.)
+	uint8_t* host = cpu->HostPointer(addr, store);
+	if (host != NULL && doubleword && (addr & (cpu->m_pageSize - 1)) >
+	    (uint32_t) cpu->m_pageSize - 2 * sizeof(uint32_t))
+		host = NULL;
 
 	if (store) {
 		T data = REG32(ic->arg[0]);
-		if (!cpu->WriteData(data, cpu->m_isBigEndian? BigEndian : LittleEndian)) {
-			// TODO: failed to access memory was probably an exception. Handle this!
+		if (host != NULL) {
+			*(T*)host = HostByteOrder(data, endianness);
+		} else {
+			cpu->AddressSelect(addr);
+			if (!cpu->WriteData(data, endianness)) {
+				// TODO: failed to access memory was probably an exception. Handle this!
+			}
 		}
 	} else {
 		T data;
-		if (!cpu->ReadData(data, cpu->m_isBigEndian? BigEndian : LittleEndian)) {
-			// TODO: failed to access memory was probably an exception. Handle this!
+		if (host != NULL) {
+			data = HostByteOrder(*(T*)host, endianness);
+		} else {
+			cpu->AddressSelect(addr);
+			if (!cpu->ReadData(data, endianness)) {
+				// TODO: failed to access memory was probably an exception. Handle this!
+			}
 		}
 
 		if (signedLoad) {
@@ -1679,17 +1695,27 @@ template<bool store, typename T, bool doubleword, bool regofs, bool scaled, bool
 
 	// Special handling of second word in a double-word read or write:
 	if (doubleword) {
+		uint8_t* host2 = host != NULL? host + sizeof(uint32_t) : NULL;
+
 		if (store) {
 			uint32_t data2 = (* (((uint32_t*)(ic->arg[0].p)) + 1) );
-			cpu->AddressSelect(addr + sizeof(uint32_t));
-			if (!cpu->WriteData(data2, cpu->m_isBigEndian? BigEndian : LittleEndian)) {
-				// TODO: failed to access memory was probably an exception. Handle this!
+			if (host2 != NULL) {
+				*(uint32_t*)host2 = HostByteOrder(data2, endianness);
+			} else {
+				cpu->AddressSelect(addr + sizeof(uint32_t));
+				if (!cpu->WriteData(data2, endianness)) {
+					// TODO: failed to access memory was probably an exception. Handle this!
+				}
 			}
 		} else {
 			uint32_t data2;
-			cpu->AddressSelect(addr + sizeof(uint32_t));
-			if (!cpu->ReadData(data2, cpu->m_isBigEndian? BigEndian : LittleEndian)) {
-				// TODO: failed to access memory was probably an exception. Handle this!
+			if (host2 != NULL) {
+				data2 = HostByteOrder(*(uint32_t*)host2, endianness);
+			} else {
+				cpu->AddressSelect(addr + sizeof(uint32_t));
+				if (!cpu->ReadData(data2, endianness)) {
+					// TODO: failed to access memory was probably an exception. Handle this!
+				}
 			}
 
 			(* (((uint32_t*)(ic->arg[0].p)) + 1) ) = data2;
@@ -2605,6 +2631,45 @@ static void Test_M88K_CPUComponent_Execute_Basic()
 	UnitTest::Assert("r30 should have been modified again", cpu->GetVariable("r30")->ToInteger(), 1111 + 0x10);
 }
 
+static void Test_M88K_CPUComponent_Execute_LoadStore()
+{
+	GXemul gxemul;
+	gxemul.GetCommandInterpreter().RunCommand("add testm88k");
+
+	refcount_ptr<Component> cpu = gxemul.GetRootComponent()->LookupPath("root.machine0.mainbus0.cpu0");
+	refcount_ptr<Component> mainbus = gxemul.GetRootComponent()->LookupPath("root.machine0.mainbus0");
+	AddressDataBus* bus = cpu->AsAddressDataBus();
+
+	// st r30,r31,0x100;  ld r29,r31,0x100;  ld.hu r28,r31,0x102
+	uint32_t data32 = 0x27df0100;
+	bus->AddressSelect(48);
+	bus->WriteData(data32, BigEndian);
+	data32 = 0x17bf0100;
+	bus->AddressSelect(52);
+	bus->WriteData(data32, BigEndian);
+	data32 = 0x0b9f0102;
+	bus->AddressSelect(56);
+	bus->WriteData(data32, BigEndian);
+
+	cpu->SetVariableValue("pc", "48");
+	cpu->SetVariableValue("r31", "0x1000");
+	cpu->SetVariableValue("r30", "0x8badf00d");
+
+	gxemul.SetRunState(GXemul::Running);
+	gxemul.Execute(3);
+
+	UnitTest::Assert("pc should have increased", cpu->GetVariable("pc")->ToInteger(), 60);
+	UnitTest::Assert("ld should load what st stored", cpu->GetVariable("r29")->ToInteger(), 0x8badf00d);
+	UnitTest::Assert("ld.hu should load the low half", cpu->GetVariable("r28")->ToInteger(), 0xf00d);
+
+	// The stored word should also be visible to others on the bus:
+	AddressDataBus* mainbusAsBus = mainbus->AsAddressDataBus();
+	data32 = 0;
+	mainbusAsBus->AddressSelect(0x1100);
+	mainbusAsBus->ReadData(data32, BigEndian);
+	UnitTest::Assert("memory should have been written", data32, 0x8badf00d);
+}
+
 static void Test_M88K_CPUComponent_Execute_DelayBranchWithValidInstruction()
 {
 	GXemul gxemul;
@@ -2863,6 +2928,7 @@ UNITTESTS(M88K_CPUComponent)
 
 	// Dyntrans execution:
 	UNITTEST(Test_M88K_CPUComponent_Execute_Basic);
+	UNITTEST(Test_M88K_CPUComponent_Execute_LoadStore);
 	UNITTEST(Test_M88K_CPUComponent_Execute_DelayBranchWithValidInstruction);
 	UNITTEST(Test_M88K_CPUComponent_Execute_DelayBranchWithValidInstruction_SingleStepping);
 	UNITTEST(Test_M88K_CPUComponent_Execute_DelayBranchWithValidInstruction_RunTwoTimes);
@@ -42,6 +42,7 @@ RAMComponent::RAMComponent(const string& visibleClassName)
 	, m_lastDumpAddr(0)
 	, m_addressSelect(0)
 	, m_selectedHostMemoryBlock(NULL)
+	, m_selectedHostMemoryBlockIsShared(false)
 	, m_selectedOffsetWithinBlock(0)
 {
 	AddVariable("writeProtect", &m_writeProtected);
@@ -56,14 +57,67 @@ RAMComponent::~RAMComponent()
 }
 
 
+// Host memory blocks which are no longer used are kept around (up to a
+// limit), so that copy-on-write copies don't have to page in fresh host
+// memory every time a snapshot is taken.
+#define	MAX_UNUSED_MEMORY_BLOCKS	8
+static vector< std::pair<void*, size_t> > g_unusedMemoryBlocks;
+
+
+RAMComponent::MemoryBlock::MemoryBlock(size_t size, bool zeroFilled)
+	: m_size(size)
+	, m_data(NULL)
+	, m_hostPointerOwner(NULL)
+{
+	for (size_t i=0; i<g_unusedMemoryBlocks.size(); ++i) {
+		if (g_unusedMemoryBlocks[i].second != m_size)
+			continue;
+
+		m_data = g_unusedMemoryBlocks[i].first;
+		g_unusedMemoryBlocks.erase(g_unusedMemoryBlocks.begin() + i);
+
+		if (zeroFilled)
+			memset(m_data, 0, m_size);
+
+		return;
+	}
+
+	void * p = mmap(NULL, m_size, PROT_WRITE | PROT_READ,
+	    MAP_ANON | MAP_PRIVATE, -1, 0);
+
+	if (p == MAP_FAILED || p == NULL) {
+		std::cerr << "RAMComponent::MemoryBlock: Could not allocate "
+		    << m_size << " bytes. Aborting.\n";
+		throw std::exception();
+	}
+
+	m_data = p;
+}
+
+
+RAMComponent::MemoryBlock::~MemoryBlock()
+{
+	if (g_unusedMemoryBlocks.size() < MAX_UNUSED_MEMORY_BLOCKS)
+		g_unusedMemoryBlocks.push_back(std::make_pair(m_data, m_size));
+	else
+		munmap(m_data, m_size);
+}
+
+
 void RAMComponent::ReleaseAllBlocks()
 {
 	for (size_t i=0; i<m_memoryBlocks.size(); ++i) {
-		if (m_memoryBlocks[i] != NULL) {
-			munmap(m_memoryBlocks[i], m_blockSize);
+		if (!m_memoryBlocks[i].IsNULL()) {
+			// Blocks may live on in other RAMComponents.
+			if (m_memoryBlocks[i]->m_hostPointerOwner == this)
+				m_memoryBlocks[i]->m_hostPointerOwner = NULL;
+
 			m_memoryBlocks[i] = NULL;
 		}
 	}
+
+	m_selectedHostMemoryBlock = NULL;
+	m_selectedHostMemoryBlockIsShared = false;
 }
 
 
@@ -88,6 +142,19 @@ void RAMComponent::ResetState()
 }
 
 
+void RAMComponent::FlushCachedStateForComponent()
+{
+	// Whoever was using host pointers into our memory blocks must have
+	// forgotten about them by now.
+	for (size_t i=0; i<m_memoryBlocks.size(); ++i)
+		if (!m_memoryBlocks[i].IsNULL() &&
+		    m_memoryBlocks[i]->m_hostPointerOwner == this)
+			m_memoryBlocks[i]->m_hostPointerOwner = NULL;
+
+	Component::FlushCachedStateForComponent();
+}
+
+
 void RAMComponent::GetMethodNames(vector<string>& names) const
 {
 	// Add our method names...
@@ -206,34 +273,96 @@ void RAMComponent::AddressSelect(uint64_t address)
 
 	uint64_t blockNr = address >> m_blockSizeShift;
 
-	if (blockNr+1 > m_memoryBlocks.size())
+	if (blockNr+1 > m_memoryBlocks.size() ||
+	    m_memoryBlocks[blockNr].IsNULL()) {
 		m_selectedHostMemoryBlock = NULL;
-	else
-		m_selectedHostMemoryBlock = m_memoryBlocks[blockNr];
+		m_selectedHostMemoryBlockIsShared = false;
+	} else {
+		m_selectedHostMemoryBlock = m_memoryBlocks[blockNr]->m_data;
+		m_selectedHostMemoryBlockIsShared =
+		    m_memoryBlocks[blockNr]->GetRefCount() > 1;
+	}
 
 	m_selectedOffsetWithinBlock = address & (m_blockSize-1);
 }
 
 
-void* RAMComponent::AllocateBlock()
+void* RAMComponent::AllocateBlock(uint64_t blockNr)
 {
-	void * p = mmap(NULL, m_blockSize, PROT_WRITE | PROT_READ,
-	    MAP_ANON | MAP_PRIVATE, -1, 0);
+	refcount_ptr<MemoryBlock> block = new MemoryBlock(m_blockSize);
 
-	if (p == MAP_FAILED || p == NULL) {
-		std::cerr << "RAMComponent::AllocateBlock: Could not allocate "
-		    << m_blockSize << " bytes. Aborting.\n";
-		throw std::exception();
+	if (blockNr+1 > m_memoryBlocks.size())
+		m_memoryBlocks.resize(blockNr + 1);
+
+	m_memoryBlocks[blockNr] = block;
+
+	return block->m_data;
+}
+
+
+void* RAMComponent::GetWritableBlock(uint64_t blockNr)
+{
+	if (blockNr+1 > m_memoryBlocks.size() ||
+	    m_memoryBlocks[blockNr].IsNULL())
+		return AllocateBlock(blockNr);
+
+	MemoryBlock* block = m_memoryBlocks[blockNr];
+	if (block->GetRefCount() == 1)
+		return block->m_data;
+
+	// The block is shared with at least one other RAMComponent (for
+	// example a snapshot), so it must be copied before it is written to.
+	refcount_ptr<MemoryBlock> copy = new MemoryBlock(m_blockSize, false);
+	memcpy(copy->m_data, block->m_data, m_blockSize);
+
+	if (block->m_hostPointerOwner == NULL ||
+	    block->m_hostPointerOwner == this) {
+		// Host pointers that we have handed out must stay valid, and
+		// nobody else has any, so we keep the original host memory
+		// and let the other RAMComponents have the copy instead.
+		void* data = copy->m_data;
+		copy->m_data = block->m_data;
+		block->m_data = data;
+		copy->m_hostPointerOwner = block->m_hostPointerOwner;
+		block->m_hostPointerOwner = NULL;
 	}
 
-	uint64_t blockNr = m_addressSelect >> m_blockSizeShift;
+	m_memoryBlocks[blockNr] = copy;
 
-	if (blockNr+1 > m_memoryBlocks.size())
-		m_memoryBlocks.resize(blockNr + 1);
+	return copy->m_data;
+}
 
-	m_memoryBlocks[blockNr] = p;
 
-	return p;
+void RAMComponent::MakeSelectedBlockWritable()
+{
+	m_selectedHostMemoryBlock =
+	    GetWritableBlock(m_addressSelect >> m_blockSizeShift);
+	m_selectedHostMemoryBlockIsShared = false;
+}
+
+
+void RAMComponent::ShareBlocksFrom(const RAMComponent& other)
+{
+	ReleaseAllBlocks();
+
+	m_memoryBlocks.resize(other.m_memoryBlocks.size());
+
+	for (size_t i=0; i<other.m_memoryBlocks.size(); ++i) {
+		const MemoryBlock* block = other.m_memoryBlocks[i];
+		if (block == NULL)
+			continue;
+
+		if (block->m_hostPointerOwner == NULL) {
+			m_memoryBlocks[i] = other.m_memoryBlocks[i];
+		} else {
+			// Someone may be writing to the block through a host
+			// pointer, behind the back of the copy-on-write logic.
+			void* p = AllocateBlock(i);
+			memcpy(p, block->m_data, m_blockSize);
+		}
+	}
+
+	AddressSelect(m_addressSelect);
 }
 
 
@@ -311,8 +440,9 @@ bool RAMComponent::WriteData(const uint8_t& data, Endianness endianness)
 	if (m_writeProtected)
 		return false;
 
-	if (m_selectedHostMemoryBlock == NULL)
-		m_selectedHostMemoryBlock = AllocateBlock();
+	if (m_selectedHostMemoryBlock == NULL ||
+	    m_selectedHostMemoryBlockIsShared)
+		MakeSelectedBlockWritable();
 
 	(((uint8_t*)m_selectedHostMemoryBlock)
 	    [m_selectedOffsetWithinBlock]) = data;
@@ -328,8 +458,9 @@ bool RAMComponent::WriteData(const uint16_t& data, Endianness endianness)
 	if (m_writeProtected)
 		return false;
 
-	if (m_selectedHostMemoryBlock == NULL)
-		m_selectedHostMemoryBlock = AllocateBlock();
+	if (m_selectedHostMemoryBlock == NULL ||
+	    m_selectedHostMemoryBlockIsShared)
+		MakeSelectedBlockWritable();
 
 	uint16_t d;
 	if (endianness == BigEndian)
@@ -351,8 +482,9 @@ bool RAMComponent::WriteData(const uint32_t& data, Endianness endianness)
 	if (m_writeProtected)
 		return false;
 
-	if (m_selectedHostMemoryBlock == NULL)
-		m_selectedHostMemoryBlock = AllocateBlock();
+	if (m_selectedHostMemoryBlock == NULL ||
+	    m_selectedHostMemoryBlockIsShared)
+		MakeSelectedBlockWritable();
 
 	uint32_t d;
 	if (endianness == BigEndian)
@@ -374,8 +506,9 @@ bool RAMComponent::WriteData(const uint64_t& data, Endianness endianness)
 	if (m_writeProtected)
 		return false;
 
-	if (m_selectedHostMemoryBlock == NULL)
-		m_selectedHostMemoryBlock = AllocateBlock();
+	if (m_selectedHostMemoryBlock == NULL ||
+	    m_selectedHostMemoryBlockIsShared)
+		MakeSelectedBlockWritable();
 
 	uint64_t d;
 	if (endianness == BigEndian)
@@ -390,6 +523,44 @@ bool RAMComponent::WriteData(const uint64_t& data, Endianness endianness)
 }
 
 
+uint8_t* RAMComponent::LookupHostPage(uint64_t address, uint64_t pageSize,
+	bool forWriting)
+{
+	if (pageSize > (uint64_t) m_blockSize)
+		return NULL;
+
+	if (forWriting && m_writeProtected)
+		return NULL;
+
+	uint64_t blockNr = address >> m_blockSizeShift;
+	MemoryBlock* block = NULL;
+	if (blockNr < m_memoryBlocks.size())
+		block = m_memoryBlocks[blockNr];
+
+	// Memory which has never been written to reads as zeroes, without
+	// being backed by a host memory block. Don't allocate a block just
+	// because of a read; let such reads take the slow path instead.
+	if (block == NULL && !forWriting)
+		return NULL;
+
+	// Shared blocks are copied before they are written to. A shared
+	// block which some other RAMComponent has handed out host pointers
+	// into may change under our feet, so we need our own copy of it.
+	if (block == NULL || forWriting || (block->m_hostPointerOwner != NULL
+	    && block->m_hostPointerOwner != this)) {
+		GetWritableBlock(blockNr);
+		block = m_memoryBlocks[blockNr];
+
+		// The selected block may have been the one just replaced:
+		AddressSelect(m_addressSelect);
+	}
+
+	block->m_hostPointerOwner = this;
+
+	return (uint8_t*)block->m_data + (address & (m_blockSize-1));
+}
+
+
 /*****************************************************************************/
 
 
@@ -602,6 +773,50 @@ static void Test_RAMComponent_Clone()
 	UnitTest::Assert("16-bit read", data16_a, 0x3412);
 }
 
+static void Test_RAMComponent_CloneIsCopyOnWrite()
+{
+	refcount_ptr<Component> ram = ComponentFactory::CreateComponent("ram");
+	AddressDataBus* bus = ram->AsAddressDataBus();
+
+	uint32_t data32 = 0x11111111;
+	bus->AddressSelect(0x100);
+	bus->WriteData(data32, BigEndian);
+
+	ram->FlushCachedState();
+	refcount_ptr<Component> clone = ram->Clone();
+	AddressDataBus* cloneBus = clone->AsAddressDataBus();
+
+	// A host pointer into the shared block, handed out before the
+	// original is written to, must see the original's new value.
+	uint8_t* hostPage = bus->LookupHostPage(0x100, 4096, false);
+	UnitTest::Assert("host page", hostPage != NULL);
+
+	data32 = 0x22222222;
+	bus->AddressSelect(0x100);
+	bus->WriteData(data32, BigEndian);
+
+	UnitTest::Assert("host page should see the write", hostPage[3], 0x22);
+
+	data32 = 0;
+	cloneBus->AddressSelect(0x100);
+	cloneBus->ReadData(data32, BigEndian);
+	UnitTest::Assert("the clone should not be affected", data32, 0x11111111);
+
+	data32 = 0x33333333;
+	cloneBus->AddressSelect(0x104);
+	cloneBus->WriteData(data32, BigEndian);
+
+	data32 = 0;
+	bus->AddressSelect(0x104);
+	bus->ReadData(data32, BigEndian);
+	UnitTest::Assert("the original should not be affected", data32, 0);
+
+	data32 = 0;
+	cloneBus->AddressSelect(0x100);
+	cloneBus->ReadData(data32, BigEndian);
+	UnitTest::Assert("clone, after write", data32, 0x11111111);
+}
+
 static void Test_RAMComponent_ManualSerialization()
 {
 	refcount_ptr<Component> ram = ComponentFactory::CreateComponent("ram");
@@ -636,6 +851,88 @@ static void Test_RAMComponent_ManualSerialization()
 	UnitTest::Assert("16-bit read", data16_a, 0x3512);
 }
 
+static void Test_RAMComponent_BinarySerialization()
+{
+	refcount_ptr<Component> ram = ComponentFactory::CreateComponent("ram");
+	AddressDataBus* bus = ram->AsAddressDataBus();
+
+	// Two runs of non-zero pages in the first block (the second of
+	// which is two pages long), and one in another block:
+	uint64_t addrs[4] = { 0x10, 0x5ffe, 0x6004, 0x1000000 + 0x2345 };
+	for (size_t i=0; i<4; ++i) {
+		uint32_t data32 = 0x89abcde5 + i;
+		bus->AddressSelect(addrs[i]);
+		bus->WriteData(data32, BigEndian);
+	}
+
+	Checksum checksumOriginal;
+	ram->AddChecksum(checksumOriginal);
+
+	for (int compress = 0; compress <= 1; ++ compress) {
+		BinarySerializer serializer(compress != 0);
+		ram->SerializeBinary(serializer);
+
+		UnitTest::Assert("all-zero pages should not be written",
+		    serializer.GetSize() < 5 * 4096);
+
+		vector<uint8_t> bytes;
+		serializer.GetBytes(bytes);
+
+		BinaryDeserializer deserializer(&bytes[0], bytes.size());
+		UnitTest::Assert("magic", deserializer.ReadMagic());
+
+		stringstream messages;
+		refcount_ptr<Component> ram2 =
+		    Component::DeserializeBinary(messages, deserializer);
+		UnitTest::Assert("deserialization failed?", !ram2.IsNULL());
+		UnitTest::Assert("there should be no messages",
+		    messages.str(), "");
+
+		Checksum checksumDeserialized;
+		ram2->AddChecksum(checksumDeserialized);
+		UnitTest::Assert("checksum mismatch",
+		    checksumOriginal == checksumDeserialized);
+
+		bus = ram2->AsAddressDataBus();
+		uint32_t data32 = 0;
+		bus->AddressSelect(0x1000000 + 0x2345);
+		bus->ReadData(data32, BigEndian);
+		UnitTest::Assert("32-bit read", data32, 0x89abcde8);
+	}
+}
+
+static void Test_RAMComponent_LookupHostPage()
+{
+	refcount_ptr<Component> ram = ComponentFactory::CreateComponent("ram");
+	AddressDataBus* bus = ram->AsAddressDataBus();
+
+	UnitTest::Assert("unwritten memory should not be read directly",
+	    bus->LookupHostPage(0x3000, 4096, false) == NULL);
+
+	uint8_t* page = bus->LookupHostPage(0x3000, 4096, true);
+	UnitTest::Assert("writing should give a host page", page != NULL);
+	UnitTest::Assert("reading should now give the same page",
+	    bus->LookupHostPage(0x3000, 4096, false) == page);
+
+	page[0x10] = 0x12;
+	page[0x11] = 0x34;
+
+	uint16_t data16 = 0;
+	bus->AddressSelect(0x3010);
+	bus->ReadData(data16, BigEndian);
+	UnitTest::Assert("direct write should be visible", data16, 0x1234);
+
+	uint32_t data32 = 0xaabbccdd;
+	bus->AddressSelect(0x3020);
+	bus->WriteData(data32, LittleEndian);
+	UnitTest::Assert("WriteData should be visible in the page",
+	    page[0x20] == 0xdd && page[0x23] == 0xaa);
+
+	ram->SetVariableValue("writeProtect", "true");
+	UnitTest::Assert("writeprotected memory should not be writable",
+	    bus->LookupHostPage(0x3000, 4096, true) == NULL);
+}
+
 static void Test_RAMComponent_Methods_Reexecutableness()
 {
 	refcount_ptr<Component> ram = ComponentFactory::CreateComponent("ram");
@@ -656,7 +953,10 @@ UNITTESTS(RAMComponent)
 	UNITTEST(Test_RAMComponent_WriteProtect);
 	UNITTEST(Test_RAMComponent_ClearOnReset);
 	UNITTEST(Test_RAMComponent_Clone);
+	UNITTEST(Test_RAMComponent_CloneIsCopyOnWrite);
 	UNITTEST(Test_RAMComponent_ManualSerialization);
+	UNITTEST(Test_RAMComponent_BinarySerialization);
+	UNITTEST(Test_RAMComponent_LookupHostPage);
 	UNITTEST(Test_RAMComponent_Methods_Reexecutableness);
 }
 
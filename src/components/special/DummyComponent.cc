@@ -578,6 +578,7 @@ public:
 		, m_frequency(1e6)
 		, m_os(os)
 		, m_c(c)
+		, m_nrOfExecuteCalls(0)
 	{
 		ResetState();
 		AddVariable("frequency", &m_frequency);
@@ -597,6 +598,8 @@ public:
 
 	virtual int Execute(GXemul* gxemul, int nrOfCycles)
 	{
+		++ m_nrOfExecuteCalls;
+
 		// Increase counter one per cycle.
 		m_counter += nrOfCycles;
 
@@ -608,11 +611,17 @@ public:
 		return nrOfCycles;
 	}
 
+	int GetNrOfExecuteCalls() const
+	{
+		return m_nrOfExecuteCalls;
+	}
+
 private:
 	double		m_frequency;
 	uint64_t	m_counter;
 	ostream*	m_os;
 	char		m_c;
+	int		m_nrOfExecuteCalls;
 };
 
 static void Test_DummyComponent_Execute_SingleStep()
@@ -1067,6 +1076,89 @@ static void Test_DummyComponent_Execute_Continuous_ThreeComponentsDifferentSpeed
 	}	
 }
 
+static void Test_DummyComponent_Execute_Continuous_FastAndSlowInBatches()
+{
+	// A fast "CPU" and a slow "timer": the CPU should not be executed
+	// one step at a time, even though the frequencies are not exact
+	// multiples of each other.
+	GXemul gxemul;
+	stringstream os;
+	DummyComponentWithCounter* cpu = new DummyComponentWithCounter(&os, 'C');
+	DummyComponentWithCounter* timer = new DummyComponentWithCounter(&os, 'T');
+	gxemul.GetRootComponent()->AddChild(cpu);
+	gxemul.GetRootComponent()->AddChild(timer);
+
+	cpu->SetVariableValue("frequency", "33333333");
+	timer->SetVariableValue("frequency", "1000000");
+
+	gxemul.SetRunState(GXemul::Running);
+	gxemul.Execute(3300);
+
+	int n = gxemul.GetStep();
+	UnitTest::Assert("n", n, 3300);
+	UnitTest::Assert("the CPU should execute in batches",
+	    cpu->GetNrOfExecuteCalls() <= n / 33 + 2);
+
+	// Compare with single-step stream:
+	GXemul gxemul2;
+	stringstream singleStepStream;
+	gxemul2.GetRootComponent()->AddChild(new DummyComponentWithCounter(&singleStepStream, 'C'));
+	gxemul2.GetRootComponent()->AddChild(new DummyComponentWithCounter(&singleStepStream, 'T'));
+	gxemul2.GetRootComponent()->GetChildren()[0]->SetVariableValue("frequency", "33333333");
+	gxemul2.GetRootComponent()->GetChildren()[1]->SetVariableValue("frequency", "1000000");
+
+	for (int i=0; i<n; ++i) {
+		gxemul2.SetRunState(GXemul::SingleStepping);
+		gxemul2.Execute();
+	}
+
+	UnitTest::Assert("output stream mismatch?", os.str() == singleStepStream.str());
+}
+
+static void Test_DummyComponent_Execute_Continuous_SloppySyncQuantum()
+{
+	GXemul gxemul;
+	stringstream os;
+	DummyComponentWithCounter* counterA = new DummyComponentWithCounter(&os, 'A');
+	DummyComponentWithCounter* counterB = new DummyComponentWithCounter(&os, 'B');
+	gxemul.GetRootComponent()->AddChild(counterA);
+	gxemul.GetRootComponent()->AddChild(counterB);
+
+	UnitTest::Assert("syncQuantum must be at least 1",
+	    !gxemul.GetRootComponent()->SetVariableValue("syncQuantum", "0"));
+
+	gxemul.GetRootComponent()->SetVariableValue("accuracy", "\"sloppy\"");
+	gxemul.GetRootComponent()->SetVariableValue("syncQuantum", "1000");
+
+	counterA->SetVariableValue("counter", "0");
+	counterB->SetVariableValue("counter", "0");
+
+	// B runs at a fifth of A's speed. With cycle accuracy, A would have
+	// to stop every fifth step.
+	counterA->SetVariableValue("frequency", "500");
+	counterB->SetVariableValue("frequency", "100");
+
+	gxemul.SetRunState(GXemul::Running);
+	gxemul.Execute(5000);
+
+	UnitTest::Assert("step", gxemul.GetStep(), 5000);
+	UnitTest::Assert("counter A",
+	    counterA->GetVariable("counter")->ToInteger(), 5000);
+	UnitTest::Assert("counter B",
+	    counterB->GetVariable("counter")->ToInteger(), 1000);
+	UnitTest::Assert("A should run one quantum per call",
+	    counterA->GetNrOfExecuteCalls(), 5);
+	UnitTest::Assert("B should run one quantum per call",
+	    counterB->GetNrOfExecuteCalls(), 5);
+
+	// Within each quantum, A runs first, then B.
+	stringstream correct;
+	for (int i=0; i<5; ++i)
+		correct << string(1000, 'A') << string(200, 'B');
+
+	UnitTest::Assert("output stream mismatch?", os.str(), correct.str());
+}
+
 /*
 static void Test_DummyComponent_Execute_Continuous_ThreeComponentsDifferentSpeedWeird2()
 {
@@ -1128,6 +1220,84 @@ static void Test_DummyComponent_Execute_Continuous_ThreeComponentsDifferentSpeed
 }
 */
 
+static void Test_DummyComponent_Execute_PeriodicSnapshots()
+{
+	GXemul gxemul;
+	gxemul.GetCommandInterpreter().RunCommand("add testcounter");
+	gxemul.SetSnapshottingEnabled(true);
+
+	refcount_ptr<Component> root = gxemul.GetRootComponent();
+	root->SetVariableValue("snapshotInterval", "100");
+	root->SetVariableValue("maxSnapshots", "4");
+
+	gxemul.SetRunState(GXemul::Running);
+	gxemul.Execute(1000);
+
+	UnitTest::Assert("the step should now be 1000", gxemul.GetStep(), 1000);
+	UnitTest::Assert("snapshots at 0, 800, 900, and 1000 should be kept",
+	    gxemul.GetNrOfSnapshots(), 4);
+
+	// Going back: the counter is restored from the snapshot at step 900,
+	// and then run forward 50 steps. Later snapshots are thrown away.
+	root->SetVariableValue("step", "950");
+	refcount_ptr<Component> counter = gxemul.GetRootComponent()->GetChildren()[0];
+	UnitTest::Assert("the step should now be 950", gxemul.GetStep(), 950);
+	UnitTest::Assert("counter at step 950",
+	    counter->GetVariable("counter")->ToInteger(), 42 + 950);
+	UnitTest::Assert("snapshots at 0, 800, and 900", gxemul.GetNrOfSnapshots(), 3);
+
+	root = gxemul.GetRootComponent();
+	root->SetVariableValue("step", "850");
+	counter = gxemul.GetRootComponent()->GetChildren()[0];
+	UnitTest::Assert("counter at step 850",
+	    counter->GetVariable("counter")->ToInteger(), 42 + 850);
+
+	// Before the oldest periodic snapshot; only the one at step 0 is left.
+	root = gxemul.GetRootComponent();
+	root->SetVariableValue("step", "10");
+	counter = gxemul.GetRootComponent()->GetChildren()[0];
+	UnitTest::Assert("counter at step 10",
+	    counter->GetVariable("counter")->ToInteger(), 42 + 10);
+	UnitTest::Assert("only the snapshot at step 0", gxemul.GetNrOfSnapshots(), 1);
+	UnitTest::Assert("the interval should not have been rewound",
+	    gxemul.GetRootComponent()->GetVariable("snapshotInterval")->ToInteger(), 100);
+
+	// Running forward again takes new snapshots.
+	gxemul.SetRunState(GXemul::Running);
+	gxemul.Execute(290);
+	UnitTest::Assert("the step should now be 300", gxemul.GetStep(), 300);
+	UnitTest::Assert("snapshots at 0, 100, 200, and 300", gxemul.GetNrOfSnapshots(), 4);
+}
+
+static void Test_DummyComponent_DetectChangesSinceRemembered()
+{
+	GXemul gxemul;
+	gxemul.GetCommandInterpreter().RunCommand("add testcounter");
+	gxemul.GetCommandInterpreter().RunCommand("add testcounter");
+
+	refcount_ptr<Component> root = gxemul.GetRootComponent();
+	refcount_ptr<Component> counterB = root->GetChildren()[1];
+
+	const refcount_ptr<Component> lightClone = root->LightClone();
+	root->RememberState();
+
+	counterB->SetVariableValue("counter", "123");
+	gxemul.GetCommandInterpreter().RunCommand("add testcounter");
+
+	stringstream withClone;
+	root->DetectChanges(lightClone, withClone);
+
+	stringstream withoutClone;
+	root->DetectChangesSinceRemembered(withoutClone);
+
+	UnitTest::Assert("the counter change should be detected",
+	    withoutClone.str().find("counter: 0x2a -> 0x7b") != string::npos);
+	UnitTest::Assert("the new component should be detected",
+	    withoutClone.str().find("(appeared)") != string::npos);
+	UnitTest::Assert("the messages should be the same as with a clone",
+	    withoutClone.str(), withClone.str());
+}
+
 UNITTESTS(DummyComponent)
 {
 	ComponentFactory::RegisterComponentClass("dummy2",
@@ -1180,6 +1350,10 @@ UNITTESTS(DummyComponent)
 	UNITTEST(Test_DummyComponent_Execute_Continuous_TwoComponentsDifferentSpeed);
 	UNITTEST(Test_DummyComponent_Execute_Continuous_ThreeComponentsDifferentSpeed);
 	UNITTEST(Test_DummyComponent_Execute_Continuous_ThreeComponentsDifferentSpeedWeird);
+	UNITTEST(Test_DummyComponent_Execute_Continuous_FastAndSlowInBatches);
+	UNITTEST(Test_DummyComponent_Execute_Continuous_SloppySyncQuantum);
+	UNITTEST(Test_DummyComponent_Execute_PeriodicSnapshots);
+	UNITTEST(Test_DummyComponent_DetectChangesSinceRemembered);
 // TODO: This currently fails!
 //	UNITTEST(Test_DummyComponent_Execute_Continuous_ThreeComponentsDifferentSpeedWeird2);
 }
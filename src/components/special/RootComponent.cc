@@ -34,10 +34,16 @@ RootComponent::RootComponent(GXemul* owner)
 	: Component("root", "root")
 	, m_gxemul(owner)
 	, m_accuracy("cycle")
+	, m_syncQuantum(10000)
+	, m_snapshotInterval(1000000)
+	, m_maxSnapshots(32)
 {
 	SetVariableValue("name", "\"root\"");
 
 	AddVariable("accuracy", &m_accuracy);
+	AddVariable("syncQuantum", &m_syncQuantum);
+	AddVariable("snapshotInterval", &m_snapshotInterval);
+	AddVariable("maxSnapshots", &m_maxSnapshots);
 }
 
 
@@ -72,6 +78,20 @@ bool RootComponent::CheckVariableWrite(StateVariable& var, const string& oldValu
 		}
 	}
 
+	if (name == "syncQuantum" && var.ToInteger() < 1) {
+		if (ui != NULL)
+			ui->ShowDebugMessage(this, "syncQuantum must be at least 1.\n");
+
+		return false;
+	}
+
+	if (name == "maxSnapshots" && var.ToInteger() < 1) {
+		if (ui != NULL)
+			ui->ShowDebugMessage(this, "maxSnapshots must be at least 1.\n");
+
+		return false;
+	}
+
 	return Component::CheckVariableWrite(var, oldValue);
 }
 
@@ -101,6 +121,12 @@ static void Test_RootComponent_InitialVariables()
 	UnitTest::Assert("name should be root", name->ToString(), "root");
 	UnitTest::Assert("step should be 0", step->ToInteger(), 0);
 	UnitTest::Assert("accuracy should be cycle", accuracy->ToString(), "cycle");
+	UnitTest::Assert("syncQuantum",
+	    component->GetVariable("syncQuantum")->ToInteger(), 10000);
+	UnitTest::Assert("snapshotInterval",
+	    component->GetVariable("snapshotInterval")->ToInteger(), 1000000);
+	UnitTest::Assert("maxSnapshots",
+	    component->GetVariable("maxSnapshots")->ToInteger(), 32);
 }
 
 static void Test_RootComponent_AccuracyValues()
@@ -57,7 +57,9 @@
  *  to the handle of the correct port on that controller.
  *
  *
- *  NOTE: The code in this module is mostly non-reentrant.
+ *  NOTE: The code in this module is mostly non-reentrant. When machines run
+ *  in separate host threads (-P), the functions which devices call while
+ *  running are serialized with console_mutex.
  */
 
 #include <errno.h>
@@ -76,6 +78,10 @@
 #include "machine.h"
 #include "settings.h"
 
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 
 extern char *progname;
 extern int verbose;
@@ -130,6 +136,19 @@ struct console_handle {
 static struct console_handle *console_handles = NULL;
 static int n_console_handles = 0;
 
+/*
+ *  Machines may run in separate host threads; see emul_run(). The mutex is
+ *  recursive, since for example console_readchar() calls console_charavail().
+ */
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t console_mutex;
+#define	CONSOLE_LOCK()		pthread_mutex_lock(&console_mutex)
+#define	CONSOLE_UNLOCK()	pthread_mutex_unlock(&console_mutex)
+#else
+#define	CONSOLE_LOCK()
+#define	CONSOLE_UNLOCK()
+#endif
+
 
 /*
  *  console_deinit_main():
@@ -295,6 +314,8 @@ static int d_avail(int d)
  */
 void console_makeavail(int handle, char ch)
 {
+	CONSOLE_LOCK();
+
 	console_handles[handle].fifo[
 	    console_handles[handle].fifo_head] = ch;
 	console_handles[handle].fifo_head = (
@@ -303,6 +324,8 @@ void console_makeavail(int handle, char ch)
 	if (console_handles[handle].fifo_head ==
 	    console_handles[handle].fifo_tail)
 		fatal("[ WARNING: console fifo overrun, handle %i ]\n", handle);
+
+	CONSOLE_UNLOCK();
 }
 
 
@@ -346,6 +369,10 @@ static int console_room_left_in_fifo(int handle)
  */
 int console_charavail(int handle)
 {
+	int n;
+
+	CONSOLE_LOCK();
+
 	while (console_stdin_avail(handle)) {
 		unsigned char ch[100];		/* = getchar(); */
 		ssize_t len;
@@ -378,7 +405,10 @@ int console_charavail(int handle)
 		}
 	}
 
-	return CONSOLE_FIFO_LEN - console_room_left_in_fifo(handle);
+	n = CONSOLE_FIFO_LEN - console_room_left_in_fifo(handle);
+
+	CONSOLE_UNLOCK();
+	return n;
 }
 
 
@@ -391,13 +421,18 @@ int console_readchar(int handle)
 {
 	int ch;
 
-	if (!console_charavail(handle))
+	CONSOLE_LOCK();
+
+	if (!console_charavail(handle)) {
+		CONSOLE_UNLOCK();
 		return -1;
+	}
 
 	ch = console_handles[handle].fifo[console_handles[handle].fifo_tail];
 	console_handles[handle].fifo_tail ++;
 	console_handles[handle].fifo_tail %= CONSOLE_FIFO_LEN;
 
+	CONSOLE_UNLOCK();
 	return ch;
 }
 
@@ -411,6 +446,8 @@ void console_putchar(int handle, int ch)
 {
 	char buf[1];
 
+	CONSOLE_LOCK();
+
 	if (!console_handles[handle].in_use_for_input &&
 	    !console_handles[handle].outputonly)
 		console_change_inputability(handle, 1);
@@ -425,12 +462,14 @@ void console_putchar(int handle, int ch)
 		else
 			console_stdout_pending = 1;
 
+		CONSOLE_UNLOCK();
 		return;
 	}
 
 	if (!console_handles[handle].in_use) {
 		printf("[ console_putchar(): handle %i not in"
 		    " use! ]\n", handle);
+		CONSOLE_UNLOCK();
 		return;
 		}
 
@@ -441,6 +480,8 @@ void console_putchar(int handle, int ch)
 	buf[0] = ch;
 	if (write(console_handles[handle].w_descriptor, buf, 1) != 1)
 		perror("error writing to console handle");
+
+	CONSOLE_UNLOCK();
 }
 
 
@@ -451,10 +492,14 @@ void console_putchar(int handle, int ch)
  */
 void console_flush(void)
 {
+	CONSOLE_LOCK();
+
 	if (console_stdout_pending)
 		fflush(stdout);
 
 	console_stdout_pending = 0;
+
+	CONSOLE_UNLOCK();
 }
 
 
@@ -759,6 +804,8 @@ int console_change_inputability(int handle, int inputability)
 		exit(1);
 	}
 
+	CONSOLE_LOCK();
+
 	old = console_handles[handle].in_use_for_input;
 	console_handles[handle].in_use_for_input = inputability;
 
@@ -774,10 +821,12 @@ int console_change_inputability(int handle, int inputability)
 				    "line option!\n%%\n");
 			}
 			console_handles[handle].warning_printed = 1;
+			CONSOLE_UNLOCK();
 			return 0;
 		}
 	}
 
+	CONSOLE_UNLOCK();
 	return 1;
 }
 
@@ -959,6 +1008,14 @@ void console_init(void)
 {
 	int handle;
 	struct console_handle *chp;
+#ifdef HAVE_PTHREADS
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&console_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+#endif
 
 	console_settings = settings_new();
 
@@ -33,6 +33,7 @@
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "cpu.h"
 #include "machine.h"
@@ -294,13 +295,21 @@ void cpu_functioncall_trace_return(struct cpu *cpu)
  *
  *  Create the translation cache in memory (ie allocate memory for it), if
  *  necessary, and then reset it to an initial state.
+ *
+ *  Each cpu has a translation cache of its own, also in SMP machines. The
+ *  translations can not be shared between cpus, since the arguments of most
+ *  translated instructions point into the cpu's own state, e.g. at
+ *  &cpu->cd.mips.gpr[rt].
  */
 void cpu_create_or_reset_tc(struct cpu *cpu)
 {
 	size_t s = dyntrans_cache_size + DYNTRANS_CACHE_MARGIN;
 
-	if (cpu->translation_cache == NULL)
+	if (cpu->translation_cache == NULL) {
+		cpu->translation_cache_size = dyntrans_cache_size;
 		cpu->translation_cache = (unsigned char *) zeroed_alloc(s);
+	} else
+		cpu->tc_stats.full_resets ++;
 
 	/*  Create an empty table at the beginning of the translation cache:  */
 	memset(cpu->translation_cache, 0, sizeof(uint32_t)
@@ -309,6 +318,13 @@ void cpu_create_or_reset_tc(struct cpu *cpu)
 	cpu->translation_cache_cur_ofs =
 	    N_BASE_TABLE_ENTRIES * sizeof(uint32_t);
 
+	/*  No reclaimed pages yet:  */
+	cpu->translation_cache_free_ofs = 0;
+	cpu->translation_cache_clock_hand = cpu->translation_cache_cur_ofs;
+
+	/*  All chained branches point to the old translation pages:  */
+	DYNTRANS_CHAIN_INVALIDATE(cpu);
+
 	/*
 	 *  There might be other translation pointers that still point to
 	 *  within the translation_cache region. Let's invalidate those too:
@@ -368,6 +384,87 @@ void cpu_list_available_types(void)
 }
 
 
+/*
+ *  cpu_idle():
+ *
+ *  Called by instructions that make the cpu wait for an interrupt (MIPS
+ *  "wait", SH "sleep", ...), and by recognized idle loops. The current time
+ *  slice ends here. The dyntrans core then fast-forwards to the machine's
+ *  next scheduled event (see cpu_idle_cycles()), instead of spinning until
+ *  something happens.
+ */
+void cpu_idle(struct cpu *cpu)
+{
+	cpu->is_idle = 1;
+	cpu->has_been_idling = 1;
+
+	if (cpu->n_translated_instrs < N_SAFE_DYNTRANS_LIMIT)
+		cpu->n_translated_instrs = N_SAFE_DYNTRANS_LIMIT;
+}
+
+
+/*
+ *  cpu_idle_cycles():
+ *
+ *  Returns the number of cycles that an idle cpu, which has run n_instrs
+ *  instructions in its current time slice, may skip without missing any of
+ *  the machine's tick functions or timers. (Interrupt sources driven
+ *  directly by the cycle count, such as the MIPS count/compare registers,
+ *  are up to the caller.)
+ *
+ *  Only single-cpu machines are fast-forwarded. In SMP machines, the other
+ *  cpus may still have work to do; there, an idle cpu just ends its slice.
+ */
+int64_t cpu_idle_cycles(struct cpu *cpu, int n_instrs)
+{
+	int64_t cycles;
+
+	cpu->is_idle = 0;
+
+	if (cpu->machine->ncpus > 1)
+		return 0;
+
+	cycles = machine_cycles_until_next_event(cpu->machine);
+	if (cycles < 0 || cycles > CPU_IDLE_MAX_CYCLES)
+		cycles = CPU_IDLE_MAX_CYCLES;
+
+	cycles -= n_instrs;
+	return cycles > 0? cycles : 0;
+}
+
+
+/*
+ *  cpu_idle_sleep():
+ *
+ *  Lets the host sleep for (roughly) the real time that a number of skipped
+ *  cycles corresponds to, so that an idle guest does not keep a host core
+ *  busy. Emulated time does not depend on this. Short idle periods are added
+ *  up, since each usleep() call has a cost of its own.
+ */
+void cpu_idle_sleep(struct cpu *cpu, int64_t cycles)
+{
+	double hz = cpu->machine->emulated_hz > 0?
+	    cpu->machine->emulated_hz : TIMER_DEFAULT_EMULATED_HZ;
+	int64_t usec = cpu->idle_sleep_usec +
+	    (int64_t) (cycles * 1000000.0 / hz);
+
+	if (usec < CPU_IDLE_MIN_SLEEP_USEC) {
+		cpu->idle_sleep_usec = usec;
+		return;
+	}
+
+	if (usec > CPU_IDLE_MAX_SLEEP_USEC)
+		usec = CPU_IDLE_MAX_SLEEP_USEC;
+
+	cpu->idle_sleep_usec = 0;
+
+	/*  Use some of the idle time to give all-zero pages back to the host:  */
+	memory_zero_scan(cpu->mem, MEMORY_ZERO_SCAN_PAGES);
+
+	usleep(usec);
+}
+
+
 /*
  *  cpu_run_deinit():
  *
@@ -404,6 +501,10 @@ void cpu_run_deinit(struct machine *machine)
  *
  *  If show_nr_of_instructions is on, then print a line to stdout about how
  *  many instructions/cycles have been executed so far.
+ *
+ *  When forced (at the end of the emulation), the instructions executed
+ *  since the last periodic update are included too, so that the average
+ *  covers the entire run.
  */
 void cpu_show_cycles(struct machine *machine, int forced)
 {
@@ -413,11 +514,14 @@ void cpu_show_cycles(struct machine *machine, int forced)
 	struct timeval tv;
 	struct cpu *cpu = machine->cpus[machine->bootstrap_cpu];
 
-	static int64_t mseconds_last = 0;
-	static int64_t ninstrs_last = -1;
-
 	pc = cpu->pc;
 
+	if (forced) {
+		cpu->ninstrs_since_gettimeofday +=
+		    cpu->ninstrs - cpu->ninstrs_show;
+		cpu->ninstrs_show = cpu->ninstrs;
+	}
+
 	gettimeofday(&tv, NULL);
 	mseconds = (tv.tv_sec - cpu->starttime.tv_sec) * 1000
 	         + (tv.tv_usec - cpu->starttime.tv_usec) / 1000;
@@ -425,7 +529,7 @@ void cpu_show_cycles(struct machine *machine, int forced)
 	if (mseconds == 0)
 		mseconds = 1;
 
-	if (mseconds - mseconds_last == 0)
+	if (mseconds - cpu->show_cycles_mseconds_last == 0)
 		mseconds ++;
 
 	ninstrs = cpu->ninstrs_since_gettimeofday;
@@ -437,7 +541,8 @@ void cpu_show_cycles(struct machine *machine, int forced)
 	printf("[ %" PRIi64" instrs", (int64_t) cpu->ninstrs);
 
 	/*  Instructions per second, and average so far:  */
-	is = 1000 * (ninstrs-ninstrs_last) / (mseconds-mseconds_last);
+	is = 1000 * (ninstrs - cpu->show_cycles_ninstrs_last) /
+	    (mseconds - cpu->show_cycles_mseconds_last);
 	avg = (long long)1000 * ninstrs / mseconds;
 	if (is < 0)
 		is = 0;
@@ -469,8 +574,8 @@ void cpu_show_cycles(struct machine *machine, int forced)
 	printf(" ]\n");
 
 do_return:
-	ninstrs_last = ninstrs;
-	mseconds_last = mseconds;
+	cpu->show_cycles_ninstrs_last = ninstrs;
+	cpu->show_cycles_mseconds_last = mseconds;
 }
 
 
@@ -499,6 +604,8 @@ void cpu_run_init(struct machine *machine)
 		/*  For performance measurement:  */
 		gettimeofday(&cpu->starttime, NULL);
 		cpu->ninstrs_since_gettimeofday = 0;
+		cpu->show_cycles_ninstrs_last = -1;
+		cpu->show_cycles_mseconds_last = 0;
 	}
 }
 
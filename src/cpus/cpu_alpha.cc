@@ -89,6 +89,8 @@ int alpha_cpu_new(struct cpu *cpu, struct memory *mem,
 	cpu->update_translation_table = alpha_update_translation_table;
 	cpu->invalidate_translation_caches =
 	    alpha_invalidate_translation_caches;
+	cpu->invalidate_translation_range =
+	    alpha_invalidate_translation_range;
 	cpu->invalidate_code_translation = alpha_invalidate_code_translation;
 
 	cpu->cd.alpha.cpu_type = cpu_type_defs[i];
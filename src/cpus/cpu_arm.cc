@@ -114,6 +114,8 @@ int arm_cpu_new(struct cpu *cpu, struct memory *mem,
 	cpu->update_translation_table = arm_update_translation_table;
 	cpu->invalidate_translation_caches =
 	    arm_invalidate_translation_caches;
+	cpu->invalidate_translation_range =
+	    arm_invalidate_translation_range;
 	cpu->invalidate_code_translation = arm_invalidate_code_translation;
 	cpu->translate_v2p = arm_translate_v2p;
 
@@ -179,6 +179,12 @@ int DYNTRANS_RUN_INSTR_DEF(struct cpu *cpu)
 	MODE_uint_t cached_pc;
 	int low_pc, n_instrs;
 
+#ifdef DYNTRANS_MIPS
+	/*  Native code area full? Then start over:  */
+	if (cpu->cd.mips.native_code_full)
+		mips_native_code_reset(cpu);
+#endif
+
 	/*  Ugly... fix this some day.  */
 #ifdef DYNTRANS_DUALMODE_32
 #ifdef MODE32
@@ -375,6 +381,44 @@ int DYNTRANS_RUN_INSTR_DEF(struct cpu *cpu)
 
 	n_instrs += cpu->n_translated_instrs;
 
+	/*
+	 *  Idle cpu? Then fast-forward to the next scheduled event, instead
+	 *  of spinning until then. The skipped cycles are counted as executed
+	 *  instructions, so that cycle counters and timers move ahead too.
+	 */
+	if (cpu->is_idle) {
+		int64_t skip = cpu_idle_cycles(cpu, n_instrs);
+
+		if (single_step)
+			skip = 0;
+
+#ifdef DYNTRANS_MIPS
+		/*  Don't skip past the count/compare interrupt:  */
+		if (cpu->cd.mips.cpu_type.exc_model != EXC3K &&
+		    cpu->cd.mips.compare_register_set &&
+		    cpu->machine->emulated_hz == 0) {
+			int32_t left = cpu->cd.mips.coproc[0]->reg[COP0_COMPARE]
+			    - (cpu->cd.mips.coproc[0]->reg[COP0_COUNT] -
+			    cpu->cd.mips.count_register_read_count + n_instrs);
+			if (left > 0 && left < skip)
+				skip = left;
+		}
+#endif
+#ifdef DYNTRANS_PPC
+		/*  Don't skip past the decrementer interrupt:  */
+		if (!(cpu->cd.ppc.cpu_type.flags & PPC_NO_DEC)) {
+			int32_t left = (int32_t) cpu->cd.ppc.spr[SPR_DEC]
+			    + 1 - n_instrs;
+			if ((int32_t) cpu->cd.ppc.spr[SPR_DEC] >= 0 &&
+			    left > 0 && left < skip)
+				skip = left;
+		}
+#endif
+
+		cpu_idle_sleep(cpu, skip);
+		n_instrs += skip;
+	}
+
 	/*  Synchronize the program counter:  */
 	low_pc = ((size_t)cpu->cd.DYNTRANS_ARCH.next_ic - (size_t)
 	    cpu->cd.DYNTRANS_ARCH.cur_ic_page) / sizeof(struct DYNTRANS_IC);
@@ -561,31 +605,157 @@ void DYNTRANS_FUNCTION_TRACE_DEF(struct cpu *cpu, int n_args)
 
 
 #ifdef DYNTRANS_TC_ALLOCATE_DEFAULT_PAGE_DEF
+/*
+ *  tc_physpage_size():
+ *
+ *  Physpages are allocated in fixed-size slots (aligned to 64 bytes), so that
+ *  the used part of the translation cache can be treated as an array.
+ */
+static inline size_t tc_physpage_size(void)
+{
+	return (sizeof(struct DYNTRANS_TC_PHYSPAGE) + 63) & ~(size_t)63;
+}
+
+
+/*
+ *  tc_reclaim_cold_pages():
+ *
+ *  Called when the translation cache is full, and there are no free pages
+ *  left. Instead of throwing away all translations, a clock algorithm is
+ *  used: pages which have been looked up (by pc_to_pointers_generic) since
+ *  the clock hand last passed them get a second chance, the others are
+ *  unlinked from their physpage chain and put on the free list.
+ *
+ *  Afterwards, all phys_page pointers in the virtual-to-physical tables are
+ *  cleared. Pages that are still in use will then be looked up again via the
+ *  generic path, which sets their referenced flag.
+ *
+ *  The page which the cpu is currently executing in is never reclaimed.
+ */
+static void tc_reclaim_cold_pages(struct cpu *cpu)
+{
+	const size_t slot = tc_physpage_size();
+	const size_t first = N_BASE_TABLE_ENTRIES * sizeof(uint32_t);
+	size_t n_slots = (cpu->translation_cache_cur_ofs - first) / slot;
+	size_t end = first + n_slots * slot;
+	size_t hand = cpu->translation_cache_clock_hand;
+	size_t n_to_free = n_slots / DYNTRANS_RECLAIM_FRACTION, n_freed = 0;
+	size_t n_visited = 0;
+
+	if (n_to_free < 1)
+		n_to_free = 1;
+
+	if (hand < first || hand >= end)
+		hand = first;
+
+	while (n_freed < n_to_free && n_visited < 2 * n_slots) {
+		struct DYNTRANS_TC_PHYSPAGE *ppp = (struct DYNTRANS_TC_PHYSPAGE *)
+		    (cpu->translation_cache + hand);
+
+		if (ppp->flags & TC_PHYSPAGE_FREE) {
+			/*  Already on the free list.  */
+		} else if (ppp->flags & TC_PHYSPAGE_REFERENCED ||
+		    &ppp->ics[0] == cpu->cd.DYNTRANS_ARCH.cur_ic_page) {
+			/*  Second chance:  */
+			ppp->flags &= ~TC_PHYSPAGE_REFERENCED;
+		} else {
+			/*  Unlink the page from its physpage chain:  */
+			int table_index = PAGENR_TO_TABLE_INDEX(
+			    DYNTRANS_ADDR_TO_PAGENR(ppp->physaddr));
+			uint32_t *ofsp = &(((uint32_t *)cpu->translation_cache)
+			    [table_index]);
+
+			while (*ofsp != 0 && *ofsp != hand)
+				ofsp = &((struct DYNTRANS_TC_PHYSPAGE *)(cpu->
+				    translation_cache + *ofsp))->next_ofs;
+
+			if (*ofsp != hand) {
+				fatal("tc_reclaim_cold_pages(): page not "
+				    "found in its chain?\n");
+				exit(1);
+			}
+
+			*ofsp = ppp->next_ofs;
+
+			ppp->flags = TC_PHYSPAGE_FREE;
+			ppp->next_ofs = cpu->translation_cache_free_ofs;
+			cpu->translation_cache_free_ofs = hand;
+			n_freed ++;
+		}
+
+		hand += slot;
+		if (hand >= end)
+			hand = first;
+		n_visited ++;
+	}
+
+	cpu->translation_cache_clock_hand = hand;
+
+	cpu->tc_stats.pages_evicted += n_freed;
+	cpu->tc_stats.reclaim_runs ++;
+
+#ifdef UNSTABLE_DEVEL
+	debug("[ dyntrans: reclaimed %i of %i translation cache pages ]\n",
+	    (int)n_freed, (int)n_slots);
+#endif
+
+	/*  There may still be phys_page pointers to the freed pages:  */
+	cpu->invalidate_code_translation(cpu, 0, INVALIDATE_ALL);
+}
+
+
 /*
  *  XXX_tc_allocate_default_page():
  *
- *  Create a default page (with just pointers to instr(to_be_translated)
- *  at cpu->translation_cache_cur_ofs.
+ *  Create a default page (with just pointers to instr(to_be_translated)),
+ *  and return its offset within the translation cache.
+ *
+ *  New pages are taken from the unused end of the translation cache. Once
+ *  that has been used up, previously reclaimed pages are reused.
  */
-static void DYNTRANS_TC_ALLOCATE_DEFAULT_PAGE_DEF(struct cpu *cpu,
+static uint32_t DYNTRANS_TC_ALLOCATE_DEFAULT_PAGE_DEF(struct cpu *cpu,
 	uint64_t physaddr)
 { 
 	struct DYNTRANS_TC_PHYSPAGE *ppp;
+	uint32_t ofs;
 
-	ppp = (struct DYNTRANS_TC_PHYSPAGE *)(cpu->translation_cache
-	    + cpu->translation_cache_cur_ofs);
+	if (cpu->translation_cache_cur_ofs < cpu->translation_cache_size) {
+		ofs = cpu->translation_cache_cur_ofs;
+		cpu->translation_cache_cur_ofs += tc_physpage_size();
+	} else {
+		if (cpu->translation_cache_free_ofs == 0)
+			tc_reclaim_cold_pages(cpu);
+
+		if (cpu->translation_cache_free_ofs == 0) {
+			/*
+			 *  Nothing could be reclaimed (e.g. a cache which is
+			 *  so small that it only holds the current page).
+			 *  Fall back to throwing away all translations.
+			 */
+			cpu_create_or_reset_tc(cpu);
+
+			ofs = cpu->translation_cache_cur_ofs;
+			cpu->translation_cache_cur_ofs += tc_physpage_size();
+		} else {
+			ofs = cpu->translation_cache_free_ofs;
+			ppp = (struct DYNTRANS_TC_PHYSPAGE *)
+			    (cpu->translation_cache + ofs);
+			cpu->translation_cache_free_ofs = ppp->next_ofs;
+		}
+	}
+
+	ppp = (struct DYNTRANS_TC_PHYSPAGE *)(cpu->translation_cache + ofs);
 
 	/*  Copy the entire template page first:  */
 	memcpy(ppp, cpu->cd.DYNTRANS_ARCH.physpage_template, sizeof(
 	    struct DYNTRANS_TC_PHYSPAGE));
 
 	ppp->physaddr = physaddr & ~(DYNTRANS_PAGESIZE - 1);
+	ppp->flags = TC_PHYSPAGE_REFERENCED;
 
-	cpu->translation_cache_cur_ofs += sizeof(struct DYNTRANS_TC_PHYSPAGE);
+	cpu->tc_stats.pages_allocated ++;
 
-	cpu->translation_cache_cur_ofs --;
-	cpu->translation_cache_cur_ofs |= 63;
-	cpu->translation_cache_cur_ofs ++;
+	return ofs;
 }
 #endif	/*  DYNTRANS_TC_ALLOCATE_DEFAULT_PAGE_DEF  */
 
@@ -730,13 +900,6 @@ void DYNTRANS_PC_TO_POINTERS_GENERIC(struct cpu *cpu)
 		}
 	}
 
-	if (cpu->translation_cache_cur_ofs >= dyntrans_cache_size) {
-#ifdef UNSTABLE_DEVEL
-		fatal("[ dyntrans: resetting the translation cache ]\n");
-#endif
-		cpu_create_or_reset_tc(cpu);
-	}
-
 	pagenr = DYNTRANS_ADDR_TO_PAGENR(physaddr);
 	table_index = PAGENR_TO_TABLE_INDEX(pagenr);
 
@@ -763,27 +926,26 @@ void DYNTRANS_PC_TO_POINTERS_GENERIC(struct cpu *cpu)
 	 *  the chain.
 	 */
 	if (physpage_ofs == 0) {
-		uint32_t previous_first_page_in_chain;
-
 		/*  fatal("CREATING page %lli (physaddr 0x%" PRIx64"), table "
 		    "index %i\n", (long long)pagenr, (uint64_t)physaddr,
 		    (int)table_index);  */
 
-		previous_first_page_in_chain = *physpage_entryp;
-
-		/*  Insert the new page first in the chain:  */
-		*physpage_entryp = physpage_ofs =
-		    cpu->translation_cache_cur_ofs;
-
-		/*  Allocate a default page, with to_be_translated entries:  */
-		DYNTRANS_TC_ALLOCATE(cpu, physaddr);
+		/*
+		 *  Allocate a default page, with to_be_translated entries.
+		 *
+		 *  Note: This may reclaim other pages, possibly from the
+		 *  same chain, so the chain must be read _after_ allocating.
+		 */
+		physpage_ofs = DYNTRANS_TC_ALLOCATE(cpu, physaddr);
 
 		ppp = (struct DYNTRANS_TC_PHYSPAGE *)(cpu->translation_cache
 		    + physpage_ofs);
 
-		/*  Point to the other pages in the same chain:  */
-		ppp->next_ofs = previous_first_page_in_chain;
-	}
+		/*  Insert the new page first in the chain:  */
+		ppp->next_ofs = *physpage_entryp;
+		*physpage_entryp = physpage_ofs;
+	} else
+		ppp->flags |= TC_PHYSPAGE_REFERENCED;
 
 	/*  Here, ppp points to a valid physical page struct.  */
 
@@ -872,6 +1034,14 @@ have_it:
 	cpu->cd.DYNTRANS_ARCH.next_ic = cpu->cd.DYNTRANS_ARCH.cur_ic_page +
 	    DYNTRANS_PC_TO_IC_ENTRY(cached_pc);
 
+	/*  Fill in the chain entry of a branch, if asked to:  */
+	if (cpu->translation_chain_fill != NULL) {
+		struct dyntrans_chain_entry *ce = cpu->translation_chain_fill;
+		ce->vaddr_page = cached_pc & ~(DYNTRANS_PAGESIZE - 1);
+		ce->ic_page = cpu->cd.DYNTRANS_ARCH.cur_ic_page;
+		ce->generation = cpu->translation_chain_generation;
+	}
+
 	/*  printf("cached_pc=0x%016" PRIx64"  pagenr=%lli  table_index=%lli, "
 	    "physpage_ofs=0x%016" PRIx64"\n", (uint64_t)cached_pc, (long long)
 	    pagenr, (long long)table_index, (uint64_t)physpage_ofs);  */
@@ -926,6 +1096,7 @@ void DYNTRANS_INIT_TABLES(struct cpu *cpu)
 	ppp->next_ofs = 0;
 	ppp->translations_bitmap = 0;
 	ppp->translation_ranges_ofs = 0;
+	ppp->flags = 0;
 	/*  ppp->physaddr is filled in by the page allocator  */
 
 	for (i=0; i<DYNTRANS_IC_ENTRIES_PER_PAGE; i++)
@@ -1003,12 +1174,15 @@ static void DYNTRANS_INVALIDATE_TLB_ENTRY(struct cpu *cpu,
 		cpu->cd.DYNTRANS_ARCH.host_store[index] = NULL;
 	} else {
 		int tlbi = cpu->cd.DYNTRANS_ARCH.vaddr_to_tlbindex[index];
+		DYNTRANS_CHAIN_INVALIDATE(cpu);
 		cpu->cd.DYNTRANS_ARCH.host_load[index] = NULL;
 		cpu->cd.DYNTRANS_ARCH.host_store[index] = NULL;
 		cpu->cd.DYNTRANS_ARCH.phys_addr[index] = 0;
 		cpu->cd.DYNTRANS_ARCH.phys_page[index] = NULL;
-		if (tlbi > 0)
+		if (tlbi > 0) {
 			cpu->cd.DYNTRANS_ARCH.vph_tlb_entry[tlbi-1].valid = 0;
+			cpu->tc_stats.translations_invalidated ++;
+		}
 		cpu->cd.DYNTRANS_ARCH.vaddr_to_tlbindex[index] = 0;
 	}
 #else
@@ -1037,6 +1211,8 @@ static void DYNTRANS_INVALIDATE_TLB_ENTRY(struct cpu *cpu,
 		return;
 	}
 
+	DYNTRANS_CHAIN_INVALIDATE(cpu);
+
 #ifdef BUGHUNT
 
 {
@@ -1117,6 +1293,7 @@ static void DYNTRANS_INVALIDATE_TLB_ENTRY(struct cpu *cpu,
 		cpu->cd.DYNTRANS_ARCH.vph_tlb_entry[
 		    l3->vaddr_to_tlbindex[x3] - 1].valid = 0;
 		l3->refcount --;
+		cpu->tc_stats.translations_invalidated ++;
 	} else {/*
 		printf("APA: vaddr_page=%016llx l3->refcount = %i\n", (long long)vaddr_page, l3->refcount);
 		for (int zz = 0; zz < 128; ++zz)
@@ -1200,6 +1377,8 @@ void DYNTRANS_INVALIDATE_TC(struct cpu *cpu, uint64_t addr, int flags)
 #endif
 	    addr_page = addr & ~(DYNTRANS_PAGESIZE - 1);
 
+	cpu->tc_stats.invalidations ++;
+
 	/*  fatal("invalidate(): ");  */
 
 	/*  Quick case for _one_ virtual addresses: see note above.  */
@@ -1232,6 +1411,11 @@ void DYNTRANS_INVALIDATE_TC(struct cpu *cpu, uint64_t addr, int flags)
 		return;
 	}
 
+#ifdef DYNTRANS_MIPS
+	/*  Translations saved for other ASIDs than the current one:  */
+	mips_asid_shadow_invalidate(cpu, addr_page, flags);
+#endif
+
 	/*  Invalidate everything:  */
 #ifdef DYNTRANS_PPC
 	if (flags & INVALIDATE_ALL && flags & INVALIDATE_VADDR_UPPER4) {
@@ -1291,6 +1475,51 @@ void DYNTRANS_INVALIDATE_TC(struct cpu *cpu, uint64_t addr, int flags)
 #endif	/*  DYNTRANS_INVALIDATE_TC  */
 
 
+#ifdef DYNTRANS_INVALIDATE_TC_RANGE
+/*
+ *  XXX_invalidate_translation_range():
+ *
+ *  Invalidate the translations of all virtual pages in the range vaddr ..
+ *  vaddr + len - 1. For large ranges (e.g. a 16 MB MIPS TLB page), this is
+ *  much cheaper than one INVALIDATE_VADDR call per page, since only the
+ *  translations that actually exist are looked at.
+ */
+void DYNTRANS_INVALIDATE_TC_RANGE(struct cpu *cpu, uint64_t vaddr,
+	uint64_t len)
+{
+	uint64_t mask = cpu->vaddr_mask, start;
+	int r;
+
+	cpu->tc_stats.invalidations ++;
+
+	start = vaddr & ~(uint64_t)(DYNTRANS_PAGESIZE - 1);
+	len += vaddr - start;
+
+#ifdef MODE32
+	mask &= 0xffffffffULL;
+
+	/*  A few pages are cheaper to invalidate one at a time:  */
+	if (len <= 8 * DYNTRANS_PAGESIZE) {
+		uint64_t ofs;
+		for (ofs = 0; ofs < len; ofs += DYNTRANS_PAGESIZE)
+			DYNTRANS_INVALIDATE_TLB_ENTRY(cpu,
+			    (uint32_t)(start + ofs), 0);
+		return;
+	}
+#endif
+
+	start &= mask;
+
+	for (r=0; r<DYNTRANS_MAX_VPH_TLB_ENTRIES; r++)
+		if (cpu->cd.DYNTRANS_ARCH.vph_tlb_entry[r].valid &&
+		    (cpu->cd.DYNTRANS_ARCH.vph_tlb_entry[r].vaddr_page
+		    & mask) - start < len)
+			DYNTRANS_INVALIDATE_TLB_ENTRY(cpu,
+			    cpu->cd.DYNTRANS_ARCH.vph_tlb_entry[r].vaddr_page, 0);
+}
+#endif	/*  DYNTRANS_INVALIDATE_TC_RANGE  */
+
+
 
 #ifdef DYNTRANS_INVALIDATE_TC_CODE
 /*
@@ -1298,8 +1527,20 @@ void DYNTRANS_INVALIDATE_TC(struct cpu *cpu, uint64_t addr, int flags)
  *
  *  Invalidate code translations for a specific physical address, a specific
  *  virtual address, or for all entries in the cache.
+ *
+ *  If INVALIDATE_PADDR_SUBPAGE is set together with INVALIDATE_PADDR, then
+ *  addr is the address of a (at most 8 bytes wide) write, and only the
+ *  translations in the part of the page that was written to (and the part
+ *  before it, which may hold combined instructions reaching into the written
+ *  part) are invalidated. If JUST_MARK_AS_NON_WRITABLE is also set, nothing
+ *  was written, and no translations are invalidated at all. (ARM and SH
+ *  always invalidate the whole page; see below.)
+ *
+ *  Returns 1 if INVALIDATE_PADDR was set and translations remain on the
+ *  page. The caller should then not map the page as writable, so that later
+ *  writes to it are noticed too. Otherwise 0 is returned.
  */
-void DYNTRANS_INVALIDATE_TC_CODE(struct cpu *cpu, uint64_t addr, int flags)
+int DYNTRANS_INVALIDATE_TC_CODE(struct cpu *cpu, uint64_t addr, int flags)
 {
 	int r;
 #ifdef MODE32
@@ -1308,9 +1549,16 @@ void DYNTRANS_INVALIDATE_TC_CODE(struct cpu *cpu, uint64_t addr, int flags)
 	uint64_t
 #endif
 	    vaddr_page, paddr_page;
+	int subpage_ofs = addr & (DYNTRANS_PAGESIZE-1);
 
 	addr &= ~(DYNTRANS_PAGESIZE-1);
 
+	/*
+	 *  Chained branches must not bypass pc_to_pointers for pages that
+	 *  need to be marked as non-writable again:
+	 */
+	DYNTRANS_CHAIN_INVALIDATE(cpu);
+
 	/*  printf("DYNTRANS_INVALIDATE_TC_CODE addr=0x%08x flags=%i\n",
 	    (int)addr, flags);  */
 
@@ -1329,7 +1577,7 @@ void DYNTRANS_INVALIDATE_TC_CODE(struct cpu *cpu, uint64_t addr, int flags)
 		/*  Return immediately if there is no code translation
 		    for this page.  */
 		if (physpage_ofs == 0)
-			return;
+			return 0;
 
 		prev_ppp = ppp = NULL;
 
@@ -1351,7 +1599,7 @@ void DYNTRANS_INVALIDATE_TC_CODE(struct cpu *cpu, uint64_t addr, int flags)
 		/*  If there is no translation, there is no need to go
 		    on and try to remove it from the vph_tlb_entry array:  */
 		if (physpage_ofs == 0)
-			return;
+			return 0;
 
 #if 0
 		/*
@@ -1382,20 +1630,48 @@ void DYNTRANS_INVALIDATE_TC_CODE(struct cpu *cpu, uint64_t addr, int flags)
 				urk Should be same type as the bitmap */
 			int i, j, n, m;
 
-#ifdef DYNTRANS_ARM
+			n = 8 * sizeof(x);
+			m = DYNTRANS_IC_ENTRIES_PER_PAGE / n;
+
+#if !defined(DYNTRANS_ARM) && !defined(DYNTRANS_SH)
+			if (flags & INVALIDATE_PADDR_SUBPAGE) {
+				int first = subpage_ofs /
+				    (DYNTRANS_PAGESIZE / n);
+				int last = (subpage_ofs + sizeof(uint64_t) - 1)
+				    / (DYNTRANS_PAGESIZE / n);
+
+				if (first > 0)
+					first --;
+				if (last >= n)
+					last = n - 1;
+
+				if (flags & JUST_MARK_AS_NON_WRITABLE)
+					x = 0;
+				else
+					x &= ((2U << last) - 1) &
+					    ~((1U << first) - 1);
+			}
+#else
 			/*
-			 *  Note: On ARM, PC-relative load instructions are
-			 *  implemented as immediate mov instructions. When
+			 *  Note: On ARM and SH, PC-relative load instructions
+			 *  are implemented as immediate mov instructions. When
 			 *  setting parts of the page to "to be translated",
 			 *  we cannot keep track of which of the immediate
 			 *  movs that were affected, so we need to clear
-			 *  the entire page. (ARM only; not for the general
-			 *  case.)
+			 *  the entire page. (The literal may be up to 4 KB
+			 *  away on ARM, and 1 KB on SH.)
 			 */
 			x = 0xffffffff;
+			(void)subpage_ofs;	// shut up compiler warning
 #endif
-			n = 8 * sizeof(x);
-			m = DYNTRANS_IC_ENTRIES_PER_PAGE / n;
+			ppp->translations_bitmap &= ~x;
+
+			if (x != 0) {
+				if (ppp->translations_bitmap != 0)
+					cpu->tc_stats.code_subpage_invalidations ++;
+				else
+					cpu->tc_stats.code_invalidations ++;
+			}
 
 			for (i=0; i<n; i++) {
 				if (x & 1) {
@@ -1407,7 +1683,9 @@ void DYNTRANS_INVALIDATE_TC_CODE(struct cpu *cpu, uint64_t addr, int flags)
 				x >>= 1;
 			}
 
-			ppp->translations_bitmap = 0;
+			/*  Other parts of the page still have translations:  */
+			if (ppp->translations_bitmap != 0)
+				return 1;
 
 			/*  Clear the list of translatable ranges:  */
 			if (ppp->translation_ranges_ofs != 0) {
@@ -1457,6 +1735,8 @@ void DYNTRANS_INVALIDATE_TC_CODE(struct cpu *cpu, uint64_t addr, int flags)
 			}
 		}
 	}
+
+	return 0;
 }
 #endif	/*  DYNTRANS_INVALIDATE_TC_CODE  */
 
@@ -1549,8 +1829,8 @@ void DYNTRANS_UPDATE_TRANSLATION_TABLE(struct cpu *cpu, uint64_t vaddr_page,
 
 	if (found < 0) {
 		/*  Create the new TLB entry, overwriting a "random" entry:  */
-		static unsigned int x = 0;
-		r = (x++) % DYNTRANS_MAX_VPH_TLB_ENTRIES;
+		r = (cpu->cd.DYNTRANS_ARCH.vph_tlb_replace_idx ++) %
+		    DYNTRANS_MAX_VPH_TLB_ENTRIES;
 
 		if (cpu->cd.DYNTRANS_ARCH.vph_tlb_entry[r].valid) {
 			/*  This one has to be invalidated first:  */
@@ -1689,6 +1969,7 @@ void DYNTRANS_UPDATE_TRANSLATION_TABLE(struct cpu *cpu, uint64_t vaddr_page,
 				cpu->cd.DYNTRANS_ARCH.host_store[index] = NULL;
 		} else {
 			/*  Change the entire physical/host mapping:  */
+			DYNTRANS_CHAIN_INVALIDATE(cpu);
 			cpu->cd.DYNTRANS_ARCH.host_load[index] = host_page;
 			cpu->cd.DYNTRANS_ARCH.host_store[index] =
 			    writeflag? host_page : NULL;
@@ -1708,6 +1989,7 @@ void DYNTRANS_UPDATE_TRANSLATION_TABLE(struct cpu *cpu, uint64_t vaddr_page,
 				l3->host_store[x3] = NULL;
 		} else {
 			/*  Change the entire physical/host mapping:  */
+			DYNTRANS_CHAIN_INVALIDATE(cpu);
 			l3->host_load[x3] = host_page;
 			l3->host_store[x3] = writeflag? host_page : NULL;
 			l3->phys_addr[x3] = paddr_page;
@@ -1810,10 +2092,24 @@ cpu->cd.DYNTRANS_ARCH.vph_tlb_entry[r].valid);
 		    translations_bitmap));
 		x /= addr_per_translation_range;
 
+		/*
+		 *  The first translation on a page whose translations were
+		 *  all invalidated (e.g. by a write to the page) must mark
+		 *  the page as non-writable again. Same-page branches don't
+		 *  go through pc_to_pointers, which otherwise does this.
+		 */
+		if (cpu->cd.DYNTRANS_ARCH.cur_physpage->
+		    translations_bitmap == 0)
+			cpu->invalidate_translation_caches(cpu,
+			    cpu->cd.DYNTRANS_ARCH.cur_physpage->physaddr,
+			    JUST_MARK_AS_NON_WRITABLE | INVALIDATE_PADDR);
+
 		cpu->cd.DYNTRANS_ARCH.cur_physpage->
 		    translations_bitmap |= (1 << x);
 	}
 
+	cpu->tc_stats.instrs_translated ++;
+
 
 	/*
 	 *  Now it is time to check for combinations of instructions that can
@@ -1836,6 +2132,18 @@ cpu->cd.DYNTRANS_ARCH.vph_tlb_entry[r].valid);
 
 	cpu->cd.DYNTRANS_ARCH.combination_check = NULL;
 
+#ifdef DYNTRANS_NATIVE_CODE_CHECK
+	/*  Translate runs of simple instructions into native code:  */
+	if (!single_step && !cpu->machine->instruction_trace
+#ifdef DYNTRANS_DELAYSLOT
+	    && !in_crosspage_delayslot
+#endif
+	    && cpu->machine->breakpoints.n == 0
+	    && cpu->machine->native_code_translation)
+		DYNTRANS_NATIVE_CODE_CHECK(cpu, ic,
+		    addr & (DYNTRANS_PAGESIZE - 1));
+#endif
+
 	/*  An additional check, to catch some bugs:  */
 	if (ic->f == TO_BE_TRANSLATED) {
 		fatal("INTERNAL ERROR: ic->f not set!\n");
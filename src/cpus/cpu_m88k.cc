@@ -121,6 +121,8 @@ int m88k_cpu_new(struct cpu *cpu, struct memory *mem,
 	cpu->update_translation_table = m88k_update_translation_table;
 	cpu->invalidate_translation_caches =
 	    m88k_invalidate_translation_caches;
+	cpu->invalidate_translation_range =
+	    m88k_invalidate_translation_range;
 	cpu->invalidate_code_translation = m88k_invalidate_code_translation;
 	cpu->translate_v2p = m88k_translate_v2p;
 
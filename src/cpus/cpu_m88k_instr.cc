@@ -1722,9 +1722,7 @@ X(idle)
 
 	if (v == 0) {
 		SYNCH_PC;
-		usleep(50);
-		cpu->has_been_idling = 1;
-		cpu->n_translated_instrs += N_SAFE_DYNTRANS_LIMIT / 2;
+		cpu_idle(cpu);
 		cpu->cd.m88k.next_ic = &nothing_call;
 	} else {
 		cpu->n_translated_instrs ++;
@@ -1764,9 +1762,7 @@ X(idle_with_tb1)
 
 	if (v == 0) {
 		SYNCH_PC;
-		usleep(50);
-		cpu->has_been_idling = 1;
-		cpu->n_translated_instrs += N_SAFE_DYNTRANS_LIMIT / 2;
+		cpu_idle(cpu);
 		cpu->cd.m88k.next_ic = &nothing_call;
 	} else {
 		cpu->n_translated_instrs += 2;
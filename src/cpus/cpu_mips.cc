@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <ctype.h>
 #include <unistd.h>
 
@@ -123,6 +124,8 @@ int mips_cpu_new(struct cpu *cpu, struct memory *mem, struct machine *machine,
 		cpu->update_translation_table = mips32_update_translation_table;
 		cpu->invalidate_translation_caches =
 		    mips32_invalidate_translation_caches;
+		cpu->invalidate_translation_range =
+		    mips32_invalidate_translation_range;
 		cpu->invalidate_code_translation =
 		    mips32_invalidate_code_translation;
 	} else {
@@ -130,12 +133,17 @@ int mips_cpu_new(struct cpu *cpu, struct memory *mem, struct machine *machine,
 		cpu->update_translation_table = mips_update_translation_table;
 		cpu->invalidate_translation_caches =
 		    mips_invalidate_translation_caches;
+		cpu->invalidate_translation_range =
+		    mips_invalidate_translation_range;
 		cpu->invalidate_code_translation =
 		    mips_invalidate_code_translation;
 	}
 
 	cpu->instruction_has_delayslot = mips_cpu_instruction_has_delayslot;
 
+	if (cpu->machine->native_code_translation)
+		mips_native_code_init(cpu);
+
 	if (cpu_id == 0)
 		debug("%s", cpu->cd.mips.cpu_type.name);
 
@@ -348,6 +348,63 @@ static void initialize_cop1(struct cpu *cpu, struct mips_coproc *c)
 }
 
 
+/*
+ *  tlb_hash_update():
+ *
+ *  Move TLB entry nr index to the hash bucket that matches its current
+ *  contents. This must be called whenever an entry's hi or mask changes,
+ *  since the lookup in memory_mips_v2p.cc only looks in the buckets.
+ */
+static void tlb_hash_update(struct cpu *cpu, struct mips_coproc *cp,
+	int index)
+{
+	struct mips_tlb_hash *h = &cp->tlb_hash[index];
+	int pageshift, bucket;
+	uint64_t tmp;
+
+	/*  Page size of the entry (half of the "dual page"):  */
+	if (cpu->cd.mips.cpu_type.mmu_model == MMU3K) {
+		pageshift = 12;
+		tmp = 0;
+	} else if (cpu->cd.mips.cpu_type.rev == MIPS_R4100) {
+		pageshift = 10;
+		tmp = (cp->tlbs[index].mask & PAGEMASK_MASK_R4100)
+		    >> PAGEMASK_SHIFT_R4100;
+	} else {
+		pageshift = 12;
+		tmp = (cp->tlbs[index].mask & PAGEMASK_MASK) >> PAGEMASK_SHIFT;
+	}
+	while (tmp & 1) {
+		tmp >>= 1;
+		pageshift ++;
+	}
+
+	bucket = MIPS_TLB_HASH(cp->tlbs[index].hi, pageshift);
+	if (bucket == h->bucket && pageshift == h->pageshift)
+		return;
+
+	/*  Unlink from the old bucket:  */
+	if (h->bucket >= 0) {
+		int16_t *p = &cp->tlb_hash_head[h->bucket];
+		while (*p != index)
+			p = &cp->tlb_hash[*p].next;
+		*p = h->next;
+
+		if (--cp->tlb_pageshift_count[h->pageshift] == 0)
+			cp->tlb_pageshifts &= ~(1 << h->pageshift);
+	}
+
+	/*  ... and insert into the new one:  */
+	h->bucket = bucket;
+	h->pageshift = pageshift;
+	h->next = cp->tlb_hash_head[bucket];
+	cp->tlb_hash_head[bucket] = index;
+
+	cp->tlb_pageshift_count[pageshift] ++;
+	cp->tlb_pageshifts |= 1 << pageshift;
+}
+
+
 /*
  *  mips_coproc_new():
  *
@@ -356,6 +413,7 @@ static void initialize_cop1(struct cpu *cpu, struct mips_coproc *c)
 struct mips_coproc *mips_coproc_new(struct cpu *cpu, int coproc_nr)
 {
 	struct mips_coproc *c;
+	int i;
 
 	CHECK_ALLOCATION(c = (struct mips_coproc *) malloc(sizeof(struct mips_coproc)));
 	memset(c, 0, sizeof(struct mips_coproc));
@@ -366,6 +424,15 @@ struct mips_coproc *mips_coproc_new(struct cpu *cpu, int coproc_nr)
 		c->nr_of_tlbs = cpu->cd.mips.cpu_type.nr_of_tlb_entries;
 		c->tlbs = (struct mips_tlb *) zeroed_alloc(c->nr_of_tlbs * sizeof(struct mips_tlb));
 
+		CHECK_ALLOCATION(c->tlb_hash = (struct mips_tlb_hash *)
+		    malloc(c->nr_of_tlbs * sizeof(struct mips_tlb_hash)));
+		for (i=0; i<MIPS_TLB_HASH_SIZE; i++)
+			c->tlb_hash_head[i] = -1;
+		for (i=0; i<c->nr_of_tlbs; i++) {
+			c->tlb_hash[i].bucket = -1;
+			tlb_hash_update(cpu, c, i);
+		}
+
 		/*
 		 *  Start with nothing in the status register. This makes sure
 		 *  that we are running in kernel mode with all interrupts
@@ -497,6 +564,149 @@ void mips_coproc_tlb_set_entry(struct cpu *cpu, int entrynr, int size,
 		    ((cachealgo1 << ENTRYLO_C_SHIFT) & ENTRYLO_C_MASK);
 		/*  TODO: R4100, 1KB pages etc  */
 	}
+
+	tlb_hash_update(cpu, cpu->cd.mips.coproc[0], entrynr);
+}
+
+
+/*
+ *  asid_shadow_find():
+ *
+ *  Returns the shadow for an ASID, or NULL if there is none. If create is
+ *  set, then an unused (or the least recently used) shadow is taken over
+ *  for the ASID, instead of returning NULL.
+ */
+static struct mips_asid_shadow *asid_shadow_find(struct cpu *cpu,
+	unsigned int asid, int create)
+{
+	struct mips_asid_shadow *sh = cpu->cd.mips.asid_shadow, *victim = sh;
+	int i;
+
+	for (i=0; i<MIPS_N_ASID_SHADOWS; i++) {
+		if (sh[i].n_entries > 0 && sh[i].asid == asid)
+			return &sh[i];
+		if (victim->n_entries > 0 && (sh[i].n_entries == 0 ||
+		    sh[i].last_used < victim->last_used))
+			victim = &sh[i];
+	}
+
+	if (!create)
+		return NULL;
+
+	victim->asid = asid;
+	victim->n_entries = 0;
+	return victim;
+}
+
+
+/*
+ *  asid_shadow_restore():
+ *
+ *  Put back the translations which were saved the last time the cpu switched
+ *  away from an ASID.
+ */
+static void asid_shadow_restore(struct cpu *cpu, unsigned int asid)
+{
+	struct mips_asid_shadow *sh = asid_shadow_find(cpu, asid, 0);
+	int i;
+
+	if (sh == NULL)
+		return;
+
+	for (i=0; i<sh->n_entries; i++)
+		cpu->update_translation_table(cpu, sh->entry[i].vaddr_page,
+		    sh->entry[i].host_page, sh->entry[i].writeflag,
+		    sh->entry[i].paddr_page);
+
+	sh->n_entries = 0;
+}
+
+
+/*
+ *  asid_shadow_drop_range():
+ *
+ *  Forget saved translations (for any ASID) of virtual addresses in the
+ *  range vaddr .. vaddr + size - 1. Used when a TLB entry is overwritten.
+ */
+static void asid_shadow_drop_range(struct cpu *cpu, uint64_t vaddr,
+	uint64_t size)
+{
+	uint64_t mask = cpu->vaddr_mask != 0? cpu->vaddr_mask : (uint64_t)-1;
+	int i, j;
+
+	vaddr &= mask;
+
+	for (i=0; i<MIPS_N_ASID_SHADOWS; i++) {
+		struct mips_asid_shadow *sh = &cpu->cd.mips.asid_shadow[i];
+
+		for (j=0; j<sh->n_entries; j++)
+			if ((sh->entry[j].vaddr_page & mask) - vaddr < size) {
+				sh->entry[j] = sh->entry[-- sh->n_entries];
+				j --;
+			}
+	}
+}
+
+
+/*
+ *  mips_asid_shadow_invalidate():
+ *
+ *  Called when translations are invalidated by physical address, or all at
+ *  once, so that saved translations of other ASIDs are invalidated too.
+ */
+void mips_asid_shadow_invalidate(struct cpu *cpu, uint64_t paddr_page,
+	int flags)
+{
+	int i, j;
+
+	for (i=0; i<MIPS_N_ASID_SHADOWS; i++) {
+		struct mips_asid_shadow *sh = &cpu->cd.mips.asid_shadow[i];
+
+		if (flags & INVALIDATE_ALL) {
+			sh->n_entries = 0;
+			continue;
+		}
+
+		for (j=0; j<sh->n_entries; j++) {
+			if (sh->entry[j].paddr_page != paddr_page)
+				continue;
+			if (flags & JUST_MARK_AS_NON_WRITABLE)
+				sh->entry[j].writeflag = 0;
+			else {
+				sh->entry[j] = sh->entry[-- sh->n_entries];
+				j --;
+			}
+		}
+	}
+}
+
+
+/*
+ *  invalidate_asid_range():
+ *
+ *  Invalidate the translations of virtual addresses in the range vaddr ..
+ *  vaddr + size - 1, after saving them in the shadow sh (if there is room).
+ */
+static void invalidate_asid_range(struct cpu *cpu, struct mips_asid_shadow *sh,
+	uint64_t vaddr, uint64_t size)
+{
+	uint64_t mask = cpu->vaddr_mask != 0? cpu->vaddr_mask : (uint64_t)-1;
+	int r;
+
+	vaddr &= mask;
+
+	for (r=0; r<MIPS_MAX_VPH_TLB_ENTRIES; r++) {
+		struct mips_vpg_tlb_entry *e = &cpu->cd.mips.vph_tlb_entry[r];
+
+		if (!e->valid || (e->vaddr_page & mask) - vaddr >= size)
+			continue;
+
+		if (sh->n_entries < MIPS_ASID_SHADOW_ENTRIES)
+			sh->entry[sh->n_entries ++] = *e;
+
+		cpu->invalidate_translation_caches(cpu, e->vaddr_page,
+		    INVALIDATE_VADDR);
+	}
 }
 
 
@@ -505,7 +715,10 @@ void mips_coproc_tlb_set_entry(struct cpu *cpu, int entrynr, int size,
  *
  *  Go through all entries in the TLB. If an entry has a matching asid, is
  *  valid, and is not global (i.e. the ASID matters), then its virtual address
- *  translation is invalidated.
+ *  translations are saved in the asid's shadow, and invalidated.
+ *
+ *  Rather than invalidating every 4 KB part of each (possibly large) TLB
+ *  entry, only the translations that actually exist are looked at.
  *
  *  Note: In the R3000 case, the asid argument is shifted 6 bits.
  */
@@ -514,15 +727,18 @@ static void invalidate_asid(struct cpu *cpu, unsigned int asid)
 	struct mips_coproc *cp = cpu->cd.mips.coproc[0];
 	unsigned int i, ntlbs = cp->nr_of_tlbs;
 	struct mips_tlb *tlb = cp->tlbs;
+	struct mips_asid_shadow *sh = asid_shadow_find(cpu, asid, 1);
+
+	sh->last_used = ++ cpu->cd.mips.asid_shadow_clock;
 
 	if (cpu->cd.mips.cpu_type.mmu_model == MMU3K) {
 		for (i = 0; i < ntlbs; i++)
 			if ((tlb[i].hi & R2K3K_ENTRYHI_ASID_MASK) == asid
 			    && (tlb[i].lo0 & R2K3K_ENTRYLO_V)
 			    && !(tlb[i].lo0 & R2K3K_ENTRYLO_G)) {
-				cpu->invalidate_translation_caches(cpu,
-				    tlb[i].hi & R2K3K_ENTRYHI_VPN_MASK,
-				    INVALIDATE_VADDR);
+				invalidate_asid_range(cpu, sh,
+				    (int32_t)(tlb[i].hi &
+				    R2K3K_ENTRYHI_VPN_MASK), 0x1000);
 			}
 	} else {
 		for (i = 0; i < ntlbs; i++) {
@@ -555,20 +771,33 @@ static void invalidate_asid(struct cpu *cpu, unsigned int asid)
 			mask |= 0x1fff;
 			oldvaddr &= ~mask;
 
-			// printf("pagesize = %016llx mask = %016llx\n", pagesize, mask);
-			
 			if (cp->tlbs[i].lo0 & ENTRYLO_V)
-				for (uint64_t ofs = 0; ofs < pagesize; ofs += 0x1000)
-					cpu->invalidate_translation_caches(cpu, oldvaddr + ofs, INVALIDATE_VADDR);
-			
+				invalidate_asid_range(cpu, sh, oldvaddr,
+				    pagesize);
+
 			if (cp->tlbs[i].lo1 & ENTRYLO_V)
-				for (uint64_t ofs = 0; ofs < pagesize; ofs += 0x1000)
-					cpu->invalidate_translation_caches(cpu, oldvaddr + ofs + pagesize, INVALIDATE_VADDR);
+				invalidate_asid_range(cpu, sh,
+				    oldvaddr + pagesize, pagesize);
 		}
 	}
 }
 
 
+/*
+ *  switch_asid():
+ *
+ *  Called when the ASID in EntryHi changes. The translations of the old
+ *  ASID are put aside, and those of the new ASID (if any were saved) are
+ *  put back.
+ */
+static void switch_asid(struct cpu *cpu, unsigned int old_asid,
+	unsigned int new_asid)
+{
+	invalidate_asid(cpu, old_asid);
+	asid_shadow_restore(cpu, new_asid);
+}
+
+
 /*
  *  coproc_register_read();
  *
@@ -658,8 +887,7 @@ void coproc_register_write(struct cpu *cpu,
 	int readonly = 0;
 	uint64_t tmp = *ptr;
 	uint64_t tmp2 = 0, old;
-	int inval = 0;
-	unsigned int old_asid;
+	unsigned int old_asid, new_asid;
 	uint64_t oldmode;
 
 	switch (cp->coproc_nr) {
@@ -795,7 +1023,8 @@ void coproc_register_write(struct cpu *cpu,
 				if (hz > 0) {
 					if (cpu->cd.mips.timer == NULL)
 						cpu->cd.mips.timer = timer_add(
-						    hz, mips_timer_tick, cpu);
+						    cpu->machine, hz,
+						    mips_timer_tick, cpu);
 					else
 						timer_update_frequency(
 						    cpu->cd.mips.timer, hz);
@@ -821,27 +1050,23 @@ void coproc_register_write(struct cpu *cpu,
 		case COP0_ENTRYHI:
 			/*
 			 *  Translation caches must be invalidated if the
-			 *  ASID changes:
+			 *  ASID changes. (The old ASID's translations are
+			 *  kept in a shadow; see switch_asid().)
 			 */
 			switch (cpu->cd.mips.cpu_type.mmu_model) {
 			case MMU3K:
 				old_asid = cp->reg[COP0_ENTRYHI] &
 				    R2K3K_ENTRYHI_ASID_MASK;
-				if ((cp->reg[COP0_ENTRYHI] &
-				    R2K3K_ENTRYHI_ASID_MASK) !=
-				    (tmp & R2K3K_ENTRYHI_ASID_MASK))
-					inval = 1;
+				new_asid = tmp & R2K3K_ENTRYHI_ASID_MASK;
 				break;
 			default:
 				old_asid = cp->reg[COP0_ENTRYHI] & ENTRYHI_ASID;
-				if ((cp->reg[COP0_ENTRYHI] & ENTRYHI_ASID) !=
-				    (tmp & ENTRYHI_ASID))
-					inval = 1;
+				new_asid = tmp & ENTRYHI_ASID;
 				break;
 			}
 
-			if (inval)
-				invalidate_asid(cpu, old_asid);
+			if (old_asid != new_asid)
+				switch_asid(cpu, old_asid, new_asid);
 
 			unimpl = 0;
 			if (cpu->cd.mips.cpu_type.mmu_model == MMU3K &&
@@ -1517,6 +1742,7 @@ void coproc_tlbpr(struct cpu *cpu, int readflag)
 	struct mips_coproc *cp = cpu->cd.mips.coproc[0];
 	int i, found, g_bit;
 	uint64_t vpn2, xmask;
+	unsigned int old_asid;
 
 	/*  Read:  */
 	if (readflag) {
@@ -1530,8 +1756,16 @@ void coproc_tlbpr(struct cpu *cpu, int readflag)
 				return;
 			}
 
+			old_asid = cp->reg[COP0_ENTRYHI] &
+			    R2K3K_ENTRYHI_ASID_MASK;
 			cp->reg[COP0_ENTRYHI]  = cp->tlbs[i].hi;
 			cp->reg[COP0_ENTRYLO0] = cp->tlbs[i].lo0;
+
+			/*  Reading a TLB entry may change the ASID:  */
+			if (old_asid != (cp->reg[COP0_ENTRYHI] &
+			    R2K3K_ENTRYHI_ASID_MASK))
+				switch_asid(cpu, old_asid, cp->reg[
+				    COP0_ENTRYHI] & R2K3K_ENTRYHI_ASID_MASK);
 		} else {
 			/*  R4000:  */
 			i = cp->reg[COP0_INDEX] & INDEX_MASK;
@@ -1542,11 +1776,17 @@ void coproc_tlbpr(struct cpu *cpu, int readflag)
 				return;
 			}
 
+			old_asid = cp->reg[COP0_ENTRYHI] & ENTRYHI_ASID;
 			cp->reg[COP0_PAGEMASK] = cp->tlbs[i].mask;
 			cp->reg[COP0_ENTRYHI]  = cp->tlbs[i].hi;
 			cp->reg[COP0_ENTRYLO1] = cp->tlbs[i].lo1;
 			cp->reg[COP0_ENTRYLO0] = cp->tlbs[i].lo0;
 
+			/*  Reading a TLB entry may change the ASID:  */
+			if (old_asid != (cp->reg[COP0_ENTRYHI] & ENTRYHI_ASID))
+				switch_asid(cpu, old_asid,
+				    cp->reg[COP0_ENTRYHI] & ENTRYHI_ASID);
+
 			if (cpu->cd.mips.cpu_type.rev == MIPS_R4100) {
 				/*  R4100 don't have the G bit in entryhi  */
 			} else {
@@ -1710,6 +1950,8 @@ void coproc_tlbwri(struct cpu *cpu, int randomflag)
 			cpu->invalidate_translation_caches(cpu, oldvaddr,
 			    INVALIDATE_VADDR);
 
+		/*  Translations saved for other ASIDs may be stale too:  */
+		asid_shadow_drop_range(cpu, oldvaddr, 0x1000);
 		break;
 
 	default:if (cpu->cd.mips.cpu_type.mmu_model == MMU10K) {
@@ -1752,12 +1994,16 @@ void coproc_tlbwri(struct cpu *cpu, int randomflag)
 			// printf("pagesize = %016llx mask = %016llx\n", pagesize, mask);
 			
 			if (cp->tlbs[index].lo0 & ENTRYLO_V)
-				for (uint64_t ofs = 0; ofs < pagesize; ofs += 0x1000)
-					cpu->invalidate_translation_caches(cpu, oldvaddr + ofs, INVALIDATE_VADDR);
-			
+				cpu->invalidate_translation_range(cpu,
+				    oldvaddr, pagesize);
+
 			if (cp->tlbs[index].lo1 & ENTRYLO_V)
-				for (uint64_t ofs = 0; ofs < pagesize; ofs += 0x1000)
-					cpu->invalidate_translation_caches(cpu, oldvaddr + ofs + pagesize, INVALIDATE_VADDR);
+				cpu->invalidate_translation_range(cpu,
+				    oldvaddr + pagesize, pagesize);
+
+			/*  Translations saved for other ASIDs may be stale
+			    too:  */
+			asid_shadow_drop_range(cpu, oldvaddr, 2 * pagesize);
 		}
 	}
 
@@ -1811,6 +2057,7 @@ void coproc_tlbwri(struct cpu *cpu, int randomflag)
 
 		cp->tlbs[index].hi = cp->reg[COP0_ENTRYHI];
 		cp->tlbs[index].lo0 = cp->reg[COP0_ENTRYLO0];
+		tlb_hash_update(cpu, cp, index);
 
 		vaddr =  cp->reg[COP0_ENTRYHI] & R2K3K_ENTRYHI_VPN_MASK;
 		paddr = cp->reg[COP0_ENTRYLO0] & R2K3K_ENTRYLO_PFN_MASK;
@@ -1822,9 +2069,6 @@ void coproc_tlbwri(struct cpu *cpu, int randomflag)
 			    INVALIDATE_PADDR);
 		}
 
-		/*  Set new last_written_tlb_index hint:  */
-		cpu->cd.mips.last_written_tlb_index = index;
-
 		if (cp->reg[COP0_STATUS] & MIPS1_ISOL_CACHES) {
 			fatal("Wow! Interesting case; tlbw* while caches"
 			    " are isolated. TODO\n");
@@ -1918,6 +2162,8 @@ void coproc_tlbwri(struct cpu *cpu, int randomflag)
 				cp->tlbs[index].hi |= TLB_G;
 		}
 
+		tlb_hash_update(cpu, cp, index);
+
 		/*
 		 *  Invalidate any code translations, if we are writing Dirty
 		 *  pages to the TLB:
@@ -1956,9 +2202,6 @@ void coproc_tlbwri(struct cpu *cpu, int randomflag)
 					cpu->update_translation_table(cpu, vaddr1, memblock, wf1, paddr1);
 			}
 		}
-
-		/*  Set new last_written_tlb_index hint:  */
-		cpu->cd.mips.last_written_tlb_index = index;
 	}
 }
 
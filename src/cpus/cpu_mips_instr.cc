@@ -189,7 +189,7 @@ X(beq)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -246,7 +246,7 @@ X(bne)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -300,7 +300,7 @@ X(b)
 		old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 		    MIPS_INSTR_ALIGNMENT_SHIFT);
 		cpu->pc = old_pc + (int32_t)ic->arg[2];
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -313,6 +313,23 @@ X(b_samepage)
 		cpu->cd.mips.next_ic = (struct mips_instr_call *) ic->arg[2];
 	cpu->delay_slot = NOT_DELAYED;
 }
+X(b_samepage_nop)
+{
+	cpu->n_translated_instrs ++;
+	cpu->cd.mips.next_ic = (struct mips_instr_call *) ic->arg[2];
+}
+
+
+/*
+ *  b_self_nop:  "1: b 1b; nop", an idle loop which only an interrupt can
+ *               get out of. Skip ahead to the next event.
+ */
+X(b_self_nop)
+{
+	cpu->n_translated_instrs ++;
+	cpu->cd.mips.next_ic = ic;
+	cpu_idle(cpu);
+}
 
 
 /*
@@ -339,7 +356,7 @@ X(beql)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -378,7 +395,7 @@ X(bnel)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -425,7 +442,7 @@ X(blez)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -447,6 +464,15 @@ X(blez_samepage)
 	}
 	cpu->delay_slot = NOT_DELAYED;
 }
+X(blez_samepage_nop)
+{
+	MODE_int_t rs = reg(ic->arg[0]);
+	cpu->n_translated_instrs ++;
+	if (rs <= 0)
+		cpu->cd.mips.next_ic = (struct mips_instr_call *) ic->arg[2];
+	else
+		cpu->cd.mips.next_ic ++;
+}
 X(blezl)
 {
 	MODE_int_t old_pc = cpu->pc;
@@ -463,7 +489,7 @@ X(blezl)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -510,7 +536,7 @@ X(bltz)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -532,6 +558,15 @@ X(bltz_samepage)
 	}
 	cpu->delay_slot = NOT_DELAYED;
 }
+X(bltz_samepage_nop)
+{
+	MODE_int_t rs = reg(ic->arg[0]);
+	cpu->n_translated_instrs ++;
+	if (rs < 0)
+		cpu->cd.mips.next_ic = (struct mips_instr_call *) ic->arg[2];
+	else
+		cpu->cd.mips.next_ic ++;
+}
 X(bltzl)
 {
 	MODE_int_t old_pc = cpu->pc;
@@ -548,7 +583,7 @@ X(bltzl)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -595,7 +630,7 @@ X(bgez)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -617,6 +652,15 @@ X(bgez_samepage)
 	}
 	cpu->delay_slot = NOT_DELAYED;
 }
+X(bgez_samepage_nop)
+{
+	MODE_int_t rs = reg(ic->arg[0]);
+	cpu->n_translated_instrs ++;
+	if (rs >= 0)
+		cpu->cd.mips.next_ic = (struct mips_instr_call *) ic->arg[2];
+	else
+		cpu->cd.mips.next_ic ++;
+}
 X(bgezl)
 {
 	MODE_int_t old_pc = cpu->pc;
@@ -633,7 +677,7 @@ X(bgezl)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -688,7 +732,7 @@ X(bgezal)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -742,7 +786,7 @@ X(bgezall)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -805,7 +849,7 @@ X(bltzal)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -859,7 +903,7 @@ X(bltzall)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -914,7 +958,7 @@ X(bgtz)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -936,6 +980,15 @@ X(bgtz_samepage)
 	}
 	cpu->delay_slot = NOT_DELAYED;
 }
+X(bgtz_samepage_nop)
+{
+	MODE_int_t rs = reg(ic->arg[0]);
+	cpu->n_translated_instrs ++;
+	if (rs > 0)
+		cpu->cd.mips.next_ic = (struct mips_instr_call *) ic->arg[2];
+	else
+		cpu->cd.mips.next_ic ++;
+}
 X(bgtzl)
 {
 	MODE_int_t old_pc = cpu->pc;
@@ -952,7 +1005,7 @@ X(bgtzl)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -994,7 +1047,7 @@ X(jr)
 		cpu->pc = rs;
 		/*  Note: Must be non-delayed when jumping to the new pc:  */
 		cpu->delay_slot = NOT_DELAYED;
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -1008,7 +1061,7 @@ X(jr_ra)
 		cpu->pc = rs;
 		/*  Note: Must be non-delayed when jumping to the new pc:  */
 		cpu->delay_slot = NOT_DELAYED;
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -1019,7 +1072,14 @@ X(jr_ra_addiu)
 	reg(ic[1].arg[1]) = (int32_t)
 	    ((int32_t)reg(ic[1].arg[0]) + (int32_t)ic[1].arg[2]);
 	cpu->pc = rs;
-	quick_pc_to_pointers(cpu);
+	chained_pc_to_pointers(cpu, ic);
+	cpu->n_translated_instrs ++;
+}
+X(jr_ra_nop)
+{
+	/*  jr ra, followed by a nop  */
+	cpu->pc = cpu->cd.mips.gpr[MIPS_GPR_RA];
+	chained_pc_to_pointers(cpu, ic);
 	cpu->n_translated_instrs ++;
 }
 X(jr_ra_trace)
@@ -1033,7 +1093,7 @@ X(jr_ra_trace)
 		cpu_functioncall_trace_return(cpu);
 		/*  Note: Must be non-delayed when jumping to the new pc:  */
 		cpu->delay_slot = NOT_DELAYED;
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -1051,7 +1111,7 @@ X(jalr)
 		cpu->pc = rs;
 		/*  Note: Must be non-delayed when jumping to the new pc:  */
 		cpu->delay_slot = NOT_DELAYED;
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -1070,7 +1130,7 @@ X(jalr_trace)
 		cpu_functioncall_trace(cpu, cpu->pc);
 		/*  Note: Must be non-delayed when jumping to the new pc:  */
 		cpu->delay_slot = NOT_DELAYED;
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -1093,7 +1153,7 @@ X(j)
 		cpu->delay_slot = NOT_DELAYED;
 		old_pc &= ~0x03ffffff;
 		cpu->pc = old_pc | (uint32_t)ic->arg[0];
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -1110,7 +1170,7 @@ X(jal)
 		cpu->delay_slot = NOT_DELAYED;
 		old_pc &= ~0x03ffffff;
 		cpu->pc = old_pc | (int32_t)ic->arg[0];
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -1128,7 +1188,7 @@ X(jal_trace)
 		old_pc &= ~0x03ffffff;
 		cpu->pc = old_pc | (int32_t)ic->arg[0];
 		cpu_functioncall_trace(cpu, cpu->pc);
-		quick_pc_to_pointers(cpu);
+		chained_pc_to_pointers(cpu, ic);
 	} else
 		cpu->delay_slot = NOT_DELAYED;
 }
@@ -2072,7 +2132,7 @@ X(cop1_bc)
 			old_pc &= ~((MIPS_IC_ENTRIES_PER_PAGE-1) <<
 			    MIPS_INSTR_ALIGNMENT_SHIFT);
 			cpu->pc = old_pc + (int32_t)ic->arg[2];
-			quick_pc_to_pointers(cpu);
+			chained_pc_to_pointers(cpu, ic);
 		} else
 			cpu->cd.mips.next_ic ++;
 	} else
@@ -2323,27 +2383,13 @@ X(idle)
 
 	cpu->cd.mips.next_ic = ic;
 	cpu->is_halted = 1;
-	cpu->has_been_idling = 1;
 
 	/*
-	 *  There was no interrupt. Go to sleep.
-	 *
-	 *  TODO:
-	 *
-	 *  Think about how to actually implement this usleep stuff,
-	 *  in an SMP and/or timing accurate environment.
+	 *  There was no interrupt. End the time slice here, and skip ahead
+	 *  to the next event. (In SMP machines, the slice still counts as a
+	 *  full one, to keep the count registers of all CPUs in step.)
 	 */
-
-	if (cpu->machine->ncpus == 1) {
-		static int x = 0;
-
-		if ((++x) == 300) {
-			usleep(20);
-			x = 0;
-		}
-
-		cpu->n_translated_instrs += N_SAFE_DYNTRANS_LIMIT / 6;
-	}
+	cpu_idle(cpu);
 }
 
 
@@ -3162,7 +3208,7 @@ X(end_of_page)
 	 *  Note: This may cause an exception, if e.g. the new page is
 	 *  not accessible.
 	 */
-	quick_pc_to_pointers(cpu);
+	chained_pc_to_pointers(cpu, ic);
 
 	/*  Simple jump to the next page (if we are lucky):  */
 	if (cpu->delay_slot == NOT_DELAYED)
@@ -3170,7 +3216,7 @@ X(end_of_page)
 
 	/*
 	 *  If we were in a delay slot, and we got an exception while doing
-	 *  quick_pc_to_pointers, then return. The function which called
+	 *  chained_pc_to_pointers, then return. The function which called
 	 *  end_of_page should handle this case.
 	 */
 	if (cpu->delay_slot == EXCEPTION_IN_DELAY_SLOT)
@@ -3469,6 +3515,39 @@ void COMBINE(nop)(struct cpu *cpu, struct mips_instr_call *ic, int low_addr)
 		return;
 	}
 
+	if (ic[-1].f == instr(b_samepage)) {
+		if (ic[-1].arg[2] == (size_t) &ic[-1])
+			ic[-1].f = instr(b_self_nop);
+		else
+			ic[-1].f = instr(b_samepage_nop);
+		return;
+	}
+
+	if (ic[-1].f == instr(blez_samepage)) {
+		ic[-1].f = instr(blez_samepage_nop);
+		return;
+	}
+
+	if (ic[-1].f == instr(bltz_samepage)) {
+		ic[-1].f = instr(bltz_samepage_nop);
+		return;
+	}
+
+	if (ic[-1].f == instr(bgez_samepage)) {
+		ic[-1].f = instr(bgez_samepage_nop);
+		return;
+	}
+
+	if (ic[-1].f == instr(bgtz_samepage)) {
+		ic[-1].f = instr(bgtz_samepage_nop);
+		return;
+	}
+
+	if (ic[-1].f == instr(jr_ra)) {
+		ic[-1].f = instr(jr_ra_nop);
+		return;
+	}
+
 	/*  TODO: other branches that are followed by nop should be here  */
 }
 
@@ -3608,6 +3687,9 @@ void COMBINE(b_daddiu)(struct cpu *cpu, struct mips_instr_call *ic,
 }
 
 
+#include "cpu_mips_instr_native.cc"
+
+
 /*****************************************************************************/
 
 
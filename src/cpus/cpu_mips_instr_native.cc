@@ -0,0 +1,561 @@
+/*
+ *  Copyright (C) 2005-2019  Anders Gavare.  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ *
+ *
+ *  MIPS native code translation (-G), for x86-64 hosts.
+ *
+ *  Straight-line runs of simple ALU instructions, loads, and stores, which
+ *  have already been translated into mips_instr_calls, are translated further
+ *  into one block of host code. The ALU instructions are done inline on the
+ *  emulated registers in struct cpu; loads and stores call the usual
+ *  load/store functions, so address translation, devices, and exceptions
+ *  work exactly as without native code.
+ *
+ *  Each instruction in a block (except the first instruction of the run, which
+ *  may be a delay slot) gets its own entry point, which is stored in ic->f.
+ *  The block is thus used no matter where in the run execution enters, e.g.
+ *  at a branch target. A block ends where the run ends, and never reaches
+ *  beyond the part of the page after the one it starts in (see the
+ *  INVALIDATE_PADDR_SUBPAGE handling in cpu_dyntrans.cc); this way, any
+ *  write to code in the block clears the translation of the block's first
+ *  instruction, which is checked for after each store.
+ *
+ *  This file is included from cpu_mips_instr.cc, i.e. once for each of the
+ *  64-bit and 32-bit modes.
+ */
+
+
+#if defined(__x86_64__)
+
+#ifndef	MIPS_NATIVE_CODE_HELPERS
+#define	MIPS_NATIVE_CODE_HELPERS
+
+#define	MIPS_NATIVE_CODE_SIZE		(8 * 1048576)
+
+/*
+ *  Worst case native code size per instruction, and per block. The largest
+ *  body is that of a load/store (104 bytes), and each instruction also has
+ *  an entry point of up to 19 bytes, plus up to 15 bytes of alignment. The
+ *  per-block part is the code after the last instruction (29 bytes).
+ */
+#define	MIPS_NATIVE_MAX_PER_INSTR	160
+#define	MIPS_NATIVE_MAX_PER_BLOCK	64
+
+/*  Kinds of instructions that can be part of a native block:  */
+#define	NATIVE_NONE		0
+#define	NATIVE_ALU3_32		1	/*  32-bit result, sign-extended  */
+#define	NATIVE_ALU3_64		2
+#define	NATIVE_SHIFT		3
+#define	NATIVE_ALUI_32		4	/*  addiu  */
+#define	NATIVE_ALUI_64		5	/*  andi, ori, xori, daddiu  */
+#define	NATIVE_SET		6
+#define	NATIVE_NOP		7
+#define	NATIVE_LOADSTORE	8
+
+/*  x86-64 opcodes:  */
+#define	X86_ADD_R_RM		0x03
+#define	X86_OR_R_RM		0x0b
+#define	X86_AND_R_RM		0x23
+#define	X86_SUB_R_RM		0x2b
+#define	X86_XOR_R_RM		0x33
+#define	X86_ADD_EAX_IMM		0x05
+#define	X86_OR_EAX_IMM		0x0d
+#define	X86_AND_EAX_IMM		0x25
+#define	X86_XOR_EAX_IMM		0x35
+#define	X86_SHL			0xe0
+#define	X86_SHR			0xe8
+#define	X86_SAR			0xf8
+
+
+/*
+ *  mips_native_code_init():
+ *
+ *  Allocates the native code area for a cpu. If this fails, native code
+ *  translation is turned off.
+ */
+void mips_native_code_init(struct cpu *cpu)
+{
+	void *p = mmap(NULL, MIPS_NATIVE_CODE_SIZE,
+	    PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
+
+	if (p == MAP_FAILED) {
+		fatal("WARNING: could not allocate memory for native code;"
+		    " disabling native code translation.\n");
+		cpu->machine->native_code_translation = 0;
+		return;
+	}
+
+	cpu->cd.mips.native_code = (unsigned char *) p;
+	cpu->cd.mips.native_code_size = MIPS_NATIVE_CODE_SIZE;
+	cpu->cd.mips.native_code_used = 0;
+	cpu->cd.mips.native_code_full = 0;
+}
+
+
+/*
+ *  mips_native_code_reset():
+ *
+ *  Called when the native code area is full. All translations (including
+ *  those pointing into the native code area) are thrown away, and the area
+ *  is reused from the start.
+ */
+void mips_native_code_reset(struct cpu *cpu)
+{
+	cpu_create_or_reset_tc(cpu);
+
+	cpu->cd.mips.native_code_used = 0;
+	cpu->cd.mips.native_code_full = 0;
+}
+
+
+/*  Helpers for emitting x86-64 code at *pp:  */
+static void native_b(unsigned char **pp, int b) { *(*pp)++ = b; }
+static void native_32(unsigned char **pp, uint32_t x)
+	{ memcpy(*pp, &x, sizeof(x)); (*pp) += sizeof(x); }
+static void native_64(unsigned char **pp, uint64_t x)
+	{ memcpy(*pp, &x, sizeof(x)); (*pp) += sizeof(x); }
+
+
+/*
+ *  native_op_rbx():
+ *
+ *  Emits "op reg,[rbx+disp]" (or "op [rbx+disp],reg", depending on op),
+ *  with an optional REX.W prefix.
+ */
+static void native_op_rbx(unsigned char **pp, int rex_w, int op, int reg,
+	int32_t disp)
+{
+	if (rex_w)
+		native_b(pp, 0x48);
+	native_b(pp, op);
+	native_b(pp, 0x83 | (reg << 3));
+	native_32(pp, disp);
+}
+
+
+/*  mov rax,imm64:  */
+static void native_mov_rax_imm64(unsigned char **pp, uint64_t x)
+{
+	native_b(pp, 0x48); native_b(pp, 0xb8); native_64(pp, x);
+}
+
+
+/*  add dword [rbx+disp],imm32:  */
+static void native_add_mem32_imm(unsigned char **pp, int32_t disp, int32_t x)
+{
+	native_b(pp, 0x81); native_b(pp, 0x83); native_32(pp, disp);
+	native_32(pp, x);
+}
+
+
+/*  jne rel32, to be patched later. Returns the location of rel32.  */
+static unsigned char *native_jne(unsigned char **pp)
+{
+	unsigned char *fixup;
+	native_b(pp, 0x0f); native_b(pp, 0x85);
+	fixup = *pp;
+	native_32(pp, 0);
+	return fixup;
+}
+
+
+/*
+ *  native_reg_disp():
+ *
+ *  Returns the offset of an emulated register (or any other value that an
+ *  instruction call argument points to) within struct cpu, or -1 if the
+ *  pointer is not inside struct cpu.
+ */
+static int32_t native_reg_disp(struct cpu *cpu, size_t p)
+{
+	if (p < (size_t)cpu || p + sizeof(uint64_t) > (size_t)(cpu + 1))
+		return -1;
+
+	return p - (size_t)cpu;
+}
+
+#endif	/*  MIPS_NATIVE_CODE_HELPERS  */
+
+
+/*
+ *  mips_combine_native_kind():
+ *
+ *  Returns what kind of native code a translated instruction call can be
+ *  turned into, or NATIVE_NONE.
+ */
+static int COMBINE(native_kind)(struct cpu *cpu, struct mips_instr_call *ic)
+{
+	void (*f)(struct cpu *, struct mips_instr_call *) = ic->f;
+	int i, nargs = 0;
+
+	if (f == instr(addu) || f == instr(subu) || f == instr(and) ||
+	    f == instr(or) || f == instr(xor) || f == instr(nor))
+		nargs = 3;
+#ifndef MODE32
+	else if (f == instr(daddu))
+		nargs = 3;
+#endif
+	else if (f == instr(sll) || f == instr(srl) || f == instr(sra)) {
+		if (ic->arg[1] >= 32)
+			return NATIVE_NONE;
+		if (native_reg_disp(cpu, ic->arg[0]) < 0 ||
+		    native_reg_disp(cpu, ic->arg[2]) < 0)
+			return NATIVE_NONE;
+		return NATIVE_SHIFT;
+	} else if (f == instr(addiu)) {
+		nargs = 2;
+	} else if (f == instr(andi) || f == instr(ori) || f == instr(xori)) {
+		if ((uint32_t)ic->arg[2] > 0xffff)
+			return NATIVE_NONE;
+		nargs = 2;
+	}
+#ifndef MODE32
+	else if (f == instr(daddiu))
+		nargs = 2;
+#endif
+	else if (f == instr(set))
+		return native_reg_disp(cpu, ic->arg[0]) < 0?
+		    NATIVE_NONE : NATIVE_SET;
+	else if (f == instr(nop))
+		return NATIVE_NOP;
+	else {
+		for (i=0; i<32; i++)
+			if (f ==
+#ifdef MODE32
+			    mips32_loadstore
+#else
+			    mips_loadstore
+#endif
+			    [i])
+				return f == instr(invalid)?
+				    NATIVE_NONE : NATIVE_LOADSTORE;
+		return NATIVE_NONE;
+	}
+
+	for (i=0; i<nargs; i++)
+		if (native_reg_disp(cpu, ic->arg[i]) < 0)
+			return NATIVE_NONE;
+
+	if (nargs == 2)
+		return f == instr(addiu)? NATIVE_ALUI_32 : NATIVE_ALUI_64;
+	if (f == instr(addu) || f == instr(subu))
+		return NATIVE_ALU3_32;
+	return NATIVE_ALU3_64;
+}
+
+
+/*
+ *  mips_combine_native_store_result():
+ *
+ *  Emits code to store eax (32-bit results) or rax (64-bit results) into
+ *  an emulated register. 32-bit results are sign-extended in 64-bit mode.
+ */
+static void COMBINE(native_store_result)(unsigned char **pp, int result64,
+	int32_t disp)
+{
+#ifdef MODE32
+	(void)result64;
+	native_op_rbx(pp, 0, 0x89, 0, disp);
+#else
+	if (!result64) {
+		/*  movsxd rax,eax  */
+		native_b(pp, 0x48); native_b(pp, 0x63); native_b(pp, 0xc0);
+	}
+	native_op_rbx(pp, 1, 0x89, 0, disp);
+#endif
+}
+
+
+/*
+ *  mips_combine_native():
+ *
+ *  Called when an instruction has been translated. If the instructions just
+ *  before it form a long enough run of instructions that can be turned into
+ *  native code, then a native block is generated for the run.
+ *
+ *  If the newly translated instruction is itself part of a run, then the run
+ *  is only translated if the instruction is the last one on the page.
+ */
+void COMBINE(native)(struct cpu *cpu, struct mips_instr_call *ic,
+	int low_addr)
+{
+	int n_back = (low_addr >> MIPS_INSTR_ALIGNMENT_SHIFT)
+	    & (MIPS_IC_ENTRIES_PER_PAGE - 1);
+	int instrs_per_part = MIPS_IC_ENTRIES_PER_PAGE / (8 *
+	    sizeof(cpu->cd.mips.cur_physpage->translations_bitmap));
+	int32_t ntr_disp = (size_t)&cpu->n_translated_instrs - (size_t)cpu;
+	int32_t next_ic_disp = (size_t)&cpu->cd.mips.next_ic - (size_t)cpu;
+	struct mips_instr_call *page = ic - n_back;
+	unsigned char *code, *p, *exit_fixup[MIPS_IC_ENTRIES_PER_PAGE];
+	int32_t body_ofs[MIPS_IC_ENTRIES_PER_PAGE];
+	int flushed_at[MIPS_IC_ENTRIES_PER_PAGE];
+	int start, end, limit, i, n_exit_fixups = 0, flushed = 0, max_size;
+
+	if (cpu->cd.mips.native_code == NULL || cpu->cd.mips.native_code_full)
+		return;
+
+	if (COMBINE(native_kind)(cpu, ic) != NATIVE_NONE) {
+		if (n_back != MIPS_IC_ENTRIES_PER_PAGE - 1)
+			return;
+		end = n_back;
+	} else
+		end = n_back - 1;
+
+	if (end < 0 || COMBINE(native_kind)(cpu, &page[end]) == NATIVE_NONE)
+		return;
+
+	/*  Find the start of the run, but don't go further back than to the
+	    start of the part of the page before the last instruction:  */
+	limit = (end / instrs_per_part - 1) * instrs_per_part;
+	start = end;
+	while (start > limit && COMBINE(native_kind)(cpu, &page[start-1])
+	    != NATIVE_NONE)
+		start --;
+
+	/*  The first instruction of a run may be a delay slot:  */
+	if (start == 0 ||
+	    COMBINE(native_kind)(cpu, &page[start-1]) == NATIVE_NONE)
+		start ++;
+
+	if (end - start + 1 < 2)
+		return;
+
+	max_size = (end - start + 1) * MIPS_NATIVE_MAX_PER_INSTR +
+	    MIPS_NATIVE_MAX_PER_BLOCK;
+	if (cpu->cd.mips.native_code_used + max_size >
+	    cpu->cd.mips.native_code_size) {
+		cpu->cd.mips.native_code_full = 1;
+		return;
+	}
+
+	code = p = cpu->cd.mips.native_code + cpu->cd.mips.native_code_used;
+
+	/*
+	 *  The body. rbx points to struct cpu. n_translated_instrs is counted
+	 *  as if execution started at the first instruction of the block; the
+	 *  entry points for the other instructions make up for this, and for
+	 *  what was added to it before their position in the body.
+	 */
+	for (i=start; i<=end; i++) {
+		struct mips_instr_call *c = &page[i];
+		void (*f)(struct cpu *, struct mips_instr_call *) = c->f;
+		int rex_w = 0, op = 0, result64 = 0;
+
+		body_ofs[i] = p - code;
+		flushed_at[i] = flushed;
+
+		switch (COMBINE(native_kind)(cpu, c)) {
+
+		case NATIVE_ALU3_64:
+#ifndef MODE32
+			rex_w = result64 = 1;
+#endif
+			/*  Fall-through.  */
+		case NATIVE_ALU3_32:
+			if (f == instr(addu))	op = X86_ADD_R_RM;
+			if (f == instr(subu))	op = X86_SUB_R_RM;
+			if (f == instr(and))	op = X86_AND_R_RM;
+			if (f == instr(or))	op = X86_OR_R_RM;
+			if (f == instr(xor))	op = X86_XOR_R_RM;
+			if (f == instr(nor))	op = X86_OR_R_RM;
+#ifndef MODE32
+			if (f == instr(daddu))	op = X86_ADD_R_RM;
+#endif
+			native_op_rbx(&p, rex_w, 0x8b, 0,
+			    native_reg_disp(cpu, c->arg[0]));
+			native_op_rbx(&p, rex_w, op, 0,
+			    native_reg_disp(cpu, c->arg[1]));
+			if (f == instr(nor)) {
+				/*  not eax / not rax  */
+				if (rex_w)
+					native_b(&p, 0x48);
+				native_b(&p, 0xf7); native_b(&p, 0xd0);
+			}
+			COMBINE(native_store_result)(&p, result64,
+			    native_reg_disp(cpu, c->arg[2]));
+			break;
+
+		case NATIVE_SHIFT:
+			native_op_rbx(&p, 0, 0x8b, 0,
+			    native_reg_disp(cpu, c->arg[0]));
+			if (c->arg[1] != 0) {
+				native_b(&p, 0xc1);
+				native_b(&p, f == instr(sll)? X86_SHL :
+				    f == instr(srl)? X86_SHR : X86_SAR);
+				native_b(&p, c->arg[1]);
+			}
+			COMBINE(native_store_result)(&p, 0,
+			    native_reg_disp(cpu, c->arg[2]));
+			break;
+
+		case NATIVE_ALUI_64:
+#ifndef MODE32
+			rex_w = result64 = 1;
+#endif
+			/*  Fall-through.  */
+		case NATIVE_ALUI_32:
+			if (f == instr(addiu))	op = X86_ADD_EAX_IMM;
+			if (f == instr(andi))	op = X86_AND_EAX_IMM;
+			if (f == instr(ori))	op = X86_OR_EAX_IMM;
+			if (f == instr(xori))	op = X86_XOR_EAX_IMM;
+#ifndef MODE32
+			if (f == instr(daddiu))	op = X86_ADD_EAX_IMM;
+#endif
+			native_op_rbx(&p, rex_w, 0x8b, 0,
+			    native_reg_disp(cpu, c->arg[0]));
+			if (rex_w)
+				native_b(&p, 0x48);
+			native_b(&p, op);
+			native_32(&p, c->arg[2]);
+			COMBINE(native_store_result)(&p, result64,
+			    native_reg_disp(cpu, c->arg[1]));
+			break;
+
+		case NATIVE_SET:
+			/*  mov eax,imm32  */
+			native_b(&p, 0xb8);
+			native_32(&p, c->arg[1]);
+			COMBINE(native_store_result)(&p, 0,
+			    native_reg_disp(cpu, c->arg[0]));
+			break;
+
+		case NATIVE_NOP:
+			break;
+
+		case NATIVE_LOADSTORE:
+			/*  Account for the instructions so far, and set
+			    next_ic as if called from the main loop:  */
+			if (i - start != flushed) {
+				native_add_mem32_imm(&p, ntr_disp,
+				    i - start - flushed);
+				flushed = i - start;
+			}
+			native_mov_rax_imm64(&p, (size_t)&page[i+1]);
+			native_op_rbx(&p, 1, 0x89, 0, next_ic_disp);
+
+			/*  mov rdi,rbx; mov rsi,ic; mov rax,f; call rax  */
+			native_b(&p, 0x48); native_b(&p, 0x89);
+			native_b(&p, 0xdf);
+			native_b(&p, 0x48); native_b(&p, 0xbe);
+			native_64(&p, (size_t)c);
+			native_mov_rax_imm64(&p, (size_t)f);
+			native_b(&p, 0xff); native_b(&p, 0xd0);
+
+			/*  Exception, or a different ic to continue at?  */
+			native_mov_rax_imm64(&p, (size_t)&page[i+1]);
+			native_op_rbx(&p, 1, 0x39, 0, next_ic_disp);
+			exit_fixup[n_exit_fixups++] = native_jne(&p);
+
+			/*  Was the code in this block written to?  */
+			native_mov_rax_imm64(&p, (size_t)&page[start].f);
+			native_b(&p, 0x48); native_b(&p, 0xb9);
+			native_64(&p, (size_t)instr(to_be_translated));
+			native_b(&p, 0x48); native_b(&p, 0x39);
+			native_b(&p, 0x08);
+			native_b(&p, 0x0f); native_b(&p, 0x84);
+			exit_fixup[n_exit_fixups++] = p;
+			native_32(&p, 0);
+			break;
+
+		default:fatal("mips_combine_native(): internal error\n");
+			exit(1);
+		}
+	}
+
+	if (end - start != flushed)
+		native_add_mem32_imm(&p, ntr_disp, end - start - flushed);
+	native_mov_rax_imm64(&p, (size_t)&page[end+1]);
+	native_op_rbx(&p, 1, 0x89, 0, next_ic_disp);
+
+	/*  Exit:  pop rbx; ret  */
+	for (i=0; i<n_exit_fixups; i++) {
+		uint32_t rel = p - (exit_fixup[i] + sizeof(uint32_t));
+		memcpy(exit_fixup[i], &rel, sizeof(rel));
+	}
+	native_b(&p, 0x5b);
+	native_b(&p, 0xc3);
+
+	/*
+	 *  Entry points, called as f(cpu, ic):
+	 *
+	 *	push rbx; mov rbx,rdi
+	 *	add dword [rbx+n_translated_instrs],flushed_at[i]-(i-start)
+	 *	jmp body
+	 */
+	for (i=start; i<=end; i++) {
+		uint32_t rel;
+
+		/*  Keep the entry points aligned:  */
+		while ((size_t)p & 15)
+			native_b(&p, 0xcc);
+
+		page[i].f = (void (*)(struct cpu *, struct mips_instr_call *))p;
+
+		native_b(&p, 0x53);
+		native_b(&p, 0x48); native_b(&p, 0x89); native_b(&p, 0xfb);
+		if (flushed_at[i] != i - start)
+			native_add_mem32_imm(&p, ntr_disp,
+			    flushed_at[i] - (i - start));
+		native_b(&p, 0xe9);
+		rel = (code + body_ofs[i]) - (p + sizeof(uint32_t));
+		native_32(&p, rel);
+	}
+
+	if (p - code > max_size) {
+		fatal("mips_combine_native(): internal error: %i bytes of"
+		    " native code, but only %i were reserved\n",
+		    (int)(p - code), max_size);
+		exit(1);
+	}
+
+	cpu->cd.mips.native_code_used += p - code;
+	cpu->tc_stats.native_blocks ++;
+}
+
+
+#define	DYNTRANS_NATIVE_CODE_CHECK	COMBINE(native)
+
+#else	/*  !__x86_64__  */
+
+#ifndef	MIPS_NATIVE_CODE_HELPERS
+#define	MIPS_NATIVE_CODE_HELPERS
+
+void mips_native_code_init(struct cpu *cpu)
+{
+	fatal("WARNING: native code translation is only implemented for"
+	    " x86-64 hosts.\n");
+	cpu->machine->native_code_translation = 0;
+}
+
+void mips_native_code_reset(struct cpu *cpu)
+{
+	cpu->cd.mips.native_code_full = 0;
+}
+
+#endif	/*  MIPS_NATIVE_CODE_HELPERS  */
+
+#endif	/*  !__x86_64__  */
+
@@ -124,6 +124,8 @@ int ppc_cpu_new(struct cpu *cpu, struct memory *mem, struct machine *machine,
 		cpu->update_translation_table = ppc32_update_translation_table;
 		cpu->invalidate_translation_caches =
 		    ppc32_invalidate_translation_caches;
+		cpu->invalidate_translation_range =
+		    ppc32_invalidate_translation_range;
 		cpu->invalidate_code_translation =
 		    ppc32_invalidate_code_translation;
 	} else {
@@ -131,6 +133,8 @@ int ppc_cpu_new(struct cpu *cpu, struct memory *mem, struct machine *machine,
 		cpu->update_translation_table = ppc_update_translation_table;
 		cpu->invalidate_translation_caches =
 		    ppc_invalidate_translation_caches;
+		cpu->invalidate_translation_range =
+		    ppc_invalidate_translation_range;
 		cpu->invalidate_code_translation =
 		    ppc_invalidate_code_translation;
 	}
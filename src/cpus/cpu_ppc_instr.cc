@@ -1815,6 +1815,10 @@ X(mtmsr)
 
 	reg_access_msr(cpu, &x, 1, 1);
 
+	/*  Power saving mode: idle until the next interrupt.  */
+	if ((x & PPC_MSR_POW) && (x & PPC_MSR_EE))
+		cpu_idle(cpu);
+
 	/*
 	 *  Super-ugly hack:  If the pc wasn't changed (i.e. if there was no
 	 *  exception while accessing the msr), then we _decrease_ the PC by 4
@@ -109,6 +109,8 @@ int sh_cpu_new(struct cpu *cpu, struct memory *mem, struct machine *machine,
 	cpu->update_translation_table = sh_update_translation_table;
 	cpu->invalidate_translation_caches =
 	    sh_invalidate_translation_caches;
+	cpu->invalidate_translation_range =
+	    sh_invalidate_translation_range;
 	cpu->invalidate_code_translation =
 	    sh_invalidate_code_translation;
 
@@ -90,8 +90,11 @@ int main(int argc, char *argv[])
 
 	printf("#define DYNTRANS_INVALIDATE_TC "
 	    "%s_invalidate_translation_caches\n", a);
+	printf("#define DYNTRANS_INVALIDATE_TC_RANGE "
+	    "%s_invalidate_translation_range\n", a);
 	printf("#include \"cpu_dyntrans.cc\"\n");
-	printf("#undef DYNTRANS_INVALIDATE_TC\n\n");
+	printf("#undef DYNTRANS_INVALIDATE_TC\n");
+	printf("#undef DYNTRANS_INVALIDATE_TC_RANGE\n\n");
 
 	printf("#define DYNTRANS_INVALIDATE_TC_CODE "
 	    "%s_invalidate_code_translation\n", a);
@@ -161,8 +164,11 @@ int main(int argc, char *argv[])
 	printf("#undef DYNTRANS_INVAL_ENTRY\n\n");
 	printf("#define DYNTRANS_INVALIDATE_TC "
 	    "%s32_invalidate_translation_caches\n", a);
+	printf("#define DYNTRANS_INVALIDATE_TC_RANGE "
+	    "%s32_invalidate_translation_range\n", a);
 	printf("#include \"cpu_dyntrans.cc\"\n");
-	printf("#undef DYNTRANS_INVALIDATE_TC\n\n");
+	printf("#undef DYNTRANS_INVALIDATE_TC\n");
+	printf("#undef DYNTRANS_INVALIDATE_TC_RANGE\n\n");
 	printf("#define DYNTRANS_INVALIDATE_TC_CODE "
 	    "%s32_invalidate_code_translation\n", a);
 	printf("#include \"cpu_dyntrans.cc\"\n");
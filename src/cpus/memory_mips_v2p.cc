@@ -66,7 +66,6 @@ int TRANSLATE_ADDRESS(struct cpu *cpu, uint64_t vaddr,
 
 #ifdef V2P_MMU3K
 	const int x_64 = 0;
-	const int n_tlbs = 64;
 	const uint32_t pmask = 0xfff;
 	uint64_t xuseg_top;		/*  Well, useg actually.  */
 #else
@@ -82,7 +81,7 @@ int TRANSLATE_ADDRESS(struct cpu *cpu, uint64_t vaddr,
 	uint64_t xuseg_top = ENTRYHI_VPN2_MASK | 0x1fffULL;
 #endif
 	int x_64;	/*  non-zero for 64-bit address space accesses  */
-	int pageshift, n_tlbs;
+	int pageshift;
 	uint32_t pmask;
 #ifdef V2P_MMU4100
 	const int pagemask_mask = PAGEMASK_MASK_R4100;
@@ -183,8 +182,6 @@ int TRANSLATE_ADDRESS(struct cpu *cpu, uint64_t vaddr,
 		exit(1);
 	}
 
-	n_tlbs = cpu->cd.mips.cpu_type.nr_of_tlb_entries;
-
 	/*  Having this here suppresses a compiler warning:  */
 	pageshift = 12;
 
@@ -249,13 +246,28 @@ int TRANSLATE_ADDRESS(struct cpu *cpu, uint64_t vaddr,
 		int g_bit, v_bit, d_bit;
 		uint64_t cached_hi, cached_lo0;
 		uint64_t entry_vpn2 = 0, entry_asid, pfn;
-		int i_end;
-
-		i = cpu->cd.mips.last_written_tlb_index;
-		i_end = i == 0? n_tlbs-1 : i - 1;
-
-		/*  Scan all TLB entries:  */
+		uint32_t pageshifts = cp0->tlb_pageshifts;
+		int hash_shift = -1;
+
+		/*
+		 *  Scan the TLB entries in the hash bucket of each page size
+		 *  that is in use. No other entries can match.
+		 */
+		i = -1;
 		for (;;) {
+			if (i < 0) {
+				if (pageshifts == 0)
+					break;
+				do {
+					hash_shift ++;
+				} while (!(pageshifts & (1 << hash_shift)));
+				pageshifts &= ~(1 << hash_shift);
+
+				i = cp0->tlb_hash_head[MIPS_TLB_HASH(vaddr,
+				    hash_shift)];
+				continue;
+			}
+
 #ifdef V2P_MMU3K
 			/*  R3000 or similar:  */
 			cached_hi = cp0->tlbs[i].hi;
@@ -399,13 +411,9 @@ int TRANSLATE_ADDRESS(struct cpu *cpu, uint64_t vaddr,
 				}
 			}
 
-			if (i == i_end)
-				break;
 
-			/*  Go to the next TLB entry:  */
-			i ++;
-			if (i == n_tlbs)
-				i = 0;
+			/*  Go to the next TLB entry in the bucket:  */
+			i = cp0->tlb_hash[i].next;
 		}
 	}
 
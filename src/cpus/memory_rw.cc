@@ -76,6 +76,7 @@ int MEMORY_RW(struct cpu *cpu, struct memory *mem, uint64_t vaddr,
 	int cache, no_exceptions, offset;
 	unsigned char *memblock;
 	int dyntrans_device_danger = 0;
+	int code_remains = 0;
 
 	no_exceptions = misc_flags & NO_EXCEPTIONS;
 	cache = misc_flags & CACHE_FLAGS_MASK;
@@ -237,7 +238,7 @@ int MEMORY_RW(struct cpu *cpu, struct memory *mem, uint64_t vaddr,
 	 */
 	if (paddr >= mem->mmap_dev_minaddr && paddr < mem->mmap_dev_maxaddr) {
 		uint64_t orig_paddr = paddr;
-		int i, start, end, res;
+		int i, res;
 
 #if 0
 
@@ -274,113 +275,92 @@ not just the device in question.
 			}
 #endif
 
-		start = 0; end = mem->n_mmapped_devices - 1;
-		i = mem->last_accessed_device;
-
-		/*  Scan through all devices:  */
-		do {
-			if (paddr >= mem->devices[i].baseaddr &&
-			    paddr < mem->devices[i].endaddr) {
-				/*  Found a device, let's access it:  */
-				mem->last_accessed_device = i;
-
-				paddr -= mem->devices[i].baseaddr;
-				if (paddr + len > mem->devices[i].length)
-					len = mem->devices[i].length - paddr;
-
-				if (cpu->update_translation_table != NULL &&
-				    !(ok & MEMORY_NOT_FULL_PAGE) &&
-				    mem->devices[i].flags & DM_DYNTRANS_OK) {
-					int wf = writeflag == MEM_WRITE? 1 : 0;
-					unsigned char *host_addr;
-
-					if (!(mem->devices[i].flags &
-					    DM_DYNTRANS_WRITE_OK))
-						wf = 0;
-
-					if (writeflag && wf) {
-						if (paddr < mem->devices[i].
-						    dyntrans_write_low)
-							mem->devices[i].
-							dyntrans_write_low =
-							    paddr &~offset_mask;
-						if (paddr >= mem->devices[i].
-						    dyntrans_write_high)
-							mem->devices[i].
-						 	dyntrans_write_high =
-							    paddr | offset_mask;
-					}
-
-					if (mem->devices[i].flags &
-					    DM_EMULATED_RAM) {
-						/*  MEM_WRITE to force the page
-						    to be allocated, if it
-						    wasn't already  */
-						uint64_t *pp = (uint64_t *)mem->
-						    devices[i].dyntrans_data;
-						uint64_t p = orig_paddr - *pp;
-						host_addr =
-						    memory_paddr_to_hostaddr(
-						    mem, p & ~offset_mask,
-						    MEM_WRITE);
-					} else {
-						host_addr = mem->devices[i].
-						    dyntrans_data +
-						    (paddr & ~offset_mask);
-					}
-
-					cpu->update_translation_table(cpu,
-					    vaddr & ~offset_mask, host_addr,
-					    wf, orig_paddr & ~offset_mask);
+		i = memory_device_find(mem, paddr);
+		if (i >= 0) {
+			/*  Found a device, let's access it:  */
+			paddr -= mem->devices[i].baseaddr;
+			if (paddr + len > mem->devices[i].length)
+				len = mem->devices[i].length - paddr;
+
+			if (cpu->update_translation_table != NULL &&
+			    !(ok & MEMORY_NOT_FULL_PAGE) &&
+			    mem->devices[i].flags & DM_DYNTRANS_OK) {
+				int wf = writeflag == MEM_WRITE? 1 : 0;
+				unsigned char *host_addr;
+
+				if (!(mem->devices[i].flags &
+				    DM_DYNTRANS_WRITE_OK))
+					wf = 0;
+
+				if (writeflag && wf)
+					memory_device_set_dirty(
+					    &mem->devices[i],
+					    paddr & ~offset_mask,
+					    paddr | offset_mask);
+
+				if (mem->devices[i].flags &
+				    DM_EMULATED_RAM) {
+					/*  MEM_WRITE to force the page
+					    to be allocated, if it
+					    wasn't already  */
+					uint64_t *pp = (uint64_t *)mem->
+					    devices[i].dyntrans_data;
+					uint64_t p = orig_paddr - *pp;
+					host_addr =
+					    memory_paddr_to_hostaddr(
+					    mem, p & ~offset_mask,
+					    MEM_WRITE);
+				} else {
+					host_addr = mem->devices[i].
+					    dyntrans_data +
+					    (paddr & ~offset_mask);
 				}
 
-				res = 0;
-				if (!no_exceptions || (mem->devices[i].flags &
-				    DM_READS_HAVE_NO_SIDE_EFFECTS))
-					res = mem->devices[i].f(cpu, mem, paddr,
-					    data, len, writeflag,
-					    mem->devices[i].extra);
-
-				if (res == 0)
-					res = -1;
+				cpu->update_translation_table(cpu,
+				    vaddr & ~offset_mask, host_addr,
+				    wf, orig_paddr & ~offset_mask);
+			}
 
-				/*
-				 *  If accessing the memory mapped device
-				 *  failed, then return with an exception.
-				 *  (Architecture specific.)
-				 */
-				if (res <= 0 && !no_exceptions) {
-					debug("[ %s device '%s' addr %08lx "
-					    "failed ]\n", writeflag?
-					    "writing to" : "reading from",
-					    mem->devices[i].name, (long)paddr);
+			res = 0;
+			if (!no_exceptions || (mem->devices[i].flags &
+			    DM_READS_HAVE_NO_SIDE_EFFECTS))
+				res = mem->devices[i].f(cpu, mem, paddr,
+				    data, len, writeflag,
+				    mem->devices[i].extra);
+
+			if (res == 0)
+				res = -1;
+
+			/*
+			 *  If accessing the memory mapped device
+			 *  failed, then return with an exception.
+			 *  (Architecture specific.)
+			 */
+			if (res <= 0 && !no_exceptions) {
+				debug("[ %s device '%s' addr %08lx "
+				    "failed ]\n", writeflag?
+				    "writing to" : "reading from",
+				    mem->devices[i].name, (long)paddr);
 #ifdef MEM_MIPS
-					mips_cpu_exception(cpu,
-					    cache == CACHE_INSTRUCTION?
-					    EXCEPTION_IBE : EXCEPTION_DBE,
-					    0, vaddr, 0, 0, 0, 0);
+				mips_cpu_exception(cpu,
+				    cache == CACHE_INSTRUCTION?
+				    EXCEPTION_IBE : EXCEPTION_DBE,
+				    0, vaddr, 0, 0, 0, 0);
 #endif
 #ifdef MEM_M88K
-					/*  TODO: This is enough for
-					    OpenBSD/mvme88k's badaddr()
-					    implementation... but the
-					    faulting address should probably
-					    be included somewhere too!  */
-					m88k_exception(cpu, cache == CACHE_INSTRUCTION
-					    ? M88K_EXCEPTION_INSTRUCTION_ACCESS
-					    : M88K_EXCEPTION_DATA_ACCESS, 0);
+				/*  TODO: This is enough for
+				    OpenBSD/mvme88k's badaddr()
+				    implementation... but the
+				    faulting address should probably
+				    be included somewhere too!  */
+				m88k_exception(cpu, cache == CACHE_INSTRUCTION
+				    ? M88K_EXCEPTION_INSTRUCTION_ACCESS
+				    : M88K_EXCEPTION_DATA_ACCESS, 0);
 #endif
-					return MEMORY_ACCESS_FAILED;
-				}
-				goto do_return_ok;
+				return MEMORY_ACCESS_FAILED;
 			}
-
-			if (paddr < mem->devices[i].baseaddr)
-				end = i - 1;
-			if (paddr >= mem->devices[i].endaddr)
-				start = i + 1;
-			i = (start + end) >> 1;
-		} while (start <= end);
+			goto do_return_ok;
+		}
 	}
 
 
@@ -467,11 +447,11 @@ not just the device in question.
 	 *
 	 *  1)  Translate the physical address to a host address.
 	 *
-	 *  2)  Insert this virtual->physical->host translation into the
-	 *      fast translation arrays (using update_translation_table()).
-	 *
-	 *  3)  If this was a Write, then invalidate any code translations
+	 *  2)  If this was a Write, then invalidate any code translations
 	 *      in that page.
+	 *
+	 *  3)  Insert this virtual->physical->host translation into the
+	 *      fast translation arrays (using update_translation_table()).
 	 */
 	memblock = memory_paddr_to_hostaddr(mem, paddr & ~offset_mask,
 	    writeflag);
@@ -483,6 +463,29 @@ not just the device in question.
 
 	offset = paddr & offset_mask;
 
+	/*
+	 *  If writing, or if mapping a page where writing is ok later on,
+	 *  then invalidate code translations for the (physical) page address.
+	 *
+	 *  Small writes only invalidate the translations near the written
+	 *  address, and a mapping without a write doesn't invalidate any.
+	 *  If the page still contains code after that, it is not mapped as
+	 *  writable, so that later writes to it end up here too.
+	 */
+
+	if (cpu->invalidate_code_translation != NULL) {
+		if (writeflag == MEM_WRITE && len <= sizeof(uint64_t))
+			code_remains = cpu->invalidate_code_translation(cpu,
+			    paddr, INVALIDATE_PADDR | INVALIDATE_PADDR_SUBPAGE);
+		else if (writeflag == MEM_WRITE)
+			cpu->invalidate_code_translation(cpu, paddr,
+			    INVALIDATE_PADDR);
+		else if (ok == 2 && cache == CACHE_DATA)
+			code_remains = cpu->invalidate_code_translation(cpu,
+			    paddr, INVALIDATE_PADDR | INVALIDATE_PADDR_SUBPAGE |
+			    JUST_MARK_AS_NON_WRITABLE);
+	}
+
 	if (cpu->update_translation_table != NULL && !dyntrans_device_danger
 #ifdef MEM_MIPS
 	    /*  Ugly hack for R2000/R3000 caches:  */
@@ -494,19 +497,10 @@ not just the device in question.
 		cpu->update_translation_table(cpu, vaddr & ~offset_mask,
 		    memblock, (misc_flags & MEMORY_USER_ACCESS) |
 		    (cache == CACHE_INSTRUCTION?
-			(writeflag == MEM_WRITE? 1 : 0) : ok - 1),
+			(writeflag == MEM_WRITE? 1 : 0) :
+			(code_remains? 0 : ok - 1)),
 		    paddr & ~offset_mask);
 
-	/*
-	 *  If writing, or if mapping a page where writing is ok later on,
-	 *  then invalidate code translations for the (physical) page address:
-	 */
-
-	if ((writeflag == MEM_WRITE
-	    || (ok == 2 && cache == CACHE_DATA)
-	    ) && cpu->invalidate_code_translation != NULL)
-		cpu->invalidate_code_translation(cpu, paddr, INVALIDATE_PADDR);
-
 	if ((paddr&((1<<BITS_PER_MEMBLOCK)-1)) + len > (1<<BITS_PER_MEMBLOCK)) {
 		printf("Write over memblock boundary?\n");
 		exit(1);
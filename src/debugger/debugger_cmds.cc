@@ -352,6 +352,53 @@ static void debugger_cmd_dump(struct machine *m, char *cmd_line)
 }
 
 
+/*
+ *  debugger_cmd_dyntrans():
+ *
+ *  Show dyntrans translation cache statistics for each cpu in the machine.
+ */
+static void debugger_cmd_dyntrans(struct machine *m, char *cmd_line)
+{
+	int i;
+
+	if (*cmd_line) {
+		printf("syntax: dyntrans\n");
+		return;
+	}
+
+	for (i=0; i<m->ncpus; i++) {
+		struct cpu *c = m->cpus[i];
+		struct dyntrans_statistics *st = &c->tc_stats;
+
+		if (c->translation_cache == NULL)
+			continue;
+
+		printf("cpu%i:\n", i);
+		printf("  translation cache size: %i KB\n",
+		    (int)(c->translation_cache_size / 1024));
+		printf("  pages allocated:        %" PRIi64"\n",
+		    st->pages_allocated);
+		printf("  pages evicted:          %" PRIi64" (in %" PRIi64
+		    " reclaim runs)\n", st->pages_evicted, st->reclaim_runs);
+		printf("  full cache resets:      %" PRIi64"\n",
+		    st->full_resets);
+		printf("  instrs translated:      %" PRIi64"\n",
+		    st->instrs_translated);
+		printf("  chained branches:       %" PRIi64" hits, %" PRIi64
+		    " misses\n", st->chain_hits, st->chain_misses);
+		printf("  invalidations:          %" PRIi64" (%" PRIi64
+		    " translations removed)\n", st->invalidations,
+		    st->translations_invalidated);
+		printf("  code invalidations:     %" PRIi64" whole pages, %"
+		    PRIi64" partial\n", st->code_invalidations,
+		    st->code_subpage_invalidations);
+		if (m->native_code_translation)
+			printf("  native code blocks:     %" PRIi64"\n",
+			    st->native_blocks);
+	}
+}
+
+
 /*
  *  debugger_cmd_emul():
  *
@@ -439,6 +486,42 @@ print_current_focus_and_return:
 }
 
 
+/*
+ *  debugger_cmd_footprint():
+ *
+ *  Show how much of each machine's physical memory has been touched, and how
+ *  much of it is actually resident in the host.
+ */
+static void debugger_cmd_footprint(struct machine *m, char *cmd_line)
+{
+	int i;
+
+	if (*cmd_line) {
+		printf("syntax: footprint\n");
+		return;
+	}
+
+	for (i=0; i<debugger_emul->n_machines; i++) {
+		struct machine *mp = debugger_emul->machines[i];
+		uint64_t touched, resident;
+
+		memory_footprint(mp->memory, &touched, &resident);
+
+		printf("machine %i", i);
+		if (mp->name != NULL)
+			printf(" \"%s\"", mp->name);
+		printf(": %i MB RAM\n", (int)(mp->memory->physical_max
+		    / 1048576));
+		printf("  touched:                %" PRIu64" KB\n",
+		    touched / 1024);
+		printf("  resident:               %" PRIu64" KB\n",
+		    resident / 1024);
+		printf("  zero pages released:    %" PRIi64"\n",
+		    mp->memory->zero_pages_released);
+	}
+}
+
+
 /*  This is defined below.  */
 static void debugger_cmd_help(struct machine *m, char *cmd_line);
 
@@ -1169,6 +1252,25 @@ static void debugger_cmd_unassemble(struct machine *m, char *cmd_line)
 }
 
 
+/*
+ *  debugger_cmd_writeram():
+ *
+ *  Save the physical RAM of the current machine to a file, which can later
+ *  be used with -l.
+ */
+static void debugger_cmd_writeram(struct machine *m, char *cmd_line)
+{
+	if (!*cmd_line) {
+		printf("syntax: writeram filename\n");
+		return;
+	}
+
+	if (memory_save_image(m->memory, cmd_line))
+		printf("%i MB written to %s\n",
+		    (int)(m->memory->physical_max / 1048576), cmd_line);
+}
+
+
 /*
  *  debugger_cmd_version():
  */
@@ -1213,12 +1315,18 @@ static struct cmd cmds[] = {
 	{ "dump", "[addr [endaddr]]", 0, debugger_cmd_dump,
 		"dump memory contents in hex and ASCII" },
 
+	{ "dyntrans", "", 0, debugger_cmd_dyntrans,
+		"show translation cache statistics" },
+
 	{ "emul", "", 0, debugger_cmd_emul,
 		"Print a summary of the current emulation" },
 
 	{ "focus", "x[,y[,z]]", 0, debugger_cmd_focus,
 		"changes focus to cpu x, machine x, emul z" },
 
+	{ "footprint", "", 0, debugger_cmd_footprint,
+		"show touched and host-resident RAM" },
+
 	{ "help", "", 0, debugger_cmd_help,
 		"Print this help message" },
 
@@ -1276,6 +1384,9 @@ static struct cmd cmds[] = {
 	{ "version", "", 0, debugger_cmd_version,
 		"Print version information" },
 
+	{ "writeram", "filename", 0, debugger_cmd_writeram,
+		"save the physical RAM to a file (see -l)" },
+
 	/*  Note: NULL handler.  */
 	{ "x = expr", "", 0, NULL, "generic assignment" },
 
@@ -134,7 +134,8 @@ DEVICE_ACCESS(8253)
 				switch (relative_addr) {
 				case 0:	if (d->timer0 == NULL)
 						d->timer0 = timer_add(
-						    d->hz[0], timer0_tick, d);
+						    cpu->machine, d->hz[0],
+						    timer0_tick, d);
 					else
 						timer_update_frequency(
 						    d->timer0, d->hz[0]);
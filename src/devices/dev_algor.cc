@@ -52,6 +52,8 @@ struct algor_data {
 	struct interrupt	mips_irq_2;
 	struct interrupt	mips_irq_3;
 	struct interrupt	mips_irq_4;
+
+	int			locint_reads;
 };
 
 
@@ -83,8 +85,7 @@ DEVICE_ACCESS(algor)
 		n = "P5064_LOCINT";
 		if (writeflag == MEM_READ) {
 			/*  Ugly hack for NetBSD startup.  TODO: fix  */
-			static int x = 0;
-			if (((++ x) & 0xffff) == 0)
+			if (((++ d->locint_reads) & 0xffff) == 0)
 				odata |= LOCINT_RTC;
 
 			if (cpu->machine->isa_pic_data.pic1->irr &
@@ -112,6 +112,7 @@ DEVICE_ACCESS(bt455)
 				d->vfb_data->update_x2 = d->vfb_data->xsize - 1;
 				d->vfb_data->update_y1 = 0;
 				d->vfb_data->update_y2 = d->vfb_data->ysize - 1;
+				dev_fb_wakeup(d->vfb_data);
 			}
 
 			/*  Advance to next palette byte:  */
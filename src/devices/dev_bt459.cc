@@ -259,6 +259,7 @@ DEVICE_TICK(bt459)
 		d->vfb_data->update_y1 = 0;
 		d->vfb_data->update_y2 = d->vfb_data->ysize - 1;
 		d->need_to_redraw_whole_screen = 0;
+		dev_fb_wakeup(d->vfb_data);
 	}
 
 	/*
@@ -78,6 +78,8 @@ DEVICE_ACCESS(cons)
 		    return 1;  */
 		/*  TODO: this doesn't work yet. for now, let's
 		    simply use exit()  */
+		if (cpu->machine->show_nr_of_instructions)
+			cpu_show_cycles(cpu->machine, 1);
 		exit(0);
 	}
 
@@ -110,6 +110,27 @@ static void set_title(struct vfb_data *d)
 }
 
 
+/*
+ *  dev_fb_wakeup():
+ *
+ *  The tick function sleeps while there is nothing to redraw. Anything which
+ *  changes the framebuffer, its update region, or the cursor, without going
+ *  through dev_fb_access() or the other dev_fb_*() functions, must call this
+ *  to wake it up again.
+ */
+void dev_fb_wakeup(struct vfb_data *d)
+{
+	if (d->machine->x11_md.in_use)
+		machine_tickfunction_wakeup(d->machine, d->tick_id);
+}
+
+
+static void dev_fb_dirty_wakeup(void *extra)
+{
+	dev_fb_wakeup((struct vfb_data *) extra);
+}
+
+
 /*
  *  dev_fb_resize():
  *
@@ -165,6 +186,7 @@ void dev_fb_resize(struct vfb_data *d, int new_xsize, int new_ysize)
 		d->update_x1 = d->update_y1 = 0;
 		d->update_x2 = new_xsize - 1;
 		d->update_y2 = new_ysize - 1;
+		dev_fb_wakeup(d);
 	}
 
 	d->bytes_per_line = new_bytes_per_line;
@@ -212,6 +234,8 @@ void dev_fb_setcursor(struct vfb_data *d, int cursor_x, int cursor_y, int on,
 	}
 #endif
 
+	dev_fb_wakeup(d);
+
 	/*  debug("dev_fb_setcursor(%i,%i, size %i,%i, on=%i)\n",
 	    cursor_x, cursor_y, cursor_xsize, cursor_ysize, on);  */
 }
@@ -306,6 +330,8 @@ void framebuffer_blockcopyfill(struct vfb_data *d, int fillflag, int fill_r,
 	if (y1 > d->update_y2 || d->update_y2 == -1)	d->update_y2 = y1;
 	if (y2 < d->update_y1 || d->update_y1 == -1)	d->update_y1 = y2;
 	if (y2 > d->update_y2 || d->update_y2 == -1)	d->update_y2 = y2;
+
+	dev_fb_wakeup(d);
 }
 
 
@@ -402,91 +428,108 @@ void (*redraw[2 * 4 * 2])(struct vfb_data *, int, int) = {
 #endif	/*  WITH_X11  */
 
 
-DEVICE_TICK(fb)
+/*
+ *  fb_extend_update_region():
+ *
+ *  Extends the update region to include the framebuffer bytes low..high.
+ */
+static void fb_extend_update_region(struct vfb_data *d, uint64_t low,
+	uint64_t high)
 {
-	struct vfb_data *d = (struct vfb_data *) extra;
-#ifdef WITH_X11
-	int need_to_flush_x11 = 0;
-	int need_to_redraw_cursor = 0;
-#endif
-
-	if (!cpu->machine->x11_md.in_use)
-		return;
-
-	do {
-		uint64_t high, low = (uint64_t)(int64_t) -1;
-		int x, y;
-
-		memory_device_dyntrans_access(cpu, cpu->mem,
-		    extra, &low, &high);
-		if ((int64_t)low == -1)
-			break;
+	int x, y;
 
-		/*  printf("low=%016llx high=%016llx\n",
-		    (long long)low, (long long)high);  */
+	x = (low % d->bytes_per_line) * 8 / d->bit_depth;
+	y = low / d->bytes_per_line;
+	if (x < d->update_x1 || d->update_x1 == -1)
+		d->update_x1 = x;
+	if (x > d->update_x2 || d->update_x2 == -1)
+		d->update_x2 = x;
+	if (y < d->update_y1 || d->update_y1 == -1)
+		d->update_y1 = y;
+	if (y > d->update_y2 || d->update_y2 == -1)
+		d->update_y2 = y;
+
+	x = ((low+7) % d->bytes_per_line) * 8 / d->bit_depth;
+	y = (low+7) / d->bytes_per_line;
+	if (x < d->update_x1 || d->update_x1 == -1)
+		d->update_x1 = x;
+	if (x > d->update_x2 || d->update_x2 == -1)
+		d->update_x2 = x;
+	if (y < d->update_y1 || d->update_y1 == -1)
+		d->update_y1 = y;
+	if (y > d->update_y2 || d->update_y2 == -1)
+		d->update_y2 = y;
+
+	x = (high % d->bytes_per_line) * 8 / d->bit_depth;
+	y = high / d->bytes_per_line;
+	if (x < d->update_x1 || d->update_x1 == -1)
+		d->update_x1 = x;
+	if (x > d->update_x2 || d->update_x2 == -1)
+		d->update_x2 = x;
+	if (y < d->update_y1 || d->update_y1 == -1)
+		d->update_y1 = y;
+	if (y > d->update_y2 || d->update_y2 == -1)
+		d->update_y2 = y;
+
+	x = ((high+7) % d->bytes_per_line) * 8 / d->bit_depth;
+	y = (high+7) / d->bytes_per_line;
+	if (x < d->update_x1 || d->update_x1 == -1)
+		d->update_x1 = x;
+	if (x > d->update_x2 || d->update_x2 == -1)
+		d->update_x2 = x;
+	if (y < d->update_y1 || d->update_y1 == -1)
+		d->update_y1 = y;
+	if (y > d->update_y2 || d->update_y2 == -1)
+		d->update_y2 = y;
 
-		x = (low % d->bytes_per_line) * 8 / d->bit_depth;
-		y = low / d->bytes_per_line;
-		if (x < d->update_x1 || d->update_x1 == -1)
-			d->update_x1 = x;
-		if (x > d->update_x2 || d->update_x2 == -1)
-			d->update_x2 = x;
-		if (y < d->update_y1 || d->update_y1 == -1)
-			d->update_y1 = y;
-		if (y > d->update_y2 || d->update_y2 == -1)
-			d->update_y2 = y;
+	/*
+	 *  An update covering more than one line will automatically
+	 *  force an update of all the affected lines:
+	 */
+	if (d->update_y1 != d->update_y2) {
+		d->update_x1 = 0;
+		d->update_x2 = d->xsize-1;
+	}
+}
 
-		x = ((low+7) % d->bytes_per_line) * 8 / d->bit_depth;
-		y = (low+7) / d->bytes_per_line;
-		if (x < d->update_x1 || d->update_x1 == -1)
-			d->update_x1 = x;
-		if (x > d->update_x2 || d->update_x2 == -1)
-			d->update_x2 = x;
-		if (y < d->update_y1 || d->update_y1 == -1)
-			d->update_y1 = y;
-		if (y > d->update_y2 || d->update_y2 == -1)
-			d->update_y2 = y;
 
-		x = (high % d->bytes_per_line) * 8 / d->bit_depth;
-		y = high / d->bytes_per_line;
-		if (x < d->update_x1 || d->update_x1 == -1)
-			d->update_x1 = x;
-		if (x > d->update_x2 || d->update_x2 == -1)
-			d->update_x2 = x;
-		if (y < d->update_y1 || d->update_y1 == -1)
-			d->update_y1 = y;
-		if (y > d->update_y2 || d->update_y2 == -1)
-			d->update_y2 = y;
+/*
+ *  fb_cursor_changed():
+ *
+ *  Returns 1 if the cursor has been moved, resized, or turned on or off since
+ *  it was last drawn. (Moving a cursor which is off does not count.)
+ */
+static int fb_cursor_changed(struct vfb_data *d)
+{
+#ifdef WITH_X11
+	if (!d->fb_window->cursor_on && !d->fb_window->OLD_cursor_on)
+		return 0;
 
-		x = ((high+7) % d->bytes_per_line) * 8 / d->bit_depth;
-		y = (high+7) / d->bytes_per_line;
-		if (x < d->update_x1 || d->update_x1 == -1)
-			d->update_x1 = x;
-		if (x > d->update_x2 || d->update_x2 == -1)
-			d->update_x2 = x;
-		if (y < d->update_y1 || d->update_y1 == -1)
-			d->update_y1 = y;
-		if (y > d->update_y2 || d->update_y2 == -1)
-			d->update_y2 = y;
+	return d->fb_window->cursor_on != d->fb_window->OLD_cursor_on ||
+	    d->fb_window->cursor_x != d->fb_window->OLD_cursor_x ||
+	    d->fb_window->cursor_y != d->fb_window->OLD_cursor_y ||
+	    d->fb_window->cursor_xsize != d->fb_window->OLD_cursor_xsize ||
+	    d->fb_window->cursor_ysize != d->fb_window->OLD_cursor_ysize;
+#else
+	return 0;
+#endif
+}
 
-		/*
-		 *  An update covering more than one line will automatically
-		 *  force an update of all the affected lines:
-		 */
-		if (d->update_y1 != d->update_y2) {
-			d->update_x1 = 0;
-			d->update_x2 = d->xsize-1;
-		}
-	} while (0);
 
+/*
+ *  fb_redraw_update_region():
+ *
+ *  Redraws the current update region (if any) in the X11 window, and then
+ *  clears the update region. The old cursor is removed if it was
+ *  overwritten or has moved; *need_to_redraw_cursor is then set, and the
+ *  caller should paint the new cursor.
+ */
+static void fb_redraw_update_region(struct vfb_data *d,
+	int *need_to_redraw_cursor, int *need_to_flush_x11)
+{
 #ifdef WITH_X11
 	/*  Do we need to redraw the cursor?  */
-	if (d->fb_window->cursor_on != d->fb_window->OLD_cursor_on ||
-	    d->fb_window->cursor_x != d->fb_window->OLD_cursor_x ||
-	    d->fb_window->cursor_y != d->fb_window->OLD_cursor_y ||
-	    d->fb_window->cursor_xsize != d->fb_window->OLD_cursor_xsize ||
-	    d->fb_window->cursor_ysize != d->fb_window->OLD_cursor_ysize)
-		need_to_redraw_cursor = 1;
+	int redraw_cursor = fb_cursor_changed(d);
 
 	if (d->update_x2 != -1) {
 		if (((d->update_x1 >= d->fb_window->OLD_cursor_x &&
@@ -507,10 +550,13 @@ DEVICE_TICK(fb)
 		     (d->update_y1 <  d->fb_window->OLD_cursor_y &&
 		      d->update_y2 >= (d->fb_window->OLD_cursor_y +
 		     d->fb_window->OLD_cursor_ysize)) ) )
-			need_to_redraw_cursor = 1;
+			redraw_cursor = 1;
 	}
 
-	if (need_to_redraw_cursor) {
+	/*  (The old cursor only needs to be removed once per tick.)  */
+	if (redraw_cursor && !*need_to_redraw_cursor) {
+		*need_to_redraw_cursor = 1;
+
 		/*  Remove old cursor, if any:  */
 		if (d->fb_window->OLD_cursor_on) {
 			XPutImage(d->fb_window->x11_display,
@@ -570,12 +616,54 @@ DEVICE_TICK(fb)
 		    (d->update_x2 - d->update_x1)/d->vfb_scaledown + 1,
 		    (d->update_y2 - d->update_y1)/d->vfb_scaledown + 1);
 
-		need_to_flush_x11 = 1;
+		*need_to_flush_x11 = 1;
 #endif
 
 		d->update_x1 = d->update_y1 = 99999;
 		d->update_x2 = d->update_y2 = -1;
 	}
+}
+
+
+DEVICE_TICK(fb)
+{
+	struct vfb_data *d = (struct vfb_data *) extra;
+	int need_to_flush_x11 = 0;
+	int need_to_redraw_cursor = 0;
+	int n_dirty_runs = 0;
+	uint64_t low, high;
+
+	/*  Without X11, there is never anything to update:  */
+	if (!cpu->machine->x11_md.in_use) {
+		machine_tickfunction_sleep(cpu->machine, d->tick_id);
+		return;
+	}
+
+	/*
+	 *  Each run of pages written to via dyntrans is redrawn separately,
+	 *  so that scattered writes (e.g. a blinking cursor and a status
+	 *  line) do not cause a redraw of everything in between. Other
+	 *  updates are redrawn together with the first run.
+	 */
+	while (memory_device_dyntrans_dirty(cpu, cpu->mem, extra,
+	    &low, &high)) {
+		fb_extend_update_region(d, low, high);
+		fb_redraw_update_region(d, &need_to_redraw_cursor,
+		    &need_to_flush_x11);
+		n_dirty_runs ++;
+	}
+
+	/*
+	 *  Nothing to redraw? Then sleep until dev_fb_wakeup() is called. (The
+	 *  pages written via dyntrans are read-only again, so the next write
+	 *  to them goes through memory_rw(), which wakes us up.)
+	 */
+	if (n_dirty_runs == 0 && d->update_x2 == -1 && !fb_cursor_changed(d)) {
+		machine_tickfunction_sleep(cpu->machine, d->tick_id);
+		return;
+	}
+
+	fb_redraw_update_region(d, &need_to_redraw_cursor, &need_to_flush_x11);
 
 #ifdef WITH_X11
 	if (need_to_redraw_cursor) {
@@ -591,6 +679,9 @@ DEVICE_TICK(fb)
 			d->fb_window->OLD_cursor_ysize = d->fb_window->
 			    cursor_ysize;
 			need_to_flush_x11 = 1;
+		} else {
+			/*  The old cursor was removed above:  */
+			d->fb_window->OLD_cursor_on = 0;
 		}
 	}
 #endif
@@ -780,6 +871,8 @@ DEVICE_ACCESS(fb)
 			d->update_x1 = 0;
 			d->update_x2 = d->xsize-1;
 		}
+
+		dev_fb_wakeup(d);
 	}
 
 	/*
@@ -843,6 +936,7 @@ struct vfb_data *dev_fb_init(struct machine *machine, struct memory *mem,
 
 	CHECK_ALLOCATION(d = (struct vfb_data *) malloc(sizeof(struct vfb_data)));
 	memset(d, 0, sizeof(struct vfb_data));
+	d->machine = machine;
 
 	if (vfb_type & VFB_REVERSE_START) {
 		vfb_type &= ~VFB_REVERSE_START;
@@ -960,7 +1054,10 @@ struct vfb_data *dev_fb_init(struct machine *machine, struct memory *mem,
 	memory_device_register(mem, name2, baseaddr, size, dev_fb_access,
 	    d, flags, d->framebuffer);
 
-	machine_add_tickfunction(machine, dev_fb_tick, d, FB_TICK_SHIFT);
+	d->tick_id = machine_add_tickfunction(machine, dev_fb_tick, d,
+	    FB_TICK_SHIFT);
+
+	memory_device_set_dirty_wakeup(mem, d, dev_fb_dirty_wakeup);
 
 	return d;
 }
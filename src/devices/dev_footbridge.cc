@@ -111,10 +111,18 @@ static void reload_timer_value(struct cpu *cpu, struct footbridge_data *d,
 
 	if (d->timer[timer_nr] == NULL) {
 		switch (timer_nr) {
-		case 0:	d->timer[0] = timer_add(freq, timer_tick0, d); break;
-		case 1:	d->timer[1] = timer_add(freq, timer_tick1, d); break;
-		case 2:	d->timer[2] = timer_add(freq, timer_tick2, d); break;
-		case 3:	d->timer[3] = timer_add(freq, timer_tick3, d); break;
+		case 0:	d->timer[0] = timer_add(cpu->machine, freq,
+			    timer_tick0, d);
+			break;
+		case 1:	d->timer[1] = timer_add(cpu->machine, freq,
+			    timer_tick1, d);
+			break;
+		case 2:	d->timer[2] = timer_add(cpu->machine, freq,
+			    timer_tick2, d);
+			break;
+		case 3:	d->timer[3] = timer_add(cpu->machine, freq,
+			    timer_tick3, d);
+			break;
 		}
 	} else {
 		timer_update_frequency(d->timer[timer_nr], freq);
@@ -162,8 +162,8 @@ DEVICE_ACCESS(gt)
 				/*  TODO: Don't hardcode this.  */
 				d->interrupt_hz = 100;
 				if (d->timer == NULL)
-					d->timer = timer_add(d->interrupt_hz,
-					    timer_tick, d);
+					d->timer = timer_add(cpu->machine,
+					    d->interrupt_hz, timer_tick, d);
 				else
 					timer_update_frequency(d->timer,
 					    d->interrupt_hz);
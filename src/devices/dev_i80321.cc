@@ -470,7 +470,7 @@ DEVINIT(i80321)
 
 	/*  TODO: Don't hardcode to 100 Hz!  */
 	d->hz = 100;
-	d->timer = timer_add(d->hz, tmr0_tick, d);
+	d->timer = timer_add(devinit->machine, d->hz, tmr0_tick, d);
 
 	machine_add_tickfunction(devinit->machine, dev_i80321_tick,
 	    d, TICK_SHIFT);
@@ -192,6 +192,7 @@ DEVICE_ACCESS(igsfb)
 					    d->vfb_data->update_y1 = 0;
 					d->vfb_data->update_x2 = d->xres - 1;
 					d->vfb_data->update_y2 = d->yres - 1;
+					dev_fb_wakeup(d->vfb_data);
 				}
 				d->palette_write_subindex ++;
 				if (d->palette_write_subindex == 3) {
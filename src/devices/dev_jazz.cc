@@ -696,7 +696,7 @@ DEVINIT(jazz)
 	    DM_DEFAULT, NULL);
 
 	/*  Add a timer, hardcoded to 100 Hz. TODO: Don't hardcode!  */
-	d->timer = timer_add(100.0, timer_tick, d);
+	d->timer = timer_add(devinit->machine, 100.0, timer_tick, d);
 	machine_add_tickfunction(devinit->machine, dev_jazz_tick,
 	    d, DEV_JAZZ_TICKSHIFT);
 
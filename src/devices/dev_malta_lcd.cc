@@ -51,6 +51,7 @@
 struct malta_lcd_data {
 	uint64_t	base_addr;
 
+	int		tick_id;
 	int		display_modified;
 	unsigned char	display[LCD_LEN];
 };
@@ -61,8 +62,11 @@ DEVICE_TICK(malta_lcd)
 	struct malta_lcd_data *d = (struct malta_lcd_data *) extra;
 	int i;
 
-	if (d->display_modified == 0)
+	if (d->display_modified == 0) {
+		/*  Nothing to show until the display is written to:  */
+		machine_tickfunction_sleep(cpu->machine, d->tick_id);
 		return;
+	}
 	if (d->display_modified == 1) {
 		d->display_modified = 2;
 		return;
@@ -105,6 +109,7 @@ DEVICE_ACCESS(malta_lcd)
 		if (writeflag == MEM_WRITE) {
 			d->display[pos] = idata;
 			d->display_modified = 1;
+			machine_tickfunction_wakeup(cpu->machine, d->tick_id);
 		} else {
 			odata = d->display[pos];
 		}
@@ -141,8 +146,8 @@ DEVINIT(malta_lcd)
 	    devinit->addr, DEV_MALTA_LCD_LENGTH,
 	    dev_malta_lcd_access, (void *)d, DM_DEFAULT, NULL);
 
-	machine_add_tickfunction(devinit->machine, dev_malta_lcd_tick,
-	    d, MALTA_LCD_TICK_SHIFT);
+	d->tick_id = machine_add_tickfunction(devinit->machine,
+	    dev_malta_lcd_tick, d, MALTA_LCD_TICK_SHIFT);
 
 	return 1;
 }
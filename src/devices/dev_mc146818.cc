@@ -443,8 +443,8 @@ DEVICE_ACCESS(mc146818)
 				d->old_interrupt_hz = d->interrupt_hz;
 
 				if (d->timer == NULL)
-					d->timer = timer_add(d->interrupt_hz,
-					    timer_tick, d);
+					d->timer = timer_add(cpu->machine,
+					    d->interrupt_hz, timer_tick, d);
 				else
 					timer_update_frequency(d->timer,
 					    d->interrupt_hz);
@@ -639,7 +639,8 @@ DEVINIT(pcc2)
 	    M187_IACK, 32, dev_mvme187_iack_access, (void *)d,
 	    DM_DEFAULT, NULL);
 
-	d->timer = timer_add(PCC_TIMER_TICK_HZ, pcc_timer_tick, d);
+	d->timer = timer_add(devinit->machine, PCC_TIMER_TICK_HZ,
+	    pcc_timer_tick, d);
 
 	machine_add_tickfunction(devinit->machine,
 	    dev_pcc2_tick, d, DEV_PCC2_TICK_SHIFT);
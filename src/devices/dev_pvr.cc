@@ -2275,77 +2275,21 @@ void pvr_extend_update_region(struct pvr_data *d, uint64_t low, uint64_t high)
 }
 
 
-DEVICE_TICK(pvr_fb)
+/*
+ *  pvr_copy_update_region():
+ *
+ *  Converts the pixels of the PVR's pending update region from VRAM into the
+ *  framebuffer, extends the framebuffer's own update region to cover it, and
+ *  clears the PVR's update region.
+ */
+static void pvr_copy_update_region(struct pvr_data *d)
 {
-	struct pvr_data *d = (struct pvr_data *) extra;
-	uint64_t high, low = (uint64_t)(int64_t) -1;
 	int vram_ofs = REG(PVRREG_DIWADDRL), pixels_to_copy;
 	int bytes_per_line = d->xsize * d->bytes_per_pixel;
 	int fb_ofs, p;
 	uint8_t *fb = (uint8_t *) d->fb->framebuffer;
 	uint8_t *vram = (uint8_t *) d->vram;
 
-
-	/*
-	 *  Vertical retrace interrupts:
-	 *
-	 *  TODO: Maybe it would be even more realistic to have the timer run
-	 *        at, say, 60*4 = 240 Hz, and have the following events:
-	 *
-	 *	  (tick & 3) == 0	SYSASIC_EVENT_VBLINT
-	 *	  (tick & 3) == 1	SYSASIC_EVENT_PVR_SCANINT1
-	 *	  (tick & 3) == 2	nothing
-	 *	  (tick & 3) == 3	SYSASIC_EVENT_PVR_SCANINT2
-	 */
-	if (d->vblank_interrupts_pending > 0) {
-		-- d->vblank_interrupts_pending;
-
-		SYSASIC_TRIGGER_EVENT(SYSASIC_EVENT_VBLINT);
-		SYSASIC_TRIGGER_EVENT(SYSASIC_EVENT_PVR_SCANINT1);
-		
-		// Is this needed?
-		SYSASIC_TRIGGER_EVENT(SYSASIC_EVENT_PVR_SCANINT2);
-
-		/*  TODO: For now, I don't care about missed interrupts:  */
-		d->vblank_interrupts_pending = 0;
-	}
-
-
-	/*
-	 *  Framebuffer update:
-	 */
-
-	/*  Border changed?  */
-	if (d->border_updated) {
-		/*  Fill border with border color:  */
-		int rgb = REG(PVRREG_BRDCOLR), addr = 0;
-		int x, y, b = rgb & 0xff, g = (rgb >> 8) & 0xff, r = rgb >> 16;
-		int skiplen = (d->fb->xsize-2*PVR_MARGIN) * d->fb->bit_depth/8;
-
-		for (y=0; y<d->fb->ysize; y++) {
-			int xskip = y < PVR_MARGIN || y >=
-			    d->fb->ysize - PVR_MARGIN? -1 : PVR_MARGIN;
-			for (x=0; x<d->fb->xsize; x++) {
-				if (x == xskip) {
-					x = d->fb->xsize - PVR_MARGIN;
-					addr += skiplen;
-				}
-				fb[addr] = r;
-				fb[addr+1] = g;
-				fb[addr+2] = b;
-				addr += 3;
-			}
-		}
-
-		/*  Full redraw of the framebuffer:  */
-		d->fb->update_x1 = 0; d->fb->update_x2 = d->fb->xsize - 1;
-		d->fb->update_y1 = 0; d->fb->update_y2 = d->fb->ysize - 1;
-	}
-
-	memory_device_dyntrans_access(cpu, cpu->mem, extra, &low, &high);
-	if ((int64_t)low != -1)
-		pvr_extend_update_region(d, low, high);
-
 	if (d->fb_update_x1 == -1)
 		return;
 
@@ -2452,6 +2396,7 @@ DEVICE_TICK(pvr_fb)
 		d->fb->update_y1 = d->fb_update_y1;
 	if (d->fb_update_y2 > d->fb->update_y2 || d->fb->update_y2 < 0)
 		d->fb->update_y2 = d->fb_update_y2;
+	dev_fb_wakeup(d->fb);
 
 	/*  Clear the PVR's update region:  */
 	d->fb_update_x1 = d->fb_update_x2 =
@@ -2459,6 +2404,86 @@ DEVICE_TICK(pvr_fb)
 }
 
 
+DEVICE_TICK(pvr_fb)
+{
+	struct pvr_data *d = (struct pvr_data *) extra;
+	uint64_t low, high;
+	uint8_t *fb = (uint8_t *) d->fb->framebuffer;
+
+
+	/*
+	 *  Vertical retrace interrupts:
+	 *
+	 *  TODO: Maybe it would be even more realistic to have the timer run
+	 *        at, say, 60*4 = 240 Hz, and have the following events:
+	 *
+	 *	  (tick & 3) == 0	SYSASIC_EVENT_VBLINT
+	 *	  (tick & 3) == 1	SYSASIC_EVENT_PVR_SCANINT1
+	 *	  (tick & 3) == 2	nothing
+	 *	  (tick & 3) == 3	SYSASIC_EVENT_PVR_SCANINT2
+	 */
+	if (d->vblank_interrupts_pending > 0) {
+		-- d->vblank_interrupts_pending;
+
+		SYSASIC_TRIGGER_EVENT(SYSASIC_EVENT_VBLINT);
+		SYSASIC_TRIGGER_EVENT(SYSASIC_EVENT_PVR_SCANINT1);
+		
+		// Is this needed?
+		SYSASIC_TRIGGER_EVENT(SYSASIC_EVENT_PVR_SCANINT2);
+
+		/*  TODO: For now, I don't care about missed interrupts:  */
+		d->vblank_interrupts_pending = 0;
+	}
+
+
+	/*
+	 *  Framebuffer update:
+	 */
+
+	/*  Border changed?  */
+	if (d->border_updated) {
+		/*  Fill border with border color:  */
+		int rgb = REG(PVRREG_BRDCOLR), addr = 0;
+		int x, y, b = rgb & 0xff, g = (rgb >> 8) & 0xff, r = rgb >> 16;
+		int skiplen = (d->fb->xsize-2*PVR_MARGIN) * d->fb->bit_depth/8;
+
+		for (y=0; y<d->fb->ysize; y++) {
+			int xskip = y < PVR_MARGIN || y >=
+			    d->fb->ysize - PVR_MARGIN? -1 : PVR_MARGIN;
+			for (x=0; x<d->fb->xsize; x++) {
+				if (x == xskip) {
+					x = d->fb->xsize - PVR_MARGIN;
+					addr += skiplen;
+				}
+				fb[addr] = r;
+				fb[addr+1] = g;
+				fb[addr+2] = b;
+				addr += 3;
+			}
+		}
+
+		/*  Full redraw of the framebuffer:  */
+		d->fb->update_x1 = 0; d->fb->update_x2 = d->fb->xsize - 1;
+		d->fb->update_y1 = 0; d->fb->update_y2 = d->fb->ysize - 1;
+		dev_fb_wakeup(d->fb);
+	}
+
+	/*  Pending updates from register writes and the alternate VRAM:  */
+	pvr_copy_update_region(d);
+
+	/*
+	 *  Pages written to via dyntrans. Each run of dirty pages is copied
+	 *  separately, so that writes to distant parts of VRAM do not cause
+	 *  everything in between to be converted too.
+	 */
+	while (memory_device_dyntrans_dirty(cpu, cpu->mem, extra,
+	    &low, &high)) {
+		pvr_extend_update_region(d, low, high);
+		pvr_copy_update_region(d);
+	}
+}
+
+
 DEVICE_ACCESS(pvr_vram_alt)
 {
 	struct pvr_data_alt *d_alt = (struct pvr_data_alt *) extra;
@@ -2581,7 +2606,8 @@ DEVINIT(pvr)
 	    d->xsize + PVR_MARGIN*2, d->ysize + PVR_MARGIN*2,
 	    24, "Dreamcast PVR");
 
-	d->vblank_timer = timer_add(PVR_VBLANK_HZ, pvr_vblank_timer_tick, d);
+	d->vblank_timer = timer_add(devinit->machine, PVR_VBLANK_HZ,
+	    pvr_vblank_timer_tick, d);
 
 	pvr_reset(d);
 	pvr_reset_ta(d);
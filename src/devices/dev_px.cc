@@ -331,6 +331,7 @@ void dev_px_dma(struct cpu *cpu, uint32_t sys_addr, struct px_data *d)
 				d->vfb_data->update_y1 = span_src;
 			if ((int32_t)span_src > d->vfb_data->update_y2)
 				d->vfb_data->update_y2 = span_src;
+			dev_fb_wakeup(d->vfb_data);
 		}
 	}
 
@@ -423,6 +424,8 @@ void dev_px_dma(struct cpu *cpu, uint32_t sys_addr, struct px_data *d)
 			if (fb_y > d->vfb_data->update_y2)
 				d->vfb_data->update_y2 = fb_y;
 		}
+
+		dev_fb_wakeup(d->vfb_data);
 	}
 
 	/*  NetBSD and Ultrix putchar  */
@@ -548,6 +551,8 @@ void dev_px_dma(struct cpu *cpu, uint32_t sys_addr, struct px_data *d)
 			d->vfb_data->update_x1 = x;
 		if (x2 > d->vfb_data->update_x2)
 			d->vfb_data->update_x2 = x2;
+
+		dev_fb_wakeup(d->vfb_data);
 		}
 	}
 }
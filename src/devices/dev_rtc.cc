@@ -121,8 +121,8 @@ DEVICE_ACCESS(rtc)
 			} else {
 				/*  Add a timer, or update the existing one:  */
 				if (d->timer == NULL)
-					d->timer = timer_add(d->hz,
-					    timer_tick, d);
+					d->timer = timer_add(cpu->machine,
+					    d->hz, timer_tick, d);
 				else
 					timer_update_frequency(d->timer, d->hz);
 			}
@@ -106,6 +106,7 @@ struct sgi_gbe_data {
 	int		cmap_select;
 	uint32_t	selected_palette[256];
 	struct vfb_data *fb_data;
+	int		tick_id;
 };
 
 
@@ -168,8 +169,11 @@ DEVICE_TICK(sgi_gbe)
 	int bytes_per_pixel = d->bitdepth / 8;
 	int partial_pixels, width_in_tiles;
 
-	if (!cpu->machine->x11_md.in_use)
+	/*  Without X11, there is never anything to update:  */
+	if (!cpu->machine->x11_md.in_use) {
+		machine_tickfunction_sleep(cpu->machine, d->tick_id);
 		return;
+	}
 
 	// If not frozen...
 	if (!(d->freeze & 0x80000000)) {
@@ -201,6 +205,8 @@ DEVICE_TICK(sgi_gbe)
 		width_in_tiles = d->width_in_tiles;
 		select_palette(d, d->cmap_select);
 	} else {
+		/*  No DMA; sleep until the registers are written to:  */
+		machine_tickfunction_sleep(cpu->machine, d->tick_id);
 		return;
 	}
 
@@ -209,8 +215,10 @@ DEVICE_TICK(sgi_gbe)
 		bytes_per_pixel);
 #endif
 
-	if (tiletable == 0)
+	if (tiletable == 0) {
+		machine_tickfunction_sleep(cpu->machine, d->tick_id);
 		return;
+	}
 
 	// Nr of tiles horizontally:
 	int w = width_in_tiles + (partial_pixels > 0 ? 1 : 0);
@@ -729,6 +737,11 @@ DEVICE_ACCESS(sgi_gbe)
 		memory_writemax64(cpu, data, len, odata);
 	}
 
+	/*  The tick function may have gone to sleep while there was no
+	    DMA to do:  */
+	if (writeflag == MEM_WRITE)
+		machine_tickfunction_wakeup(cpu->machine, d->tick_id);
+
 	return 1;
 }
 
@@ -767,7 +780,8 @@ void dev_sgi_gbe_init(struct machine *machine, struct memory *mem, uint64_t base
 
 	memory_device_register(mem, "sgi_gbe", baseaddr, DEV_SGI_GBE_LENGTH,
 	    dev_sgi_gbe_access, d, DM_DEFAULT, NULL);
-	machine_add_tickfunction(machine, dev_sgi_gbe_tick, d, 19);
+	d->tick_id = machine_add_tickfunction(machine, dev_sgi_gbe_tick,
+	    d, 19);
 }
 
 
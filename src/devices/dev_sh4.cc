@@ -1973,7 +1973,8 @@ DEVINIT(sh4)
 	 *  Timer:
 	 */
 
-	d->sh4_timer = timer_add(SH4_PSEUDO_TIMER_HZ, sh4_timer_tick, d);
+	d->sh4_timer = timer_add(devinit->machine,
+	    SH4_PSEUDO_TIMER_HZ, sh4_timer_tick, d);
 	machine_add_tickfunction(devinit->machine, dev_sh4_tick, d,
 	    SH4_TICK_SHIFT);
 
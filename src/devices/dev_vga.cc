@@ -504,34 +504,48 @@ static void vga_update_cursor(struct machine *machine, struct vga_data *d)
 DEVICE_TICK(vga)
 {
 	struct vga_data *d = (struct vga_data *) extra;
-	int64_t low = -1, high;
+	uint64_t low, high;
 
 	vga_update_cursor(cpu->machine, d);
 
-	/*  TODO: text vs graphics tick?  */
-	memory_device_dyntrans_access(cpu, cpu->mem, extra,
-	    (uint64_t *) &low, (uint64_t *) &high);
-
-	if (low != -1) {
+	/*
+	 *  Character cells written to via dyntrans. In text mode, the rows
+	 *  of each run of dirty pages are redrawn directly, instead of
+	 *  extending the update region to span all runs.
+	 *
+	 *  TODO: text vs graphics tick?
+	 */
+	while (memory_device_dyntrans_dirty(cpu, cpu->mem, extra,
+	    &low, &high)) {
 		int base = ((d->crtc_reg[VGA_CRTC_START_ADDR_HIGH] << 8)
 		    + d->crtc_reg[VGA_CRTC_START_ADDR_LOW]) * 2;
+		int64_t rlow = (int64_t) low - base, rhigh = (int64_t) high - base;
 		int new_u_y1, new_u_y2;
+
 		debug("[ dev_vga_tick: dyntrans access, %" PRIx64" .. %"
 		    PRIx64" ]\n", (uint64_t) low, (uint64_t) high);
-		low -= base;
-		high -= base;
+
+		new_u_y1 = (rlow/2) / d->max_x;
+		new_u_y2 = ((rhigh/2) / d->max_x) + 1;
+		if (new_u_y1 < 0)
+			new_u_y1 = 0;
+		if (new_u_y2 >= d->max_y)
+			new_u_y2 = d->max_y - 1;
+		if (new_u_y1 > new_u_y2)
+			continue;
+
+		if (d->cur_mode == MODE_CHARCELL) {
+			vga_update_text(cpu->machine, d, 0, new_u_y1,
+			    d->max_x - 1, new_u_y2);
+			continue;
+		}
+
 		d->update_x1 = 0;
 		d->update_x2 = d->max_x - 1;
-		new_u_y1 = (low/2) / d->max_x;
-		new_u_y2 = ((high/2) / d->max_x) + 1;
 		if (new_u_y1 < d->update_y1)
 			d->update_y1 = new_u_y1;
 		if (new_u_y2 > d->update_y2)
 			d->update_y2 = new_u_y2;
-		if (d->update_y1 < 0)
-			d->update_y1 = 0;
-		if (d->update_y2 >= d->max_y)
-			d->update_y2 = d->max_y - 1;
 		d->modified = 1;
 	}
 
@@ -607,7 +607,8 @@ DEVICE_ACCESS(vr41xx)
 			int hz = RTCL1_L_HZ / idata;
 			debug("[ vr41xx: rtc interrupts at %i Hz ]\n", hz);
 			if (d->timer == NULL)
-				d->timer = timer_add(hz, timer_tick, d);
+				d->timer = timer_add(cpu->machine, hz,
+				    timer_tick, d);
 			else
 				timer_update_frequency(d->timer, hz);
 		}
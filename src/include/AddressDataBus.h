@@ -139,6 +139,33 @@ public:
 	 *	because of a timeout).
 	 */
 	virtual bool WriteData(const uint64_t& data, Endianness endianness) = 0;
+
+	/**
+	 * \brief Looks up host memory which backs a page of the bus.
+	 *
+	 * Components whose contents are simply kept in host memory (such as
+	 * the RAMComponent) may return a pointer to that memory, which allows
+	 * a caller to read or write the page directly instead of going
+	 * through AddressSelect() and ReadData()/WriteData() for every
+	 * access. The data in the page is stored in the same byte order as
+	 * used by ReadData()/WriteData() with the corresponding endianness.
+	 *
+	 * The pointer is only valid until the component's cached state is
+	 * flushed or the component is reset. The default implementation
+	 * returns NULL, meaning that the page may not be accessed directly.
+	 *
+	 * @param address The address of the page. This must be a multiple
+	 *	of pageSize.
+	 * @param pageSize The size of the page, in bytes. This must be a
+	 *	power of two.
+	 * @param forWriting True if the page will be written to.
+	 * @return A pointer to the host memory of the page, or NULL.
+	 */
+	virtual uint8_t* LookupHostPage(uint64_t address, uint64_t pageSize,
+		bool forWriting)
+	{
+		return NULL;
+	}
 };
 
 
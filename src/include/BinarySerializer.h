@@ -0,0 +1,258 @@
+#ifndef BINARYSERIALIZER_H
+#define	BINARYSERIALIZER_H
+
+/*
+ *  Copyright (C) 2007-2019  Anders Gavare.  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright  
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE   
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ */
+
+#include "misc.h"
+
+#include "UnitTest.h"
+
+
+/**
+ * \brief Writes a binary, chunked representation of objects.
+ *
+ * This is an alternative to the textual serialization format, meant for
+ * large amounts of state (e.g. the contents of RAM components).
+ *
+ * Everything is written in little endian byte order. The output starts
+ * with an 8-byte magic value, followed by chunks. Each chunk consists
+ * of a 4-character tag, a 64-bit payload length, and the payload itself.
+ * Chunks may be nested, i.e. a chunk's payload may contain other chunks.
+ *
+ * Small items (numbers, strings, chunk headers) are copied into a buffer
+ * owned by the serializer. Memory written with WriteMemory() is only
+ * referenced, and written directly from where it is when the result is
+ * written to a file, using writev(2). It must therefore stay unmodified
+ * until WriteToFile() or GetBytes() has been called.
+ */
+class BinarySerializer
+	: public UnitTestable
+{
+public:
+	/**
+	 * \brief Constructs a %BinarySerializer, and writes the magic value.
+	 *
+	 * @param compress If true, memory written with WriteMemory() is
+	 *	compressed (when that makes it smaller).
+	 */
+	BinarySerializer(bool compress = false);
+
+	/**
+	 * \brief Checks whether or not the magic value at the start of a
+	 *	buffer is that of the binary serialization format.
+	 *
+	 * @param data Pointer to the start of the buffer.
+	 * @param size The size of the buffer, in bytes.
+	 * @return true if the buffer starts with the magic value.
+	 */
+	static bool HasMagic(const void* data, size_t size);
+
+	/**
+	 * \brief Starts a new chunk.
+	 *
+	 * @param tag A 4-character tag, identifying the chunk.
+	 * @return A handle, to be passed to EndChunk().
+	 */
+	size_t BeginChunk(const char* tag);
+
+	/**
+	 * \brief Ends a chunk started by BeginChunk(), by filling in its
+	 *	payload length.
+	 *
+	 * @param chunk The handle returned by BeginChunk().
+	 */
+	void EndChunk(size_t chunk);
+
+	void WriteUInt8(uint8_t value);
+	void WriteUInt32(uint32_t value);
+	void WriteUInt64(uint64_t value);
+
+	/**
+	 * \brief Writes a string, prefixed by its length.
+	 *
+	 * @param str The string to write.
+	 */
+	void WriteString(const string& str);
+
+	/**
+	 * \brief Writes a block of memory.
+	 *
+	 * The memory is not copied, unless it is compressed.
+	 *
+	 * @param data Pointer to the memory.
+	 * @param size The number of bytes to write.
+	 */
+	void WriteMemory(const void* data, size_t size);
+
+	/**
+	 * \brief Gets the total number of bytes written so far.
+	 *
+	 * @return The number of bytes.
+	 */
+	uint64_t GetSize() const;
+
+	/**
+	 * \brief Writes everything to a file descriptor.
+	 *
+	 * @param fd The file descriptor to write to.
+	 * @return true if everything was written, false on error.
+	 */
+	bool WriteToFile(int fd) const;
+
+	/**
+	 * \brief Gets a copy of everything written, e.g. for unit tests.
+	 *
+	 * @param bytes A vector which will be filled with the bytes.
+	 */
+	void GetBytes(vector<uint8_t>& bytes) const;
+
+	/**
+	 * \brief Compresses a buffer.
+	 *
+	 * The compressed format is similar to that of LZ4 blocks: each
+	 * sequence starts with a token byte holding the number of literal
+	 * bytes and the match length, followed by the literals, a 16-bit
+	 * offset back to the match, and any extra length bytes. The last
+	 * sequence has only literals.
+	 *
+	 * @param src The data to compress.
+	 * @param size The number of bytes to compress.
+	 * @param dst A vector to which the compressed data is appended.
+	 */
+	static void Compress(const uint8_t* src, size_t size,
+		vector<uint8_t>& dst);
+
+	/**
+	 * \brief Decompresses data compressed by Compress().
+	 *
+	 * @param src The compressed data.
+	 * @param srcSize The size of the compressed data.
+	 * @param dst Where to put the decompressed data.
+	 * @param dstSize The exact size of the decompressed data.
+	 * @return true if the data could be decompressed, false if it
+	 *	was corrupt.
+	 */
+	static bool Decompress(const uint8_t* src, size_t srcSize,
+		uint8_t* dst, size_t dstSize);
+
+
+	/********************************************************************/
+
+	static void RunUnitTests(int& nSucceeded, int& nFailures);
+
+private:
+	void WriteOwned(const void* data, size_t size);
+
+private:
+	struct Piece
+	{
+		const uint8_t*	m_external;	// NULL for owned data
+		size_t		m_offset;	// into m_owned
+		size_t		m_size;
+	};
+
+	bool			m_compress;
+	vector<uint8_t>		m_owned;
+	vector<Piece>		m_pieces;
+	uint64_t		m_size;
+};
+
+
+/**
+ * \brief Reads data written by a BinarySerializer.
+ *
+ * The data is not copied; the %BinaryDeserializer only keeps a pointer
+ * to it, so it can for example be a file which is mapped using mmap(2).
+ * All Read functions return false (and leave the deserializer at the end
+ * of the data) if there is not enough data left.
+ */
+class BinaryDeserializer
+{
+public:
+	/**
+	 * \brief Constructs a %BinaryDeserializer for a buffer.
+	 *
+	 * Note that the magic value is not skipped automatically; use
+	 * ReadMagic().
+	 *
+	 * @param data Pointer to the data.
+	 * @param size The size of the data, in bytes.
+	 */
+	BinaryDeserializer(const void* data, size_t size);
+
+	/**
+	 * \brief Reads and checks the magic value.
+	 *
+	 * @return true if the magic value was correct.
+	 */
+	bool ReadMagic();
+
+	/**
+	 * \brief Checks whether all data has been read.
+	 *
+	 * @return true if there is no more data.
+	 */
+	bool AtEnd() const;
+
+	/**
+	 * \brief Reads a chunk.
+	 *
+	 * @param tag Set to the chunk's 4-character tag.
+	 * @param payload Set to a %BinaryDeserializer for the chunk's
+	 *	payload. This deserializer skips past the entire payload.
+	 * @return true if a chunk was read.
+	 */
+	bool ReadChunk(string& tag, BinaryDeserializer& payload);
+
+	bool ReadUInt8(uint8_t& value);
+	bool ReadUInt32(uint32_t& value);
+	bool ReadUInt64(uint64_t& value);
+	bool ReadString(string& str);
+
+	/**
+	 * \brief Reads a block of memory written by
+	 *	BinarySerializer::WriteMemory().
+	 *
+	 * @param dst Where to put the data.
+	 * @param size The size of the memory block; it must match the
+	 *	size that was written.
+	 * @return true if the memory block was read.
+	 */
+	bool ReadMemory(void* dst, size_t size);
+
+private:
+	const uint8_t* Read(size_t size);
+
+private:
+	const uint8_t*	m_data;
+	size_t		m_size;
+	size_t		m_pos;
+};
+
+
+#endif	// BINARYSERIALIZER_H
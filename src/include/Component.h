@@ -166,6 +166,26 @@ public:
 	void DetectChanges(const refcount_ptr<Component>& oldClone,
 		ostream& changeMessages) const;
 
+	/**
+	 * \brief Remembers the current state of the component and all its
+	 * children.
+	 *
+	 * This is a cheaper alternative to LightClone(), for when changes are
+	 * to be detected in the same tree later on. No components are cloned;
+	 * each state variable just remembers its own value.
+	 */
+	void RememberState();
+
+	/**
+	 * \brief Finds changes since the last call to RememberState().
+	 *
+	 * The messages are the same as the ones produced by
+	 * DetectChanges(const refcount_ptr<Component>&, ostream&).
+	 *
+	 * @param changeMessages An output stream where to send messages.
+	 */
+	void DetectChangesSinceRemembered(ostream& changeMessages) const;
+
 	/**
 	 * \brief Generates an ASCII tree dump of a component tree.
 	 *
@@ -528,11 +548,39 @@ public:
 	static refcount_ptr<Component> Deserialize(ostream& messages,
 	    const string& str, size_t& pos);
 
+	/**
+	 * \brief Serializes the %Component, including all its children,
+	 *	in binary form.
+	 *
+	 * The component becomes one chunk, containing one chunk per state
+	 * variable and one (nested) chunk per child component.
+	 *
+	 * @param serializer The %BinarySerializer to write to.
+	 */
+	void SerializeBinary(BinarySerializer& serializer) const;
+
+	/**
+	 * \brief Deserializes a component tree written by SerializeBinary().
+	 *
+	 * @param messages A stream where errors/warnings may be reported.
+	 * @param deserializer A %BinaryDeserializer positioned at the
+	 *	component's chunk. (The magic value must already have been
+	 *	read.)
+	 * @return If deserialization was successful, the
+	 *	reference counted pointer will point to a component tree;
+	 *	on error, it will be set to NULL
+	 */
+	static refcount_ptr<Component> DeserializeBinary(ostream& messages,
+	    BinaryDeserializer& deserializer);
+
 	/**
 	 * \brief Checks consistency by serializing and deserializing the
 	 *	component (including all its child components), and comparing
 	 *	the checksum of the original tree with the deserialized tree.
 	 *
+	 * Both the textual and the binary (with and without compression)
+	 * formats are checked.
+	 *
 	 * @return true if the serialization/deserialization was correct,
 	 *	false if there was some inconsistency
 	 */
@@ -729,6 +777,7 @@ private:
 private:
 	Component*		m_parentComponent;
 	Components		m_childComponents;
+	Components		m_rememberedChildComponents;
 	string			m_className;
 	string			m_visibleClassName;
 	StateVariableMap	m_stateVariables;
@@ -223,6 +223,18 @@ public:
 	 */
 	void SetSnapshottingEnabled(bool enabled);
 
+	/**
+	 * \brief Gets the number of snapshots currently kept.
+	 *
+	 * When snapshotting is enabled, a snapshot is taken at step 0, and
+	 * then every root.snapshotInterval steps. At most root.maxSnapshots
+	 * snapshots are kept; when there are more, the oldest ones (except
+	 * the one at step 0) are thrown away.
+	 *
+	 * @return The number of snapshots.
+	 */
+	size_t GetNrOfSnapshots() const;
+
 	/**
 	 * \brief Gets the current quiet mode setting.
 	 *
@@ -311,9 +323,33 @@ private:
 
 	/**
 	 * \brief Takes a snapshot of the full emulation state.
+	 *
+	 * If there already is a snapshot for the current step, nothing
+	 * happens.
 	 */
 	void TakeSnapshot();
 
+	/**
+	 * \brief Takes a snapshot, if snapshotting is enabled and the current
+	 * step is 0 or a multiple of root.snapshotInterval.
+	 */
+	void TakeSnapshotIfDue();
+
+	/**
+	 * \brief Gets the number of steps between snapshots.
+	 *
+	 * @return root.snapshotInterval, or 0 if periodic snapshots should
+	 *	not be taken.
+	 */
+	uint64_t GetSnapshotInterval() const;
+
+	/**
+	 * \brief Gets the synchronization quantum used with sloppy accuracy.
+	 *
+	 * @return root.syncQuantum, but at least 1.
+	 */
+	uint64_t GetSyncQuantum() const;
+
 
 	/********************************************************************/
 public:
@@ -339,9 +375,15 @@ private:
 	string			m_emulationFileName;
 	refcount_ptr<Component>	m_rootComponent;
 
-	// Snapshotting:   TODO: Multiple snapshots!
+	// Snapshotting:
+	struct Snapshot
+	{
+		uint64_t		step;
+		refcount_ptr<Component>	root;
+	};
+
 	bool			m_snapshottingEnabled;
-	refcount_ptr<Component>	m_snapshot;
+	vector<Snapshot>	m_snapshots;	// sorted by step
 };
 
 #endif	// GXEMUL_H
@@ -34,6 +34,7 @@
 
 #include "misc.h"
 
+#include "BinarySerializer.h"
 #include "SerializationContext.h"
 #include "UnitTest.h"
 
@@ -56,6 +57,33 @@ public:
 	virtual void Serialize(ostream& ss) const = 0;
 	virtual bool Deserialize(const string& value) = 0;
 	virtual void CopyValueFrom(CustomStateVariableHandler* other) = 0;
+
+	/**
+	 * \brief Serializes the value in binary form.
+	 *
+	 * The default implementation writes the textual form as a string.
+	 * Handlers of large amounts of data should override this.
+	 *
+	 * @param serializer The %BinarySerializer to write to.
+	 */
+	virtual void SerializeBinary(BinarySerializer& serializer) const
+	{
+		stringstream ss;
+		Serialize(ss);
+		serializer.WriteString(ss.str());
+	}
+
+	/**
+	 * \brief Deserializes a value written by SerializeBinary().
+	 *
+	 * @param deserializer A %BinaryDeserializer for the serialized value.
+	 * @return true if the value was deserialized, false otherwise.
+	 */
+	virtual bool DeserializeBinary(BinaryDeserializer& deserializer)
+	{
+		string value;
+		return deserializer.ReadString(value) && Deserialize(value);
+	}
 };
 
 
@@ -221,6 +249,42 @@ public:
 	 */
 	void Serialize(ostream& ss, SerializationContext& context) const;
 
+	/**
+	 * \brief Serializes the variable (type, name, and value) in binary
+	 *	form, as a chunk.
+	 *
+	 * @param serializer The %BinarySerializer to write to.
+	 */
+	void SerializeBinary(BinarySerializer& serializer) const;
+
+	/**
+	 * \brief Deserializes the value of the variable from the payload
+	 *	of a chunk written by SerializeBinary().
+	 *
+	 * The value is written directly, without checks, just like when
+	 * copying it from another variable.
+	 *
+	 * @param type The type of the serialized variable, as read using
+	 *	ReadBinaryHeader().
+	 * @param deserializer A %BinaryDeserializer positioned at the value.
+	 * @return true if the value was deserialized, false if the types
+	 *	differed or the data was corrupt.
+	 */
+	bool DeserializeBinaryValue(enum Type type,
+		BinaryDeserializer& deserializer);
+
+	/**
+	 * \brief Reads the type and name of a variable, written by
+	 *	SerializeBinary().
+	 *
+	 * @param deserializer A %BinaryDeserializer for the chunk payload.
+	 * @param type Set to the type of the variable.
+	 * @param name Set to the name of the variable.
+	 * @return true if the type and name could be read.
+	 */
+	static bool ReadBinaryHeader(BinaryDeserializer& deserializer,
+		enum Type& type, string& name);
+
 	/**
 	 * \brief Copy the value from another variable into this variable.
 	 *
@@ -276,6 +340,32 @@ public:
 	 */
 	bool SetValue(uint64_t value);
 
+	/**
+	 * \brief Remembers the current value of the variable.
+	 *
+	 * Together with HasChangedSinceRemembered(), this makes it possible to
+	 * find out which variables were changed by e.g. a single step of
+	 * execution, without having to clone the component tree first.
+	 */
+	void RememberValue();
+
+	/**
+	 * \brief Checks whether the variable's value differs from the value
+	 * it had when RememberValue() was last called.
+	 *
+	 * Custom variables are never reported as changed.
+	 *
+	 * @return True if the value has changed, false otherwise.
+	 */
+	bool HasChangedSinceRemembered() const;
+
+	/**
+	 * \brief Returns the remembered value as a readable string.
+	 *
+	 * @return A string, formatted in the same way as ToString().
+	 */
+	string RememberedValueToString() const;
+
 
 	/********************************************************************/
 
@@ -326,6 +416,21 @@ private:
 		int64_t*	psint64;
 		CustomStateVariableHandler *phandler;
 	} m_value;
+
+	// The value at the time of the last RememberValue() call:
+	union {
+		bool		vbool;
+		double		vdouble;
+		uint8_t		vuint8;
+		uint16_t	vuint16;
+		uint32_t	vuint32;
+		uint64_t	vuint64;
+		int8_t		vsint8;
+		int16_t		vsint16;
+		int32_t		vsint32;
+		int64_t		vsint64;
+	} m_remembered;
+	string			m_rememberedString;
 };
 
 
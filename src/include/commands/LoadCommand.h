@@ -57,8 +57,12 @@ public:
 
 private:
 	bool IsComponentTree(GXemul& gxemul, const string& filename) const;
+	bool IsBinaryComponentTree(const string& filename) const;
 	bool LoadComponentTree(GXemul& gxemul, const string&filename,
 		refcount_ptr<Component> specifiedComponent) const;
+	bool AddLoadedComponentTree(GXemul& gxemul, const string& filename,
+		refcount_ptr<Component> component,
+		refcount_ptr<Component> specifiedComponent) const;
 };
 
 
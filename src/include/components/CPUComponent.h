@@ -37,6 +37,10 @@
 #include "UnitTest.h"
 
 
+// Number of entries in the virtual to host page cache. Must be a power of 2.
+#define	N_HOST_PAGE_CACHE_ENTRIES	256
+
+
 /**
  * \brief A base-class for processors Component implementations.
  */
@@ -173,6 +177,74 @@ protected:
 		return pc;
 	}
 
+	/**
+	 * \brief Gets a host pointer for direct access to emulated memory.
+	 *
+	 * Recently used virtual pages which are backed by host memory
+	 * (see AddressDataBus::LookupHostPage()) are kept in a small
+	 * direct-mapped cache. If vaddr hits in the cache, the caller can
+	 * access the data with a plain pointer dereference (in the byte
+	 * order given by HostByteOrder()), instead of using AddressSelect()
+	 * and ReadData()/WriteData() through the whole bus hierarchy.
+	 *
+	 * The access must not cross a page boundary.
+	 *
+	 * @param vaddr The virtual address.
+	 * @param forWriting True if the access is a store.
+	 * @return A pointer to the host memory for vaddr, or NULL if the
+	 *	access has to go the slow way.
+	 */
+	uint8_t* HostPointer(uint64_t vaddr, bool forWriting)
+	{
+		const HostPageCacheEntry& entry = m_hostPageCache[
+		    (vaddr >> m_hostPageShift) &
+		    (N_HOST_PAGE_CACHE_ENTRIES - 1)];
+		uint64_t offset = vaddr & (m_pageSize - 1);
+
+		if (entry.hostPage != NULL && entry.vaddr == vaddr - offset
+		    && (entry.writable || !forWriting))
+			return entry.hostPage + offset;
+
+		return HostPointerSlow(vaddr, forWriting);
+	}
+
+	/**
+	 * \brief Invalidates all entries in the virtual to host page cache.
+	 *
+	 * CPU implementations must call this whenever a change of their
+	 * virtual to physical address translation (e.g. a TLB or MMU update)
+	 * may make any cached translation stale.
+	 */
+	void FlushHostPageCache();
+
+	/**
+	 * \brief Converts data between the host's byte order and a
+	 *	specific endianness.
+	 *
+	 * The conversion is symmetric, so the same function is used both
+	 * after loading from and before storing to host memory returned by
+	 * HostPointer().
+	 */
+	static uint8_t HostByteOrder(uint8_t data, Endianness endianness)
+	{
+		return data;
+	}
+	static uint16_t HostByteOrder(uint16_t data, Endianness endianness)
+	{
+		return endianness == BigEndian? BE16_TO_HOST(data)
+		    : LE16_TO_HOST(data);
+	}
+	static uint32_t HostByteOrder(uint32_t data, Endianness endianness)
+	{
+		return endianness == BigEndian? BE32_TO_HOST(data)
+		    : LE32_TO_HOST(data);
+	}
+	static uint64_t HostByteOrder(uint64_t data, Endianness endianness)
+	{
+		return endianness == BigEndian? BE64_TO_HOST(data)
+		    : LE64_TO_HOST(data);
+	}
+
 	// CPUComponent:
 	bool FunctionTraceCall();
 	bool FunctionTraceReturn();
@@ -184,6 +256,7 @@ protected:
 
 private:
 	bool LookupAddressDataBus(GXemul* gxemul = NULL);
+	uint8_t* HostPointerSlow(uint64_t vaddr, bool forWriting);
 
 protected:
 	/*
@@ -227,6 +300,16 @@ protected:
 	uint64_t		m_addressSelect;
 	bool			m_exceptionOrAbortInDelaySlot;
 
+	// Virtual to host page cache:
+	struct HostPageCacheEntry {
+		uint64_t	vaddr;
+		uint8_t *	hostPage;
+		bool		writable;
+	};
+
+	int			m_hostPageShift;
+	HostPageCacheEntry	m_hostPageCache[N_HOST_PAGE_CACHE_ENTRIES];
+
 private:
 	SymbolRegistry		m_symbolRegistry;
 };
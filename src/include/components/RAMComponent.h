@@ -69,6 +69,11 @@
  *
  * Note 2: The RAM component's size and base offset are defined by state
  * variables in the MemoryMappedComponent base class.
+ *
+ * Note 3: When a RAMComponent is cloned (e.g. when a snapshot of the
+ * emulation is taken), the host memory blocks are not copied. Instead, they
+ * are shared between the original and the clone, and a block is only copied
+ * when one of them is about to write to it (copy-on-write).
  */
 class RAMComponent
 	: public MemoryMappedComponent
@@ -94,6 +99,8 @@ public:
 
 	virtual void ResetState();
 
+	virtual void FlushCachedStateForComponent();
+
 	/**
 	 * \brief Get attribute information about the RAMComponent class.
 	 *
@@ -127,6 +134,8 @@ public:
 	virtual bool WriteData(const uint16_t& data, Endianness endianness);
 	virtual bool WriteData(const uint32_t& data, Endianness endianness);
 	virtual bool WriteData(const uint64_t& data, Endianness endianness);
+	virtual uint8_t* LookupHostPage(uint64_t address, uint64_t pageSize,
+		bool forWriting);
 
 
 	/********************************************************************/
@@ -134,9 +143,32 @@ public:
 	static void RunUnitTests(int& nSucceeded, int& nFailures);
 
 private:
+	/**
+	 * \brief A block of host memory, which may be referenced by more
+	 * than one RAMComponent.
+	 */
+	class MemoryBlock : public ReferenceCountable
+	{
+	public:
+		MemoryBlock(size_t size, bool zeroFilled = true);
+		~MemoryBlock();
+
+	public:
+		size_t			m_size;
+		void *			m_data;
+
+		// The RAMComponent which has handed out host pointers into
+		// this block (using LookupHostPage), or NULL if there are
+		// no such pointers in use.
+		const RAMComponent *	m_hostPointerOwner;
+	};
+
 	void ReleaseAllBlocks();
 
-	void* AllocateBlock();
+	void* AllocateBlock(uint64_t blockNr);
+	void* GetWritableBlock(uint64_t blockNr);
+	void MakeSelectedBlockWritable();
+	void ShareBlocksFrom(const RAMComponent& other);
 
 	class RAMDataHandler : public CustomStateVariableHandler
 	{
@@ -153,8 +185,9 @@ private:
 		virtual void Serialize(ostream& ss) const
 		{
 			for (size_t i=0; i<m_ram.m_memoryBlocks.size(); ++i)
-				if (m_ram.m_memoryBlocks[i] != NULL)
-					SerializeMemoryBlock(ss, i, m_ram.m_memoryBlocks[i]);
+				if (!m_ram.m_memoryBlocks[i].IsNULL())
+					SerializeMemoryBlock(ss, i,
+					    m_ram.m_memoryBlocks[i]->m_data);
 
 			// End of data.
 			ss << ".";
@@ -238,13 +271,83 @@ private:
 			return true;
 		}
 		
+		virtual void SerializeBinary(BinarySerializer& serializer) const
+		{
+			// Runs of pages which are not all zeroes are written as
+			// address, length, and the raw memory.
+			const size_t pageSize = 4096;
+
+			for (size_t i=0; i<m_ram.m_memoryBlocks.size(); ++i) {
+				if (m_ram.m_memoryBlocks[i].IsNULL())
+					continue;
+
+				const uint8_t* block = (const uint8_t*)
+				    m_ram.m_memoryBlocks[i]->m_data;
+				uint64_t blockAddr = (uint64_t)i << m_ram.m_blockSizeShift;
+				size_t runStart = 0;
+				size_t runLength = 0;
+
+				for (size_t ofs=0; ofs<m_ram.m_blockSize; ofs+=pageSize) {
+					bool allZeroes = true;
+					for (size_t j=0; j<pageSize; j++)
+						if (block[ofs + j] != 0x00) {
+							allZeroes = false;
+							break;
+						}
+
+					if (!allZeroes) {
+						if (runLength == 0)
+							runStart = ofs;
+						runLength += pageSize;
+						continue;
+					}
+
+					if (runLength > 0)
+						SerializeRun(serializer, blockAddr,
+						    block, runStart, runLength);
+					runLength = 0;
+				}
+
+				if (runLength > 0)
+					SerializeRun(serializer, blockAddr,
+					    block, runStart, runLength);
+			}
+		}
+
+		virtual bool DeserializeBinary(BinaryDeserializer& deserializer)
+		{
+			m_ram.ReleaseAllBlocks();
+
+			while (!deserializer.AtEnd()) {
+				uint64_t addr, length;
+				if (!deserializer.ReadUInt64(addr) ||
+				    !deserializer.ReadUInt64(length))
+					return false;
+
+				// A run never crosses a block boundary.
+				uint64_t blockNr = addr >> m_ram.m_blockSizeShift;
+				size_t offset = addr & (m_ram.m_blockSize - 1);
+				if (length > m_ram.m_blockSize - offset)
+					return false;
+
+				uint8_t* block = (uint8_t*)
+				    m_ram.GetWritableBlock(blockNr);
+				if (!deserializer.ReadMemory(block + offset, length))
+					return false;
+			}
+
+			return true;
+		}
+
 		virtual void CopyValueFrom(CustomStateVariableHandler* other)
 		{
-			// NOTE/TODO: Not space efficient, but works for now.
+			// Values are only copied between variables with the
+			// same name in components of the same class, i.e.
+			// from the "data" variable of another RAMComponent.
+			RAMDataHandler* otherRAM =
+			    static_cast<RAMDataHandler*>(other);
 
-			stringstream ss;
-			other->Serialize(ss);
-			Deserialize(ss.str());
+			m_ram.ShareBlocksFrom(otherRAM->m_ram);
 		}
 
 	private:
@@ -274,6 +377,15 @@ private:
 			}
 		}
 
+		void SerializeRun(BinarySerializer& serializer,
+			uint64_t blockAddr, const uint8_t* block,
+			size_t runStart, size_t runLength) const
+		{
+			serializer.WriteUInt64(blockAddr + runStart);
+			serializer.WriteUInt64(runLength);
+			serializer.WriteMemory(block + runStart, runLength);
+		}
+
 		// NOTE/TODO: Not space efficient, but works for now.
 		void SerializeRow(ostream& ss, uint64_t addr, uint8_t* data, size_t rowSize) const
 		{
@@ -298,7 +410,7 @@ private:
 	RAMDataHandler m_dataHandler;
 	
 	// State:
-	typedef vector<void *> BlockNrToMemoryBlockVector;
+	typedef vector< refcount_ptr<MemoryBlock> > BlockNrToMemoryBlockVector;
 	BlockNrToMemoryBlockVector	m_memoryBlocks;
 	bool				m_writeProtected;
 	uint64_t			m_lastDumpAddr;
@@ -306,6 +418,7 @@ private:
 	// Cached/runtime state:
 	uint64_t	m_addressSelect;  // For AddressDataBus read/write
 	void *		m_selectedHostMemoryBlock;
+	bool		m_selectedHostMemoryBlockIsShared;
 	size_t		m_selectedOffsetWithinBlock;
 };
 
@@ -49,6 +49,11 @@ class GXemul;
  *
  * <ul>
  *	<li>accuracy ("cycle" or "sloppy")
+ *	<li>syncQuantum (with sloppy accuracy, the number of steps that
+ *		components execute at a time, without being interleaved)
+ *	<li>snapshotInterval (the number of steps between snapshots, when
+ *		snapshotting is enabled; 0 means only one snapshot at step 0)
+ *	<li>maxSnapshots (the largest number of snapshots to keep around)
  * </ul>
  *
  * NOTE: A RootComponent is not registered in the component registry, and
@@ -92,6 +97,9 @@ private:
 
 	// Model:
 	string		m_accuracy;
+	uint64_t	m_syncQuantum;
+	uint64_t	m_snapshotInterval;
+	uint64_t	m_maxSnapshots;
 };
 
 
@@ -68,6 +68,9 @@
  *  length; to extend the list, the list should be made to point to another
  *  list, and so forth. (Bad, O(n) find/insert complexity. Should be fixed some
  *  day. TODO)  See definition of physpage_ranges below.
+ *
+ *  flags holds TC_PHYSPAGE_* bits, used when reclaiming cold pages from a
+ *  full translation cache. (See cpu_dyntrans.cc.)
  */
 #define DYNTRANS_MISC_DECLARATIONS(arch,ARCH,addrtype)  struct \
 	arch ## _instr_call {					\
@@ -81,6 +84,7 @@
 		uint32_t	next_ofs;	/*  (0 for end of chain)  */ \
 		uint32_t	translations_bitmap;			\
 		uint32_t	translation_ranges_ofs;			\
+		uint32_t	flags;					\
 		addrtype	physaddr;				\
 	};								\
 									\
@@ -109,6 +113,10 @@
 	};
 
 
+#define	TC_PHYSPAGE_REFERENCED		1
+#define	TC_PHYSPAGE_FREE		2
+
+
 /*
  *  This structure contains a list of ranges within an emulated
  *  physical page that contain translatable code.
@@ -152,11 +160,13 @@ struct physpage_ranges {
  *  ------------------------------------------------------------
  *
  *  Regardless of whether 32-bit or 64-bit address translation is used, the
- *  same TLB entry structure is used.
+ *  same TLB entry structure is used. vph_tlb_replace_idx selects the entry
+ *  to replace on the next miss.
  */
 #define	VPH_TLBS(arch,ARCH)						\
 	struct arch ## _vpg_tlb_entry					\
-	    vph_tlb_entry[ARCH ## _MAX_VPH_TLB_ENTRIES];
+	    vph_tlb_entry[ARCH ## _MAX_VPH_TLB_ENTRIES];		\
+	unsigned int		vph_tlb_replace_idx;
 
 /*
  *  32-bit dyntrans emulated Virtual -> physical -> host address translation:
@@ -312,13 +322,65 @@ struct cpu_family {
 
 #define	MAX_DYNTRANS_READAHEAD		128
 
+/*  Limits for fast-forwarding idle cpus, see cpu_idle():  */
+#define	CPU_IDLE_MAX_CYCLES		(1 << 26)
+#define	CPU_IDLE_MIN_SLEEP_USEC		1000
+#define	CPU_IDLE_MAX_SLEEP_USEC		10000
+
 #define	DEFAULT_DYNTRANS_CACHE_SIZE	(96*1048576)
 #define	DYNTRANS_CACHE_MARGIN		200000
 
+/*  When the cache is full, 1/n of the pages are reclaimed at a time:  */
+#define	DYNTRANS_RECLAIM_FRACTION	16
+
 #define	N_BASE_TABLE_ENTRIES		65536
 #define	PAGENR_TO_TABLE_INDEX(a)	((a) & (N_BASE_TABLE_ENTRIES-1))
 
 
+/*
+ *  Translation cache statistics, per CPU. (Shown by the "dyntrans" debugger
+ *  command.)
+ */
+struct dyntrans_statistics {
+	int64_t		pages_allocated;
+	int64_t		pages_evicted;
+	int64_t		reclaim_runs;
+	int64_t		full_resets;
+	int64_t		instrs_translated;
+	int64_t		chain_hits;
+	int64_t		chain_misses;
+	int64_t		invalidations;
+	int64_t		translations_invalidated;
+	int64_t		code_invalidations;
+	int64_t		code_subpage_invalidations;
+	int64_t		native_blocks;
+};
+
+
+/*
+ *  Block chaining:
+ *
+ *  Branches which leave the current page look up the translation page of
+ *  their target in a small per-CPU table, indexed by the address of the
+ *  branch instruction call itself. An entry is only valid as long as
+ *  chain_generation has not changed; it is increased whenever a virtual to
+ *  translation page mapping may have changed. (See chained_pc_to_pointers
+ *  in quick_pc_to_pointers.h.)
+ */
+#define	N_DYNTRANS_CHAIN_ENTRIES	1024
+#define	DYNTRANS_CHAIN_INDEX(ic, ic_size)	\
+	(((size_t)(ic) / (ic_size)) & (N_DYNTRANS_CHAIN_ENTRIES - 1))
+
+struct dyntrans_chain_entry {
+	void		*ic;		/*  the branch instruction call  */
+	uint64_t	vaddr_page;	/*  the target virtual page  */
+	void		*ic_page;	/*  the target translation page  */
+	uint64_t	generation;
+};
+
+#define	DYNTRANS_CHAIN_INVALIDATE(cpu)	((cpu)->translation_chain_generation ++)
+
+
 /*
  *  The generic CPU struct:
  */
@@ -343,6 +405,10 @@ struct cpu {
 	int64_t		ninstrs_since_gettimeofday;
 	struct timeval	starttime;
 
+	/*  Values at the previous cpu_show_cycles() call:  */
+	int64_t		show_cycles_ninstrs_last;
+	int64_t		show_cycles_mseconds_last;
+
 	/*  EMUL_LITTLE_ENDIAN or EMUL_BIG_ENDIAN.  */
 	uint8_t		byte_order;
 
@@ -376,7 +442,9 @@ struct cpu {
 			    int writeflag, uint64_t paddr_page);
 	void		(*invalidate_translation_caches)(struct cpu *,
 			    uint64_t paddr, int flags);
-	void		(*invalidate_code_translation)(struct cpu *,
+	void		(*invalidate_translation_range)(struct cpu *,
+			    uint64_t vaddr, uint64_t len);
+	int		(*invalidate_code_translation)(struct cpu *,
 			    uint64_t paddr, int flags);
 	void		(*useremul_syscall)(struct cpu *cpu, uint32_t code);
 	int		(*instruction_has_delayslot)(struct cpu *cpu,
@@ -396,9 +464,15 @@ struct cpu {
 	 *  If has_been_idling is true when printing the number of executed
 	 *  instructions per second, "idling" is printed instead. (The number
 	 *  of instrs per second when idling is meaningless anyway.)
+	 *
+	 *  is_idle is set by cpu_idle(), and makes the dyntrans core skip
+	 *  ahead to the machine's next scheduled event. The host then sleeps
+	 *  for the skipped time, once idle_sleep_usec has added up.
 	 */
 	char		is_halted;
 	char		has_been_idling;
+	char		is_idle;
+	int		idle_sleep_usec;
 
 	/*
 	 *  Dynamic translation:
@@ -418,7 +492,13 @@ struct cpu {
 	 *
 	 *  The translation cache is a relative large chunk of memory (say,
 	 *  32 MB) which is used for translations. When it has been used up,
-	 *  everything restarts from scratch.
+	 *  a fraction of the least recently used physpages are reclaimed,
+	 *  using a clock algorithm. The freed physpages are kept in a list
+	 *  (linked via their next_ofs fields).
+	 *
+	 *  translation_chain[] caches the targets of branches between pages.
+	 *  translation_chain_fill is set by chained_pc_to_pointers, to let
+	 *  the pc_to_pointers function fill in a missing entry.
 	 *
 	 *  translation_readahead is non-zero when translating instructions
 	 *  ahead of the current (emulated) instruction pointer.
@@ -429,7 +509,14 @@ struct cpu {
 	/*  Instruction translation cache:  */
 	int		n_translated_instrs;
 	unsigned char	*translation_cache;
+	size_t		translation_cache_size;
 	size_t		translation_cache_cur_ofs;
+	size_t		translation_cache_clock_hand;
+	uint32_t	translation_cache_free_ofs;
+	struct dyntrans_statistics tc_stats;
+	uint64_t	translation_chain_generation;
+	struct dyntrans_chain_entry *translation_chain_fill;
+	struct dyntrans_chain_entry translation_chain[N_DYNTRANS_CHAIN_ENTRIES];
 
 
 	/*
@@ -465,6 +552,9 @@ void cpu_functioncall_trace(struct cpu *cpu, uint64_t f);
 void cpu_functioncall_trace_return(struct cpu *cpu);
 
 void cpu_create_or_reset_tc(struct cpu *cpu);
+void cpu_idle(struct cpu *cpu);
+int64_t cpu_idle_cycles(struct cpu *cpu, int n_instrs);
+void cpu_idle_sleep(struct cpu *cpu, int64_t cycles);
 
 void cpu_run_init(struct machine *machine);
 void cpu_run_deinit(struct machine *machine);
@@ -482,6 +572,7 @@ void cpu_init(void);
 #define	INVALIDATE_PADDR		4
 #define	INVALIDATE_VADDR		8
 #define	INVALIDATE_VADDR_UPPER4		16	/*  useful for PPC emulation  */
+#define	INVALIDATE_PADDR_SUBPAGE	32	/*  see invalidate_code_transl.  */
 
 
 /*  Note: 64-bit processors running in 32-bit mode use a 32-bit
@@ -185,7 +185,9 @@ struct alpha_cpu {
 void alpha_update_translation_table(struct cpu *cpu, uint64_t vaddr_page,
 	unsigned char *host_page, int writeflag, uint64_t paddr_page);
 void alpha_invalidate_translation_caches(struct cpu *cpu, uint64_t, int);
-void alpha_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
+void alpha_invalidate_translation_range(struct cpu *cpu, uint64_t,
+	uint64_t);
+int alpha_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
 void alpha_init_64bit_dummy_tables(struct cpu *cpu);
 int alpha_run_instr(struct cpu *cpu);
 int alpha_memory_rw(struct cpu *cpu, struct memory *mem, uint64_t vaddr,
@@ -306,7 +306,9 @@ int arm_run_instr(struct cpu *cpu);
 void arm_update_translation_table(struct cpu *cpu, uint64_t vaddr_page,
 	unsigned char *host_page, int writeflag, uint64_t paddr_page);
 void arm_invalidate_translation_caches(struct cpu *cpu, uint64_t, int);
-void arm_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
+void arm_invalidate_translation_range(struct cpu *cpu, uint64_t,
+	uint64_t);
+int arm_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
 void arm_load_register_bank(struct cpu *cpu);
 void arm_save_register_bank(struct cpu *cpu);
 int arm_memory_rw(struct cpu *cpu, struct memory *mem, uint64_t vaddr,
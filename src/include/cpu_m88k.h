@@ -277,7 +277,9 @@ int m88k_run_instr(struct cpu *cpu);
 void m88k_update_translation_table(struct cpu *cpu, uint64_t vaddr_page,
 	unsigned char *host_page, int writeflag, uint64_t paddr_page);
 void m88k_invalidate_translation_caches(struct cpu *cpu, uint64_t, int);
-void m88k_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
+void m88k_invalidate_translation_range(struct cpu *cpu, uint64_t,
+	uint64_t);
+int m88k_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
 int m88k_memory_rw(struct cpu *cpu, struct memory *mem, uint64_t vaddr,
 	unsigned char *data, size_t len, int writeflag, int cache_flags);
 int m88k_cpu_family_init(struct cpu_family *);
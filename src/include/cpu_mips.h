@@ -97,6 +97,24 @@ struct mips_tlb {
 
 #define	N_VADDR_TO_TLB_INDEX_ENTRIES	(1 << 20)
 
+/*
+ *  TLB lookup index:
+ *
+ *  Each TLB entry is chained into a hash bucket, chosen from the low bits
+ *  of its VPN2 at the entry's own page size. The ASID is not part of the
+ *  key, so that global entries are found too. tlb_pageshifts has one bit set
+ *  for each page size in use, so a lookup only probes those page sizes.
+ */
+#define	MIPS_TLB_HASH_SIZE		256
+#define	MIPS_TLB_HASH(addr, pageshift)	((((uint32_t)(addr) >>		\
+	((pageshift) + 1)) ^ (pageshift)) & (MIPS_TLB_HASH_SIZE - 1))
+
+struct mips_tlb_hash {
+	int16_t		next;		/*  Next entry in bucket, or -1  */
+	int16_t		bucket;		/*  -1 if not in the index  */
+	int16_t		pageshift;
+};
+
 struct mips_coproc {
 	int		coproc_nr;
 	uint64_t	reg[N_MIPS_COPROC_REGS];
@@ -105,6 +123,12 @@ struct mips_coproc {
 	struct mips_tlb	*tlbs;
 	int		nr_of_tlbs;
 
+	/*  Only for COP0: TLB lookup index, see tlb_hash_update():  */
+	int16_t		tlb_hash_head[MIPS_TLB_HASH_SIZE];
+	struct mips_tlb_hash *tlb_hash;
+	uint32_t	tlb_pageshifts;
+	int		tlb_pageshift_count[32];
+
 	/*  Only for COP1:  floating point control registers  */
 	/*  (Maybe also for COP0?)  */
 	uint64_t	fcr[N_MIPS_FCRS];
@@ -201,6 +225,25 @@ struct r3000_cache_line {
 DYNTRANS_MISC_DECLARATIONS(mips,MIPS,uint64_t)
 DYNTRANS_MISC64_DECLARATIONS(mips,MIPS,uint8_t)
 
+/*
+ *  ASID shadows:
+ *
+ *  When the ASID in EntryHi changes, the virtual->host translations of the
+ *  old ASID are moved out of the translation tables, into a shadow for that
+ *  ASID. When switching back to an ASID which has a shadow, its translations
+ *  are put back, instead of having to be looked up again one at a time.
+ *  The least recently used shadow is reused when all are taken.
+ */
+#define	MIPS_N_ASID_SHADOWS		8
+#define	MIPS_ASID_SHADOW_ENTRIES	64
+
+struct mips_asid_shadow {
+	unsigned int	asid;
+	int		n_entries;	/*  0 = unused  */
+	uint64_t	last_used;
+	struct mips_vpg_tlb_entry entry[MIPS_ASID_SHADOW_ENTRIES];
+};
+
 
 struct mips_cpu {
 	struct mips_cpu_type_def cpu_type;
@@ -219,7 +262,9 @@ struct mips_cpu {
 	struct mips_coproc *coproc[N_MIPS_COPROCS];
 	uint64_t	cop0_config_select1;
 
-	int		last_written_tlb_index;
+	/*  Saved translations of other ASIDs than the current one:  */
+	struct mips_asid_shadow asid_shadow[MIPS_N_ASID_SHADOWS];
+	uint64_t	asid_shadow_clock;
 
 	/*  Count/compare timer:  */
 	int		compare_register_set;
@@ -272,6 +317,15 @@ struct mips_cpu {
 	int		cache_mask[2];
 
 
+	/*
+	 *  Native code for runs of simple instructions (-G):
+	 */
+	unsigned char	*native_code;
+	size_t		native_code_size;
+	size_t		native_code_used;
+	int		native_code_full;
+
+
 	/*
 	 *  Instruction translation cache and Virtual->Physical->Host
 	 *  address translation:
@@ -314,6 +368,8 @@ void coproc_register_write(struct cpu *cpu,
         struct mips_coproc *cp, int reg_nr, uint64_t *ptr, int flag64,
 	int select);
 void coproc_tlbpr(struct cpu *cpu, int readflag);
+void mips_asid_shadow_invalidate(struct cpu *cpu, uint64_t paddr_page,
+	int flags);
 void coproc_tlbwri(struct cpu *cpu, int randomflag);
 void coproc_rfe(struct cpu *cpu);
 void coproc_eret(struct cpu *cpu);
@@ -345,15 +401,21 @@ void mips_unaligned_loadstore(struct cpu *cpu, struct mips_instr_call *ic,
 
 
 int mips_run_instr(struct cpu *cpu);
+void mips_native_code_init(struct cpu *cpu);
+void mips_native_code_reset(struct cpu *cpu);
 void mips_update_translation_table(struct cpu *cpu, uint64_t vaddr_page,
 	unsigned char *host_page, int writeflag, uint64_t paddr_page);
 void mips_invalidate_translation_caches(struct cpu *cpu, uint64_t, int);
-void mips_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
+void mips_invalidate_translation_range(struct cpu *cpu, uint64_t,
+	uint64_t);
+int mips_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
 int mips32_run_instr(struct cpu *cpu);
 void mips32_update_translation_table(struct cpu *cpu, uint64_t vaddr_page,
 	unsigned char *host_page, int writeflag, uint64_t paddr_page);
 void mips32_invalidate_translation_caches(struct cpu *cpu, uint64_t, int);
-void mips32_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
+void mips32_invalidate_translation_range(struct cpu *cpu, uint64_t,
+	uint64_t);
+int mips32_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
 
 
 #endif	/*  CPU_MIPS_H  */
@@ -154,6 +154,7 @@ struct ppc_cpu {
 #define	PPC_MSR_HV	(1ULL << 60)	/*  Hypervisor  */
 /*  bits 59..17  are reserved  */
 #define	PPC_MSR_VEC	(1 << 25)	/*  Altivec Enable  */
+#define	PPC_MSR_POW	(1 << 18)	/*  Power Management Enable  */
 #define	PPC_MSR_TGPR	(1 << 17)	/*  Temporary gpr0..3  */
 #define	PPC_MSR_ILE	(1 << 16)	/*  Interrupt Little-Endian Mode  */
 #define	PPC_MSR_EE	(1 << 15)	/*  External Interrupt Enable  */
@@ -208,9 +209,13 @@ void ppc_update_translation_table(struct cpu *cpu, uint64_t vaddr_page,
 void ppc32_update_translation_table(struct cpu *cpu, uint64_t vaddr_page,
 	unsigned char *host_page, int writeflag, uint64_t paddr_page);
 void ppc_invalidate_translation_caches(struct cpu *cpu, uint64_t, int);
+void ppc_invalidate_translation_range(struct cpu *cpu, uint64_t,
+	uint64_t);
 void ppc32_invalidate_translation_caches(struct cpu *cpu, uint64_t, int);
-void ppc_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
-void ppc32_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
+void ppc32_invalidate_translation_range(struct cpu *cpu, uint64_t,
+	uint64_t);
+int ppc_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
+int ppc32_invalidate_code_translation(struct cpu *cpu, uint64_t, int);
 void ppc_init_64bit_dummy_tables(struct cpu *cpu);
 int ppc_memory_rw(struct cpu *cpu, struct memory *mem, uint64_t vaddr,
 	unsigned char *data, size_t len, int writeflag, int cache_flags);
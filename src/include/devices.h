@@ -196,6 +196,7 @@ void dev_decxmi_init(struct memory *mem, uint64_t baseaddr);
 /*  Extra flags:  */
 #define	VFB_REVERSE_START	0x10000
 struct vfb_data {
+	struct machine	*machine;
 	struct memory	*memory;
 	int		vfb_type;
 
@@ -227,6 +228,8 @@ struct vfb_data {
 
 	void (*redraw_func)(struct vfb_data *, int, int);
 
+	int		tick_id;
+
 	/*  These should always be in sync:  */
 	unsigned char	*framebuffer;
 	struct fb_window *fb_window;
@@ -237,6 +240,7 @@ struct vfb_data {
 #define	VFB_CFB_BT459			0x200000
 void set_grayscale_palette(struct vfb_data *d, int ncolors);
 void dev_fb_resize(struct vfb_data *d, int new_xsize, int new_ysize);
+void dev_fb_wakeup(struct vfb_data *d);
 void dev_fb_setcursor(struct vfb_data *d, int cursor_x, int cursor_y, int on, 
         int cursor_xsize, int cursor_ysize);
 void framebuffer_blockcopyfill(struct vfb_data *d, int fillflag, int fill_r,
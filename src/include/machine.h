@@ -41,6 +41,7 @@ struct machine_pmax;
 struct memory;
 struct of_data;
 struct settings;
+struct timer_queue;
 
 
 /*  TODO: This should probably go away...  */
@@ -71,10 +72,18 @@ struct tick_functions {
 	int	n_entries;
 
 	/*  Arrays, with one element for each entry:  */
-	int	*ticks_till_next;
+	int64_t	*next_tick_at;		/*  in cycles, see below  */
 	int	*ticks_reset_value;
 	void	(**f)(struct cpu *, void *);
 	void	**extra;
+	int	*heap_index;		/*  -1 while the entry is asleep  */
+
+	/*  Min-heap of entry numbers, ordered by next_tick_at:  */
+	int	*heap;
+	int	n_in_heap;
+
+	/*  Nr of cycles (cpu0 instructions) run so far:  */
+	int64_t	cycle;
 };
 
 struct x11_md {
@@ -130,6 +139,9 @@ struct machine {
 	/*  Tick functions (e.g. hardware devices):  */
 	struct tick_functions tick_functions;
 
+	/*  Timers (emulated clocks), see timer.cc:  */
+	struct timer_queue *timer_queue;
+
 	char	*cpu_name;  /*  TODO: remove this, there could be several
 				cpus with different names in a machine  */
 	int	byte_order_override;
@@ -164,6 +176,9 @@ struct machine {
 	int	show_trace_tree;
 	int	emulated_hz;
 	int	allow_instruction_combinations;
+	int	native_code_translation;
+	int	contiguous_ram;
+	char	*ram_image_filename;
 	int	force_netboot;
 	int	slow_serial_interrupts_hack_for_linux;
 	uint64_t file_loaded_end_addr;
@@ -172,6 +187,9 @@ struct machine {
 	int	exit_without_entering_debugger;
 	int	n_gfx_cards;
 
+	/*  PlayStation 2 SIFBIOS: next free IOP heap address:  */
+	uint32_t ps2_iop_heap_addr;
+
 	/*  Instruction statistics:  */
 	struct statistics statistics;
 
@@ -384,8 +402,11 @@ void machine_destroy(struct machine *machine);
 int machine_name_to_type(char *stype, char *ssubtype,
 	int *type, int *subtype, int *arch);
 void machine_add_breakpoint_string(struct machine *machine, char *str);
-void machine_add_tickfunction(struct machine *machine,
+int machine_add_tickfunction(struct machine *machine,
 	void (*func)(struct cpu *, void *), void *extra, int clockshift);
+void machine_tickfunction_sleep(struct machine *machine, int te);
+void machine_tickfunction_wakeup(struct machine *machine, int te);
+int64_t machine_cycles_until_next_event(struct machine *machine);
 void machine_statistics_init(struct machine *, char *fname);
 void machine_register(char *name, MACHINE_SETUP_TYPE(setup));
 void machine_setup(struct machine *);
@@ -36,6 +36,10 @@
 
 struct machine_pmax {
 	struct dec_memmap	*memmap;
+
+	/*  The file opened via the PROM's open() call:  */
+	int			prom_file_opened;
+	int			prom_file_offset;
 };
 
 
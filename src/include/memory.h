@@ -59,10 +59,23 @@ struct memory_device {
 
 	unsigned char	*dyntrans_data;
 
-	uint64_t	dyntrans_write_low;
-	uint64_t	dyntrans_write_high;
+	/*
+	 *  For DM_DYNTRANS_WRITE_OK devices: one bit per page (of size
+	 *  1 << DYNTRANS_DIRTY_PAGE_SHIFT) which has been made writable
+	 *  for dyntrans since the device last asked for dirty pages.
+	 */
+	uint64_t	*dyntrans_dirty;
+	int		dyntrans_dirty_any;
+
+	/*  Called (with extra) when pages are marked as dirty, e.g. to wake
+	    up the device's tick function. May be NULL.  */
+	void		(*dirty_wakeup)(void *extra);
+
+	int		index_slot;	/*  See device_index in struct memory  */
 };
 
+#define	DYNTRANS_DIRTY_PAGE_SHIFT	12
+
 
 /*
  *  Memory
@@ -79,19 +92,60 @@ struct memory {
 	int		dev_dyntrans_alignment;
 
 	int		n_mmapped_devices;
-	int		last_accessed_device;
 	/*  The following two might speed up things a little bit.  */
 	/*  (actually maxaddr is the addr after the last address)  */
 	uint64_t	mmap_dev_minaddr;
 	uint64_t	mmap_dev_maxaddr;
 
 	struct memory_device *devices;
+
+	/*
+	 *  Page-granular device index: for each physical page (below
+	 *  1 << DEVICE_INDEX_MAX_BITS), the slot of the lowest numbered
+	 *  device which overlaps that page, plus one. 0 means no device. The
+	 *  leaves are allocated on demand.
+	 *
+	 *  A device keeps its slot for as long as it is registered, so that
+	 *  only the pages of the added or removed device need to be updated
+	 *  when the device numbers shift. device_slot_to_index maps slots to
+	 *  device numbers (-1 for free slots).
+	 */
+	int32_t		**device_index;
+	int		n_device_slots;
+	int		*device_slot_to_index;
+
+	/*  Physical RAM 0 .. contiguous_ram_len-1, if allocated in one go:  */
+	unsigned char	*contiguous_ram;
+	uint64_t	contiguous_ram_len;
+
+	/*  Physical RAM 0 .. ram_image_len-1, if mapped from an image file:  */
+	unsigned char	*ram_image;
+	uint64_t	ram_image_len;
+
+	/*  Zero page scanner, see memory_zero_scan():  */
+	uint64_t	zero_scan_pos;
+	int64_t		zero_pages_released;
+
+	/*  Indices of devices with DM_DYNTRANS_WRITE_OK set:  */
+	int		n_dyntrans_write_devices;
+	int		*dyntrans_write_devices;
 };
 
 #define	BITS_PER_PAGETABLE	20
 #define	BITS_PER_MEMBLOCK	20
 #define	MAX_BITS		40
 
+#define	MEMORY_HUGE_PAGE_SIZE	(2 * 1048576)
+
+/*  Nr of host pages looked at per memory_zero_scan() call from idle cpus:  */
+#define	MEMORY_ZERO_SCAN_PAGES	256
+
+#define	DEVICE_INDEX_PAGE_BITS	12
+#define	DEVICE_INDEX_LEAF_BITS	8
+#define	DEVICE_INDEX_TOP_BITS	20
+#define	DEVICE_INDEX_MAX_BITS	(DEVICE_INDEX_PAGE_BITS + \
+				DEVICE_INDEX_LEAF_BITS + DEVICE_INDEX_TOP_BITS)
+
 
 /*  memory.c:  */
 #define	MEM_PCI_LITTLE_ENDIAN	128
@@ -102,6 +156,12 @@ void memory_writemax64(struct cpu *cpu, unsigned char *buf, int len,
 void *zeroed_alloc(size_t s);
 
 struct memory *memory_new(uint64_t physical_max, int arch);
+int memory_reserve_contiguous(struct memory *mem, uint64_t len);
+int memory_map_image(struct memory *mem, const char *filename);
+int memory_save_image(struct memory *mem, const char *filename);
+void memory_zero_scan(struct memory *mem, int n_pages);
+void memory_footprint(struct memory *mem, uint64_t *touchedp,
+	uint64_t *residentp);
 
 int memory_points_to_string(struct cpu *cpu, struct memory *mem,
 	uint64_t addr, int min_string_length);
@@ -142,8 +202,12 @@ unsigned char *memory_paddr_to_hostaddr(struct memory *mem,
 #define	MEMORY_ACCESS_OK_WRITE		2
 #define	MEMORY_NOT_FULL_PAGE		256
 
-void memory_device_dyntrans_access(struct cpu *, struct memory *mem,
+void memory_device_set_dirty(struct memory_device *dev, uint64_t low,
+	uint64_t high);
+int memory_device_dyntrans_dirty(struct cpu *, struct memory *mem,
 	void *extra, uint64_t *low, uint64_t *high);
+void memory_device_set_dirty_wakeup(struct memory *mem, void *extra,
+	void (*f)(void *));
 
 #define DEVICE_ACCESS(x)	int dev_ ## x ## _access(struct cpu *cpu, \
 	struct memory *mem, uint64_t relative_addr, unsigned char *data,  \
@@ -157,6 +221,7 @@ void memory_device_register(struct memory *mem, const char *,
 	    struct memory *,uint64_t,unsigned char *,size_t,int,void *),
 	void *extra, int flags, unsigned char *dyntrans_data);
 void memory_device_remove(struct memory *mem, int i);
+int memory_device_find(struct memory *mem, uint64_t paddr);
 
 uint64_t memory_checksum(struct memory *mem);
 
@@ -35,6 +35,12 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 
+#include "../../config.h"
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 struct emul;
 struct ethernet_packet_link;
 struct remote_net;
@@ -149,8 +155,21 @@ struct net {
 	int		local_port;
 	int		local_port_socket;
 	struct remote_net *remote_nets;
+
+#ifdef HAVE_PTHREADS
+	/*  Machines may run in separate host threads; see emul_run().  */
+	pthread_mutex_t	mutex;
+#endif
 };
 
+#ifdef HAVE_PTHREADS
+#define	NET_LOCK(net)		pthread_mutex_lock(&(net)->mutex)
+#define	NET_UNLOCK(net)		pthread_mutex_unlock(&(net)->mutex)
+#else
+#define	NET_LOCK(net)
+#define	NET_UNLOCK(net)
+#endif
+
 /*  net_misc.c:  */
 void net_debugaddr(void *addr, int type);
 void net_generate_unique_mac(struct machine *, unsigned char *macbuf);
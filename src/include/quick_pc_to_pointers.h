@@ -1,6 +1,9 @@
 #ifdef quick_pc_to_pointers
 #undef quick_pc_to_pointers
 #endif
+#ifdef chained_pc_to_pointers
+#undef chained_pc_to_pointers
+#endif
 
 #ifdef MODE32
 #define	quick_pc_to_pointers(cpu) {					\
@@ -25,8 +28,38 @@
 }
 #endif
 
+#define	chained_pc_to_pointers(cpu, ic)	quick_pc_to_pointers(cpu)
+
 #else
 #define quick_pc_to_pointers(cpu)	DYNTRANS_PC_TO_POINTERS(cpu)
+
+/*
+ *  chained_pc_to_pointers() is used by branches which leave the current
+ *  page. The target translation page is looked up in cpu->translation_chain[],
+ *  using the branch's instruction call as the key. On a miss, the normal
+ *  pc_to_pointers function is called, and it fills in the entry.
+ */
+#define	chained_pc_to_pointers(cpu, ic) {				\
+	struct dyntrans_chain_entry *ce_tmp = &cpu->translation_chain[	\
+	    DYNTRANS_CHAIN_INDEX(ic, sizeof(struct DYNTRANS_IC))];	\
+	uint64_t pc_tmp64 = cpu->pc;					\
+	if (ce_tmp->ic == (void *) (ic) && ce_tmp->vaddr_page ==	\
+	    (pc_tmp64 & ~(uint64_t)(DYNTRANS_PAGESIZE - 1)) &&		\
+	    ce_tmp->generation == cpu->translation_chain_generation) {	\
+		cpu->tc_stats.chain_hits ++;				\
+		cpu->cd.DYNTRANS_ARCH.cur_ic_page =			\
+		    (struct DYNTRANS_IC *) ce_tmp->ic_page;		\
+		cpu->cd.DYNTRANS_ARCH.next_ic =				\
+		    cpu->cd.DYNTRANS_ARCH.cur_ic_page +			\
+		    DYNTRANS_PC_TO_IC_ENTRY(pc_tmp64);			\
+	} else {							\
+		cpu->tc_stats.chain_misses ++;				\
+		ce_tmp->ic = (void *) (ic);				\
+		cpu->translation_chain_fill = ce_tmp;			\
+		DYNTRANS_PC_TO_POINTERS(cpu);				\
+		cpu->translation_chain_fill = NULL;			\
+	}								\
+}
 #endif
 
 
@@ -81,6 +81,19 @@ public:
 		}
 	}
 
+	/**
+	 * \brief Gets the current reference count of the object.
+	 *
+	 * Useful e.g. for copy-on-write schemes, where an object which is
+	 * referenced by more than one refcount_ptr must not be modified.
+	 *
+	 * @return The number of references to the object.
+	 */
+	int GetRefCount() const
+	{
+		return m_refCount;
+	}
+
 private:
 	template<class T> friend class refcount_ptr;
 
@@ -28,20 +28,31 @@
  *  SUCH DAMAGE.
  */
 
+#include <sys/types.h>
+
+struct machine;
 struct timer;
+struct timer_queue;
+
+/*  Instructions per emulated second, for machines without emulated_hz:  */
+#define	TIMER_DEFAULT_EMULATED_HZ	100000000.0
 
-#define	TIMER_BASE_FREQUENCY	65.0	/*  Hz  */
+struct timer_queue *timer_queue_new(void);
+void timer_queue_destroy(struct timer_queue *q);
 
-struct timer *timer_add(double freq, void (*timer_tick)(struct timer *timer,
-	void *extra), void *extra);
+struct timer *timer_add(struct machine *machine, double freq,
+	void (*timer_tick)(struct timer *timer, void *extra), void *extra);
 void timer_remove(struct timer *t);
 
 void timer_update_frequency(struct timer *t, double new_freq);
 
+void timer_run(struct machine *machine, int ninstrs);
+int64_t timer_cycles_until_next(struct machine *machine);
+
 void timer_start(void);
 void timer_stop(void);
 
-void timer_init(void);
+void timer_init(int sync_to_host_clock);
 
 
 #endif	/*  TIMER_H  */
@@ -44,6 +44,7 @@
 #include "misc.h"
 #include "settings.h"
 #include "symbol.h"
+#include "timer.h"
 
 
 /*  This is initialized by machine_init():  */
@@ -87,6 +88,7 @@ struct machine *machine_new(char *name, struct emul *emul, int id)
 	m->x11_md.scaleup = 1;
 	m->n_gfx_cards = 1;
 	symbol_init(&m->symbol_context);
+	m->timer_queue = timer_queue_new();
 
 	/*  Settings:  */
 	m->settings = settings_new();
@@ -105,6 +107,9 @@ struct machine *machine_new(char *name, struct emul *emul, int id)
 	settings_add(m->settings, "allow_instruction_combinations", 0,
 	    SETTINGS_TYPE_INT, SETTINGS_FORMAT_YESNO,
 	    (void *) &m->allow_instruction_combinations);
+	settings_add(m->settings, "native_code_translation", 0,
+	    SETTINGS_TYPE_INT, SETTINGS_FORMAT_YESNO,
+	    (void *) &m->native_code_translation);
 	settings_add(m->settings, "n_gfx_cards", 0,
 	    SETTINGS_TYPE_INT, SETTINGS_FORMAT_DECIMAL,
 	    (void *) &m->n_gfx_cards);
@@ -136,6 +141,8 @@ void machine_destroy(struct machine *machine)
 	if (machine->path != NULL)
 		free(machine->path);
 
+	timer_queue_destroy(machine->timer_queue);
+
 	/*  Remove any remaining level-1 settings:  */
 	settings_remove_all(machine->settings);
 	settings_destroy(machine->settings);
@@ -265,6 +272,53 @@ void machine_add_breakpoint_string(struct machine *machine, char *str)
 }
 
 
+/*
+ *  tickfunction_heap_swap(), tickfunction_heap_up(), tickfunction_heap_down():
+ *
+ *  Helper functions for keeping the heap of tick functions ordered.
+ */
+static void tickfunction_heap_swap(struct tick_functions *tf, int a, int b)
+{
+	int tmp = tf->heap[a];
+
+	tf->heap[a] = tf->heap[b];
+	tf->heap[b] = tmp;
+	tf->heap_index[tf->heap[a]] = a;
+	tf->heap_index[tf->heap[b]] = b;
+}
+
+static void tickfunction_heap_up(struct tick_functions *tf, int i)
+{
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (tf->next_tick_at[tf->heap[parent]] <=
+		    tf->next_tick_at[tf->heap[i]])
+			break;
+		tickfunction_heap_swap(tf, i, parent);
+		i = parent;
+	}
+}
+
+static void tickfunction_heap_down(struct tick_functions *tf, int i)
+{
+	for (;;) {
+		int smallest = i, left = 2*i + 1, right = 2*i + 2;
+
+		if (left < tf->n_in_heap && tf->next_tick_at[tf->heap[left]]
+		    < tf->next_tick_at[tf->heap[smallest]])
+			smallest = left;
+		if (right < tf->n_in_heap && tf->next_tick_at[tf->heap[right]]
+		    < tf->next_tick_at[tf->heap[smallest]])
+			smallest = right;
+		if (smallest == i)
+			break;
+
+		tickfunction_heap_swap(tf, i, smallest);
+		i = smallest;
+	}
+}
+
+
 /*
  *  machine_add_tickfunction():
  *
@@ -276,20 +330,28 @@ void machine_add_breakpoint_string(struct machine *machine, char *str)
  *
  *  If tickshift is zero, then this is a cycle-accurate tick function.
  *  The hz value is used in this case.
+ *
+ *  The return value is the tick function's entry number, which can be used
+ *  with machine_tickfunction_sleep() and machine_tickfunction_wakeup().
  */
-void machine_add_tickfunction(struct machine *machine, void (*func)
+int machine_add_tickfunction(struct machine *machine, void (*func)
 	(struct cpu *, void *), void *extra, int tickshift)
 {
-	int n = machine->tick_functions.n_entries;
-
-	CHECK_ALLOCATION(machine->tick_functions.ticks_till_next = (int *) realloc(
-	    machine->tick_functions.ticks_till_next, (n+1) * sizeof(int)));
-	CHECK_ALLOCATION(machine->tick_functions.ticks_reset_value = (int *) realloc(
-	    machine->tick_functions.ticks_reset_value, (n+1) * sizeof(int)));
-	CHECK_ALLOCATION(machine->tick_functions.f = (void (**)(cpu*,void*)) realloc(
-	    machine->tick_functions.f, (n+1) * sizeof(void *)));
-	CHECK_ALLOCATION(machine->tick_functions.extra = (void **) realloc(
-	    machine->tick_functions.extra, (n+1) * sizeof(void *)));
+	struct tick_functions *tf = &machine->tick_functions;
+	int n = tf->n_entries;
+
+	CHECK_ALLOCATION(tf->next_tick_at = (int64_t *) realloc(
+	    tf->next_tick_at, (n+1) * sizeof(int64_t)));
+	CHECK_ALLOCATION(tf->ticks_reset_value = (int *) realloc(
+	    tf->ticks_reset_value, (n+1) * sizeof(int)));
+	CHECK_ALLOCATION(tf->f = (void (**)(cpu*,void*)) realloc(
+	    tf->f, (n+1) * sizeof(void *)));
+	CHECK_ALLOCATION(tf->extra = (void **) realloc(
+	    tf->extra, (n+1) * sizeof(void *)));
+	CHECK_ALLOCATION(tf->heap_index = (int *) realloc(
+	    tf->heap_index, (n+1) * sizeof(int)));
+	CHECK_ALLOCATION(tf->heap = (int *) realloc(
+	    tf->heap, (n+1) * sizeof(int)));
 
 	/*
 	 *  The dyntrans subsystem wants to run code in relatively
@@ -303,12 +365,88 @@ void machine_add_tickfunction(struct machine *machine, void (*func)
 		exit(1);
 	}
 
-	machine->tick_functions.ticks_till_next[n]   = 0;
-	machine->tick_functions.ticks_reset_value[n] = 1 << tickshift;
-	machine->tick_functions.f[n]                 = func;
-	machine->tick_functions.extra[n]             = extra;
+	tf->next_tick_at[n]      = tf->cycle;
+	tf->ticks_reset_value[n] = 1 << tickshift;
+	tf->f[n]                 = func;
+	tf->extra[n]             = extra;
+
+	tf->n_entries = n + 1;
+
+	tf->heap_index[n] = tf->n_in_heap;
+	tf->heap[tf->n_in_heap ++] = n;
+	tickfunction_heap_up(tf, tf->heap_index[n]);
+
+	return n;
+}
+
+
+/*
+ *  machine_tickfunction_sleep():
+ *
+ *  Stops calling a tick function, e.g. because its device has nothing to do,
+ *  until machine_tickfunction_wakeup() is called. (Usually called from the
+ *  tick function itself.)
+ */
+void machine_tickfunction_sleep(struct machine *machine, int te)
+{
+	struct tick_functions *tf = &machine->tick_functions;
+	int i = tf->heap_index[te];
+
+	if (i < 0)
+		return;
+
+	tf->n_in_heap --;
+	if (i != tf->n_in_heap) {
+		tickfunction_heap_swap(tf, i, tf->n_in_heap);
+		tickfunction_heap_up(tf, i);
+		tickfunction_heap_down(tf, i);
+	}
+
+	tf->heap_index[te] = -1;
+}
+
+
+/*
+ *  machine_tickfunction_wakeup():
+ *
+ *  Resumes calling a tick function which was put to sleep. The tick function
+ *  is called at the end of the current time slice, and then periodically
+ *  again, as before.
+ */
+void machine_tickfunction_wakeup(struct machine *machine, int te)
+{
+	struct tick_functions *tf = &machine->tick_functions;
 
-	machine->tick_functions.n_entries = n + 1;
+	if (tf->heap_index[te] >= 0)
+		return;
+
+	tf->next_tick_at[te] = tf->cycle;
+	tf->heap_index[te] = tf->n_in_heap;
+	tf->heap[tf->n_in_heap ++] = te;
+	tickfunction_heap_up(tf, tf->heap_index[te]);
+}
+
+
+/*
+ *  machine_cycles_until_next_event():
+ *
+ *  Returns the number of cycles (cpu0 instructions) until the next tick
+ *  function or timer of a machine is due, or -1 if nothing is scheduled.
+ */
+int64_t machine_cycles_until_next_event(struct machine *machine)
+{
+	struct tick_functions *tf = &machine->tick_functions;
+	int64_t cycles = timer_cycles_until_next(machine);
+
+	if (tf->n_in_heap > 0) {
+		int64_t t = tf->next_tick_at[tf->heap[0]] - tf->cycle;
+		if (t < 0)
+			t = 0;
+		if (cycles < 0 || t < cycles)
+			cycles = t;
+	}
+
+	return cycles;
 }
 
 
@@ -327,6 +465,7 @@ void machine_statistics_init(struct machine *machine, char *fname)
 	const char *mode = "a";	/*  Append by default  */
 
 	machine->allow_instruction_combinations = 0;
+	machine->native_code_translation = 0;
 
 	if (machine->statistics.fields != NULL) {
 		fprintf(stderr, "Only one -s option is allowed.\n");
@@ -617,7 +756,8 @@ void machine_default_cputype(struct machine *m)
 int machine_run(struct machine *machine)
 {
 	struct cpu **cpus = machine->cpus;
-	int ncpus = machine->ncpus, cpu0instrs = 0, i, te;
+	struct tick_functions *tf = &machine->tick_functions;
+	int ncpus = machine->ncpus, cpu0instrs = 0, i;
 
 	for (i=0; i<ncpus; i++) {
 		if (cpus[i]->running) {
@@ -631,24 +771,28 @@ int machine_run(struct machine *machine)
 	 *  Hardware 'ticks':  (clocks, interrupt sources...)
 	 *
 	 *  Here, cpu0instrs is the number of instructions executed on cpu0.
+	 *  The tick functions are kept in a heap ordered by their next
+	 *  deadline, so only those that are due (and not asleep) are visited.
 	 *
 	 *  TODO: This should be redesigned into some "mainbus" stuff instead!
 	 */
 
-	for (te=0; te<machine->tick_functions.n_entries; te++) {
-		machine->tick_functions.ticks_till_next[te] -= cpu0instrs;
-		if (machine->tick_functions.ticks_till_next[te] <= 0) {
-			while (machine->tick_functions.ticks_till_next[te]<=0) {
-				machine->tick_functions.ticks_till_next[te] +=
-				    machine->tick_functions.
-				    ticks_reset_value[te];
-			}
+	tf->cycle += cpu0instrs;
 
-			machine->tick_functions.f[te](cpus[0],
-			    machine->tick_functions.extra[te]);
-		}
+	while (tf->n_in_heap > 0 &&
+	    tf->next_tick_at[tf->heap[0]] <= tf->cycle) {
+		int te = tf->heap[0];
+
+		while (tf->next_tick_at[te] <= tf->cycle)
+			tf->next_tick_at[te] += tf->ticks_reset_value[te];
+		tickfunction_heap_down(tf, 0);
+
+		tf->f[te](cpus[0], tf->extra[te]);
 	}
 
+	/*  Emulated clocks:  */
+	timer_run(machine, cpu0instrs);
+
 	/*  Is any CPU still alive?  */
 	for (i=0; i<ncpus; i++)
 		if (cpus[i]->running)
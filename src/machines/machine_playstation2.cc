@@ -109,6 +109,8 @@ MACHINE_SETUP(playstation2)
 	if (!machine->prom_emulation)
 		return;
 
+	/*  Start of the IOP heap handed out by the SIFBIOS:  */
+	machine->ps2_iop_heap_addr = 0x1000;	/*  0xbc000000?  */
 
 	tmplen = 1000;
 	CHECK_ALLOCATION(tmp = (char *) malloc(tmplen));
@@ -142,6 +142,58 @@ static void default_test(struct machine *machine, struct cpu *cpu)
 }
 
 
+MACHINE_SETUP(barealpha)
+{
+	machine->machine_name = strdup("Generic \"bare\" Alpha machine");
+}
+
+
+MACHINE_SETUP(testalpha)
+{
+	machine->machine_name = strdup("Alpha test machine");
+
+	/*
+	 *  Note: Before a page table has been set up, low virtual addresses
+	 *  are not all mapped 1:1 to physical addresses (see
+	 *  alpha_translate_v2p()), so programs should reach the devices
+	 *  via the direct-mapped kernel segment, e.g. 0xfffffc0010000000
+	 *  for the console.
+	 */
+	default_test(machine, cpu);
+}
+
+
+MACHINE_DEFAULT_CPU(barealpha)
+{
+	machine->cpu_name = strdup("21264");
+}
+
+
+MACHINE_DEFAULT_CPU(testalpha)
+{
+	machine->cpu_name = strdup("21264");
+}
+
+
+MACHINE_REGISTER(barealpha)
+{
+	MR_DEFAULT(barealpha, "Generic \"bare\" Alpha machine",
+	    ARCH_ALPHA, MACHINE_BAREALPHA);
+
+	machine_entry_add_alias(me, "barealpha");
+}
+
+
+MACHINE_REGISTER(testalpha)
+{
+	MR_DEFAULT(testalpha, "Test-machine for Alpha",
+	    ARCH_ALPHA, MACHINE_TESTALPHA);
+
+	machine_entry_add_alias(me, "testalpha");
+}
+
+
+
 MACHINE_SETUP(barearm)
 {
 	machine->machine_name = strdup("Generic \"bare\" ARM machine");
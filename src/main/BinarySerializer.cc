@@ -0,0 +1,717 @@
+/*
+ *  Copyright (C) 2007-2019  Anders Gavare.  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright  
+ *     notice, this list of conditions and the following disclaimer in the 
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ *  ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE   
+ *  FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ *  DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *  OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *  HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ *  OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *  SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "BinarySerializer.h"
+
+
+// 8 bytes, which also make it easy to recognize a binary file by eye.
+static const char g_magic[] = "GXemulB1";
+static const size_t MAGIC_SIZE = 8;
+
+// How memory written by WriteMemory() is stored:
+#define	MEMORY_STORED		0
+#define	MEMORY_COMPRESSED	1
+
+// Compression parameters. Matches are found using a hash table of 4-byte
+// sequences; offsets are 16 bits, so matches must be near each other.
+#define	MIN_MATCH		4
+#define	MAX_OFFSET		65535
+#define	HASH_BITS		12
+
+
+BinarySerializer::BinarySerializer(bool compress)
+	: m_compress(compress)
+	, m_size(0)
+{
+	WriteOwned(g_magic, MAGIC_SIZE);
+}
+
+
+bool BinarySerializer::HasMagic(const void* data, size_t size)
+{
+	return size >= MAGIC_SIZE && memcmp(data, g_magic, MAGIC_SIZE) == 0;
+}
+
+
+void BinarySerializer::WriteOwned(const void* data, size_t size)
+{
+	size_t offset = m_owned.size();
+	m_owned.resize(offset + size);
+	memcpy(&m_owned[offset], data, size);
+
+	// Consecutive owned data is kept in one piece:
+	if (!m_pieces.empty() && m_pieces.back().m_external == NULL &&
+	    m_pieces.back().m_offset + m_pieces.back().m_size == offset) {
+		m_pieces.back().m_size += size;
+	} else {
+		Piece piece;
+		piece.m_external = NULL;
+		piece.m_offset = offset;
+		piece.m_size = size;
+		m_pieces.push_back(piece);
+	}
+
+	m_size += size;
+}
+
+
+size_t BinarySerializer::BeginChunk(const char* tag)
+{
+	size_t chunk = m_owned.size();
+
+	WriteOwned(tag, 4);
+	WriteUInt64(0);		// filled in by EndChunk
+
+	// The payload starts at m_size, which is remembered in the length
+	// field itself until the chunk ends.
+	uint64_t start = m_size;
+	for (int i=0; i<8; ++i)
+		m_owned[chunk + 4 + i] = start >> (i*8);
+
+	return chunk;
+}
+
+
+void BinarySerializer::EndChunk(size_t chunk)
+{
+	uint64_t start = 0;
+	for (int i=0; i<8; ++i)
+		start |= (uint64_t)m_owned[chunk + 4 + i] << (i*8);
+
+	uint64_t length = m_size - start;
+	for (int i=0; i<8; ++i)
+		m_owned[chunk + 4 + i] = length >> (i*8);
+}
+
+
+void BinarySerializer::WriteUInt8(uint8_t value)
+{
+	WriteOwned(&value, 1);
+}
+
+
+void BinarySerializer::WriteUInt32(uint32_t value)
+{
+	uint8_t buf[4];
+	for (int i=0; i<4; ++i)
+		buf[i] = value >> (i*8);
+
+	WriteOwned(buf, sizeof(buf));
+}
+
+
+void BinarySerializer::WriteUInt64(uint64_t value)
+{
+	uint8_t buf[8];
+	for (int i=0; i<8; ++i)
+		buf[i] = value >> (i*8);
+
+	WriteOwned(buf, sizeof(buf));
+}
+
+
+void BinarySerializer::WriteString(const string& str)
+{
+	WriteUInt32(str.length());
+	WriteOwned(str.data(), str.length());
+}
+
+
+void BinarySerializer::WriteMemory(const void* data, size_t size)
+{
+	WriteUInt64(size);
+
+	if (m_compress && size > 0) {
+		vector<uint8_t> compressed;
+		Compress((const uint8_t*) data, size, compressed);
+
+		if (compressed.size() < size) {
+			WriteUInt8(MEMORY_COMPRESSED);
+			WriteUInt64(compressed.size());
+			WriteOwned(&compressed[0], compressed.size());
+			return;
+		}
+	}
+
+	WriteUInt8(MEMORY_STORED);
+	WriteUInt64(size);
+
+	if (size == 0)
+		return;
+
+	Piece piece;
+	piece.m_external = (const uint8_t*) data;
+	piece.m_offset = 0;
+	piece.m_size = size;
+	m_pieces.push_back(piece);
+
+	m_size += size;
+}
+
+
+uint64_t BinarySerializer::GetSize() const
+{
+	return m_size;
+}
+
+
+bool BinarySerializer::WriteToFile(int fd) const
+{
+#ifdef IOV_MAX
+	const size_t maxIovecs = IOV_MAX;
+#else
+	const size_t maxIovecs = 16;
+#endif
+
+	vector<struct iovec> iovecs(m_pieces.size());
+	for (size_t i=0; i<m_pieces.size(); ++i) {
+		const Piece& piece = m_pieces[i];
+		const uint8_t* p = piece.m_external != NULL?
+		    piece.m_external : &m_owned[piece.m_offset];
+
+		iovecs[i].iov_base = (void*) p;
+		iovecs[i].iov_len = piece.m_size;
+	}
+
+	size_t i = 0;
+	while (i < iovecs.size()) {
+		size_t n = iovecs.size() - i;
+		if (n > maxIovecs)
+			n = maxIovecs;
+
+		ssize_t written = writev(fd, &iovecs[i], n);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		// Skip the iovecs that were written completely, and adjust
+		// the first one which was only partially written (if any).
+		while (i < iovecs.size() && written > 0) {
+			if ((size_t) written >= iovecs[i].iov_len) {
+				written -= iovecs[i].iov_len;
+				++ i;
+			} else {
+				iovecs[i].iov_base =
+				    (uint8_t*) iovecs[i].iov_base + written;
+				iovecs[i].iov_len -= written;
+				written = 0;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+void BinarySerializer::GetBytes(vector<uint8_t>& bytes) const
+{
+	bytes.clear();
+	bytes.reserve(m_size);
+
+	for (size_t i=0; i<m_pieces.size(); ++i) {
+		const Piece& piece = m_pieces[i];
+		const uint8_t* p = piece.m_external != NULL?
+		    piece.m_external : &m_owned[piece.m_offset];
+
+		bytes.insert(bytes.end(), p, p + piece.m_size);
+	}
+}
+
+
+static void AddLength(vector<uint8_t>& dst, size_t length)
+{
+	// Lengths which do not fit in the token's 4 bits continue with
+	// bytes of 255, ending with a byte less than 255.
+	while (length >= 255) {
+		dst.push_back(255);
+		length -= 255;
+	}
+
+	dst.push_back(length);
+}
+
+
+static void AddSequence(vector<uint8_t>& dst, const uint8_t* literals,
+	size_t nLiterals, size_t offset, size_t matchLength)
+{
+	size_t matchNibble = matchLength == 0? 0 : matchLength - MIN_MATCH;
+
+	dst.push_back((nLiterals < 15? nLiterals : 15) << 4 |
+	    (matchNibble < 15? matchNibble : 15));
+
+	if (nLiterals >= 15)
+		AddLength(dst, nLiterals - 15);
+
+	dst.insert(dst.end(), literals, literals + nLiterals);
+
+	if (matchLength == 0)
+		return;
+
+	dst.push_back(offset & 0xff);
+	dst.push_back(offset >> 8);
+
+	if (matchNibble >= 15)
+		AddLength(dst, matchNibble - 15);
+}
+
+
+static uint32_t Read32(const uint8_t* p)
+{
+	uint32_t x;
+	memcpy(&x, p, sizeof(x));
+	return x;
+}
+
+
+void BinarySerializer::Compress(const uint8_t* src, size_t size,
+	vector<uint8_t>& dst)
+{
+	// Positions + 1 of earlier occurrences of each hash, 0 = none.
+	vector<size_t> table(1 << HASH_BITS, 0);
+
+	size_t anchor = 0;	// start of pending literals
+	size_t pos = 0;
+
+	while (pos + MIN_MATCH <= size) {
+		uint32_t sequence = Read32(src + pos);
+		size_t hash = (sequence * 2654435761U) >> (32 - HASH_BITS);
+		size_t candidate = table[hash];
+		table[hash] = pos + 1;
+
+		if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET ||
+		    Read32(src + candidate - 1) != sequence) {
+			++ pos;
+			continue;
+		}
+
+		size_t match = candidate - 1;
+		size_t matchLength = MIN_MATCH;
+		while (pos + matchLength < size &&
+		    src[match + matchLength] == src[pos + matchLength])
+			++ matchLength;
+
+		AddSequence(dst, src + anchor, pos - anchor, pos - match,
+		    matchLength);
+
+		pos += matchLength;
+		anchor = pos;
+	}
+
+	if (anchor < size)
+		AddSequence(dst, src + anchor, size - anchor, 0, 0);
+}
+
+
+static bool GetLength(const uint8_t* src, size_t srcSize, size_t& pos,
+	size_t& length)
+{
+	uint8_t b;
+	do {
+		if (pos >= srcSize)
+			return false;
+
+		b = src[pos++];
+		length += b;
+	} while (b == 255);
+
+	return true;
+}
+
+
+bool BinarySerializer::Decompress(const uint8_t* src, size_t srcSize,
+	uint8_t* dst, size_t dstSize)
+{
+	size_t pos = 0;
+	size_t out = 0;
+
+	while (pos < srcSize) {
+		uint8_t token = src[pos++];
+
+		size_t nLiterals = token >> 4;
+		if (nLiterals == 15 && !GetLength(src, srcSize, pos, nLiterals))
+			return false;
+
+		if (nLiterals > srcSize - pos || nLiterals > dstSize - out)
+			return false;
+
+		memcpy(dst + out, src + pos, nLiterals);
+		pos += nLiterals;
+		out += nLiterals;
+
+		// The last sequence has no match.
+		if (pos == srcSize)
+			break;
+
+		if (srcSize - pos < 2)
+			return false;
+
+		size_t offset = src[pos] | (src[pos+1] << 8);
+		pos += 2;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 &&
+		    !GetLength(src, srcSize, pos, matchLength))
+			return false;
+
+		matchLength += MIN_MATCH;
+
+		if (offset == 0 || offset > out ||
+		    matchLength > dstSize - out)
+			return false;
+
+		// The match may overlap what is being written, so it has
+		// to be copied one byte at a time.
+		const uint8_t* match = dst + out - offset;
+		for (size_t i=0; i<matchLength; ++i)
+			dst[out + i] = match[i];
+
+		out += matchLength;
+	}
+
+	return out == dstSize;
+}
+
+
+/*****************************************************************************/
+
+
+BinaryDeserializer::BinaryDeserializer(const void* data, size_t size)
+	: m_data((const uint8_t*) data)
+	, m_size(size)
+	, m_pos(0)
+{
+}
+
+
+const uint8_t* BinaryDeserializer::Read(size_t size)
+{
+	if (size > m_size - m_pos) {
+		m_pos = m_size;
+		return NULL;
+	}
+
+	const uint8_t* p = m_data + m_pos;
+	m_pos += size;
+	return p;
+}
+
+
+bool BinaryDeserializer::ReadMagic()
+{
+	const uint8_t* p = Read(MAGIC_SIZE);
+	return p != NULL && BinarySerializer::HasMagic(p, MAGIC_SIZE);
+}
+
+
+bool BinaryDeserializer::AtEnd() const
+{
+	return m_pos >= m_size;
+}
+
+
+bool BinaryDeserializer::ReadChunk(string& tag, BinaryDeserializer& payload)
+{
+	const uint8_t* p = Read(4);
+	uint64_t length;
+	if (p == NULL || !ReadUInt64(length))
+		return false;
+
+	const uint8_t* data = Read(length);
+	if (data == NULL)
+		return false;
+
+	tag = string((const char*) p, 4);
+	payload = BinaryDeserializer(data, length);
+	return true;
+}
+
+
+bool BinaryDeserializer::ReadUInt8(uint8_t& value)
+{
+	const uint8_t* p = Read(1);
+	if (p == NULL)
+		return false;
+
+	value = p[0];
+	return true;
+}
+
+
+bool BinaryDeserializer::ReadUInt32(uint32_t& value)
+{
+	const uint8_t* p = Read(4);
+	if (p == NULL)
+		return false;
+
+	value = 0;
+	for (int i=0; i<4; ++i)
+		value |= (uint32_t)p[i] << (i*8);
+
+	return true;
+}
+
+
+bool BinaryDeserializer::ReadUInt64(uint64_t& value)
+{
+	const uint8_t* p = Read(8);
+	if (p == NULL)
+		return false;
+
+	value = 0;
+	for (int i=0; i<8; ++i)
+		value |= (uint64_t)p[i] << (i*8);
+
+	return true;
+}
+
+
+bool BinaryDeserializer::ReadString(string& str)
+{
+	uint32_t length;
+	if (!ReadUInt32(length))
+		return false;
+
+	const uint8_t* p = Read(length);
+	if (p == NULL)
+		return false;
+
+	str = string((const char*) p, length);
+	return true;
+}
+
+
+bool BinaryDeserializer::ReadMemory(void* dst, size_t size)
+{
+	uint64_t rawSize, storedSize;
+	uint8_t method;
+	if (!ReadUInt64(rawSize) || !ReadUInt8(method) ||
+	    !ReadUInt64(storedSize) || rawSize != size)
+		return false;
+
+	const uint8_t* p = Read(storedSize);
+	if (p == NULL)
+		return false;
+
+	switch (method) {
+	case MEMORY_STORED:
+		if (storedSize != size)
+			return false;
+		memcpy(dst, p, size);
+		return true;
+	case MEMORY_COMPRESSED:
+		return BinarySerializer::Decompress(p, storedSize,
+		    (uint8_t*) dst, size);
+	default:
+		return false;
+	}
+}
+
+
+/*****************************************************************************/
+
+
+#ifdef WITHUNITTESTS
+
+static void Test_BinarySerializer_Magic()
+{
+	BinarySerializer serializer;
+	vector<uint8_t> bytes;
+	serializer.GetBytes(bytes);
+
+	UnitTest::Assert("only the magic value should be written",
+	    bytes.size() == 8);
+	UnitTest::Assert("the magic value should be recognized",
+	    BinarySerializer::HasMagic(&bytes[0], bytes.size()));
+
+	BinaryDeserializer deserializer(&bytes[0], bytes.size());
+	UnitTest::Assert("ReadMagic should succeed", deserializer.ReadMagic());
+	UnitTest::Assert("nothing should be left", deserializer.AtEnd());
+
+	const char* text = "component root\n{\n";
+	UnitTest::Assert("text should not be recognized",
+	    !BinarySerializer::HasMagic(text, strlen(text)));
+}
+
+static void Test_BinarySerializer_NestedChunks()
+{
+	uint8_t memory[3] = { 10, 20, 30 };
+
+	BinarySerializer serializer;
+	size_t outer = serializer.BeginChunk("OUTR");
+	serializer.WriteString("hello");
+	size_t inner = serializer.BeginChunk("INNR");
+	serializer.WriteUInt32(0x12345678);
+	serializer.WriteMemory(memory, sizeof(memory));
+	serializer.EndChunk(inner);
+	serializer.WriteUInt64(((uint64_t)0xfedcba98 << 32) | 0x76543210);
+	serializer.EndChunk(outer);
+	serializer.WriteUInt8(42);
+
+	vector<uint8_t> bytes;
+	serializer.GetBytes(bytes);
+	UnitTest::Assert("GetSize should match the bytes",
+	    bytes.size() == serializer.GetSize());
+
+	BinaryDeserializer deserializer(&bytes[0], bytes.size());
+	UnitTest::Assert("magic", deserializer.ReadMagic());
+
+	string tag;
+	BinaryDeserializer outerPayload(NULL, 0);
+	UnitTest::Assert("outer chunk",
+	    deserializer.ReadChunk(tag, outerPayload));
+	UnitTest::Assert("outer tag", tag, "OUTR");
+
+	string str;
+	UnitTest::Assert("string", outerPayload.ReadString(str));
+	UnitTest::Assert("string value", str, "hello");
+
+	BinaryDeserializer innerPayload(NULL, 0);
+	UnitTest::Assert("inner chunk",
+	    outerPayload.ReadChunk(tag, innerPayload));
+	UnitTest::Assert("inner tag", tag, "INNR");
+
+	uint32_t value32 = 0;
+	UnitTest::Assert("uint32", innerPayload.ReadUInt32(value32));
+	UnitTest::Assert("uint32 value", value32, 0x12345678);
+
+	uint8_t readMemory[3];
+	UnitTest::Assert("memory",
+	    innerPayload.ReadMemory(readMemory, sizeof(readMemory)));
+	UnitTest::Assert("memory contents",
+	    memcmp(memory, readMemory, sizeof(memory)) == 0);
+	UnitTest::Assert("inner chunk should be done", innerPayload.AtEnd());
+
+	uint64_t value64 = 0;
+	UnitTest::Assert("uint64", outerPayload.ReadUInt64(value64));
+	UnitTest::Assert("uint64 value", value64,
+	    ((uint64_t)0xfedcba98 << 32) | 0x76543210);
+	UnitTest::Assert("outer chunk should be done", outerPayload.AtEnd());
+
+	uint8_t value8 = 0;
+	UnitTest::Assert("uint8", deserializer.ReadUInt8(value8));
+	UnitTest::Assert("uint8 value", value8, 42);
+	UnitTest::Assert("everything should be read", deserializer.AtEnd());
+	UnitTest::Assert("reading past the end should fail",
+	    !deserializer.ReadUInt8(value8));
+}
+
+static void Test_BinarySerializer_TruncatedChunk()
+{
+	BinarySerializer serializer;
+	size_t chunk = serializer.BeginChunk("DATA");
+	serializer.WriteString("some data");
+	serializer.EndChunk(chunk);
+
+	vector<uint8_t> bytes;
+	serializer.GetBytes(bytes);
+	bytes.resize(bytes.size() - 1);
+
+	BinaryDeserializer deserializer(&bytes[0], bytes.size());
+	UnitTest::Assert("magic", deserializer.ReadMagic());
+
+	string tag;
+	BinaryDeserializer payload(NULL, 0);
+	UnitTest::Assert("a truncated chunk should not be read",
+	    !deserializer.ReadChunk(tag, payload));
+}
+
+static void Test_BinarySerializer_CompressRoundTrip()
+{
+	// Some text, a long run of a single value, and some
+	// pseudo-random (incompressible) bytes at the end.
+	vector<uint8_t> data;
+	const char* text = "abcabcabcabcabc hello hello hello world";
+	data.insert(data.end(), text, text + strlen(text));
+	data.resize(data.size() + 5000, 0x55);
+	uint32_t x = 12345;
+	for (int i=0; i<1000; ++i) {
+		x = x * 1103515245 + 12345;
+		data.push_back(x >> 16);
+	}
+
+	vector<uint8_t> compressed;
+	BinarySerializer::Compress(&data[0], data.size(), compressed);
+	UnitTest::Assert("the data should compress well",
+	    compressed.size() < data.size() / 2);
+
+	vector<uint8_t> decompressed(data.size());
+	UnitTest::Assert("decompression should succeed",
+	    BinarySerializer::Decompress(&compressed[0], compressed.size(),
+	    &decompressed[0], decompressed.size()));
+	UnitTest::Assert("the data should be the same after decompression",
+	    decompressed == data);
+
+	UnitTest::Assert("decompression to the wrong size should fail",
+	    !BinarySerializer::Decompress(&compressed[0], compressed.size(),
+	    &decompressed[0], decompressed.size() - 1));
+}
+
+static void Test_BinarySerializer_CompressedMemory()
+{
+	vector<uint8_t> memory(65536);
+	for (size_t i=0; i<memory.size(); ++i)
+		memory[i] = (i / 100) & 0xff;
+
+	BinarySerializer plain;
+	plain.WriteMemory(&memory[0], memory.size());
+
+	BinarySerializer compressing(true);
+	compressing.WriteMemory(&memory[0], memory.size());
+
+	UnitTest::Assert("compressed memory should be smaller",
+	    compressing.GetSize() < plain.GetSize() / 4);
+
+	vector<uint8_t> bytes;
+	compressing.GetBytes(bytes);
+
+	BinaryDeserializer deserializer(&bytes[0], bytes.size());
+	UnitTest::Assert("magic", deserializer.ReadMagic());
+
+	vector<uint8_t> readMemory(memory.size());
+	UnitTest::Assert("memory should be readable",
+	    deserializer.ReadMemory(&readMemory[0], readMemory.size()));
+	UnitTest::Assert("memory should be the same", readMemory == memory);
+}
+
+UNITTESTS(BinarySerializer)
+{
+	UNITTEST(Test_BinarySerializer_Magic);
+	UNITTEST(Test_BinarySerializer_NestedChunks);
+	UNITTEST(Test_BinarySerializer_TruncatedChunk);
+	UNITTEST(Test_BinarySerializer_CompressRoundTrip);
+	UNITTEST(Test_BinarySerializer_CompressedMemory);
+}
+
+#endif
@@ -278,6 +278,66 @@ void Component::DetectChanges(const refcount_ptr<Component>& oldClone,
 }
 
 
+void Component::RememberState()
+{
+	StateVariableMap::iterator varIt = m_stateVariables.begin();
+	for ( ; varIt != m_stateVariables.end(); ++varIt)
+		(varIt->second).RememberValue();
+
+	m_rememberedChildComponents = m_childComponents;
+
+	for (size_t i = 0; i < m_childComponents.size(); ++ i)
+		m_childComponents[i]->RememberState();
+}
+
+
+void Component::DetectChangesSinceRemembered(ostream& changeMessages) const
+{
+	StateVariableMap::const_iterator varIt = m_stateVariables.begin();
+	for ( ; varIt != m_stateVariables.end(); ++varIt) {
+		const string& varName = varIt->first;
+		const StateVariable& variable = varIt->second;
+
+		if (!variable.HasChangedSinceRemembered() || varName == "step")
+			continue;
+
+		changeMessages << "=> " << GenerateShortestPossiblePath() << "."
+		    << varName << ": " << variable.RememberedValueToString()
+		    << " -> " << variable.ToString() << "\n";
+	}
+
+	// Children are compared by identity, not by name, since they are
+	// the same objects as when the state was remembered.
+	for (size_t i = 0; i < m_childComponents.size(); ++ i) {
+		bool found = false;
+		for (size_t j = 0; j < m_rememberedChildComponents.size(); ++ j)
+			if (m_rememberedChildComponents[j] == m_childComponents[i]) {
+				found = true;
+				break;
+			}
+
+		if (found)
+			m_childComponents[i]->DetectChangesSinceRemembered(changeMessages);
+		else
+			changeMessages << m_childComponents[i]->
+			    GenerateShortestPossiblePath() << " (appeared)\n";
+	}
+
+	for (size_t j = 0; j < m_rememberedChildComponents.size(); ++ j) {
+		bool found = false;
+		for (size_t i = 0; i < m_childComponents.size(); ++ i)
+			if (m_rememberedChildComponents[j] == m_childComponents[i]) {
+				found = true;
+				break;
+			}
+
+		if (!found)
+			changeMessages << m_rememberedChildComponents[j]->
+			    GenerateShortestPossiblePath() << " (disappeared)\n";
+	}
+}
+
+
 void Component::Reset()
 {
 	ResetState();
@@ -1127,6 +1187,23 @@ static bool GetNextToken(const string& str, size_t& pos, string& token)
 }
 
 
+static refcount_ptr<Component> CreateDeserializedComponent(ostream& messages,
+	const string& className)
+{
+	// root is a special case (cannot be created by the factory). All other
+	// class types should be possible to create using the factory.
+	if (className == "root")
+		return new RootComponent;
+
+	refcount_ptr<Component> component =
+	    ComponentFactory::CreateComponent(className);
+	if (component.IsNULL())
+		messages << "Could not create a '" << className << "' component.\n";
+
+	return component;
+}
+
+
 refcount_ptr<Component> Component::Deserialize(ostream& messages, const string& str, size_t& pos)
 {
 	refcount_ptr<Component> deserializedTree = NULL;
@@ -1148,17 +1225,9 @@ refcount_ptr<Component> Component::Deserialize(ostream& messages, const string&
 		return deserializedTree;
 	}
 
-	// root is a special case (cannot be created by the factory). All other
-	// class types should be possible to create using the factory.
-	if (className == "root") {
-		deserializedTree = new RootComponent;
-	} else {
-		deserializedTree = ComponentFactory::CreateComponent(className);
-		if (deserializedTree.IsNULL()) {
-			messages << "Could not create a '" << className << "' component.\n";
-			return deserializedTree;
-		}
-	}
+	deserializedTree = CreateDeserializedComponent(messages, className);
+	if (deserializedTree.IsNULL())
+		return deserializedTree;
 
 	while (pos < str.length()) {
 		size_t savedPos = pos;
@@ -1223,6 +1292,95 @@ refcount_ptr<Component> Component::Deserialize(ostream& messages, const string&
 }
 
 
+void Component::SerializeBinary(BinarySerializer& serializer) const
+{
+	size_t chunk = serializer.BeginChunk("COMP");
+	serializer.WriteString(m_className);
+
+	for (StateVariableMap::const_iterator it = m_stateVariables.begin();
+	    it != m_stateVariables.end(); ++it)
+		(it->second).SerializeBinary(serializer);
+
+	for (size_t i = 0, n = m_childComponents.size(); i < n; ++ i)
+		m_childComponents[i]->SerializeBinary(serializer);
+
+	serializer.EndChunk(chunk);
+}
+
+
+refcount_ptr<Component> Component::DeserializeBinary(ostream& messages,
+	BinaryDeserializer& deserializer)
+{
+	refcount_ptr<Component> deserializedTree = NULL;
+
+	string tag;
+	BinaryDeserializer payload(NULL, 0);
+	if (!deserializer.ReadChunk(tag, payload) || tag != "COMP") {
+		messages << "Expecting a component chunk.\n";
+		return deserializedTree;
+	}
+
+	string className;
+	if (!payload.ReadString(className)) {
+		messages << "Expecting a class name.\n";
+		return deserializedTree;
+	}
+
+	deserializedTree = CreateDeserializedComponent(messages, className);
+	if (deserializedTree.IsNULL())
+		return deserializedTree;
+
+	// The payload consists of either
+	//	1)  COMP chunks (child components), or
+	//	2)  VAR chunks (state variables).
+	// Other chunks are skipped, so that files written by future
+	// versions can still be loaded.
+	while (!payload.AtEnd()) {
+		BinaryDeserializer chunkStart = payload;
+		BinaryDeserializer chunk(NULL, 0);
+		if (!payload.ReadChunk(tag, chunk)) {
+			messages << "Truncated chunk in a '" << className <<
+			    "' component.\n";
+			deserializedTree = NULL;
+			break;
+		}
+
+		if (tag == "COMP") {
+			// Case 1:
+			refcount_ptr<Component> child =
+			    Component::DeserializeBinary(messages, chunkStart);
+			if (child.IsNULL()) {
+				deserializedTree = NULL;
+				break;
+			}
+
+			deserializedTree->AddChild(child);
+		} else if (tag == "VAR ") {
+			// Case 2:
+			enum StateVariable::Type varType;
+			string name;
+			if (!StateVariable::ReadBinaryHeader(chunk, varType,
+			    name)) {
+				messages << "Bad variable chunk in a '" <<
+				    className << "' component.\n";
+				deserializedTree = NULL;
+				break;
+			}
+
+			StateVariable* var = deserializedTree->GetVariable(name);
+			if (var == NULL ||
+			    !var->DeserializeBinaryValue(varType, chunk)) {
+				messages << "Warning: variable '" << name <<
+				    "' for component class " << className <<
+				    " could not be deserialized; skipping.\n";
+			}
+		}
+	}
+
+	return deserializedTree;
+}
+
+
 bool Component::CheckConsistency() const
 {
 	// Serialize
@@ -1246,7 +1404,33 @@ bool Component::CheckConsistency() const
 	tmpDeserializedTree->AddChecksum(checksumDeserialized);
 
 	// ... and compare the checksums:
-	return checksumOriginal == checksumDeserialized;
+	if (checksumOriginal != checksumDeserialized)
+		return false;
+
+	// The same thing again, using the binary format:
+	for (int compress = 0; compress <= 1; ++ compress) {
+		BinarySerializer serializer(compress != 0);
+		SerializeBinary(serializer);
+
+		vector<uint8_t> bytes;
+		serializer.GetBytes(bytes);
+
+		BinaryDeserializer deserializer(&bytes[0], bytes.size());
+		if (!deserializer.ReadMagic())
+			return false;
+
+		refcount_ptr<Component> tmpBinaryTree =
+		    DeserializeBinary(messages, deserializer);
+		if (tmpBinaryTree.IsNULL() || !deserializer.AtEnd())
+			return false;
+
+		Checksum checksumBinary;
+		tmpBinaryTree->AddChecksum(checksumBinary);
+		if (checksumOriginal != checksumBinary)
+			return false;
+	}
+
+	return true;
 }
 
 
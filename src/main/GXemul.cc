@@ -196,6 +196,7 @@ void GXemul::ClearEmulation()
 
 	m_rootComponent = new RootComponent(this);
 	m_emulationFileName = "";
+	m_snapshots.clear();
 
 	GetUI()->UpdateUI();
 }
@@ -685,6 +686,9 @@ void GXemul::SetRootComponent(refcount_ptr<Component> newRootComponent)
 
 	m_rootComponent = newRootComponent;
 
+	// Snapshots of some other emulation are of no use.
+	m_snapshots.clear();
+
 	GetUI()->UpdateUI();
 }
 
@@ -693,6 +697,7 @@ bool GXemul::Reset()
 {
 	// 1. Reset all components in the tree.
 	GetRootComponent()->Reset();
+	m_snapshots.clear();
 
 	// 2. Run "on reset" commands. (These are usually commands to load
 	//    binaries into CPUs.)
@@ -777,6 +782,31 @@ void GXemul::SetSnapshottingEnabled(bool enabled)
 }
 
 
+size_t GXemul::GetNrOfSnapshots() const
+{
+	return m_snapshots.size();
+}
+
+
+uint64_t GXemul::GetSyncQuantum() const
+{
+	const StateVariable* quantum =
+	    GetRootComponent()->GetVariable("syncQuantum");
+
+	return quantum == NULL || quantum->ToInteger() == 0 ?
+	    1 : quantum->ToInteger();
+}
+
+
+uint64_t GXemul::GetSnapshotInterval() const
+{
+	const StateVariable* interval =
+	    GetRootComponent()->GetVariable("snapshotInterval");
+
+	return interval == NULL? 0 : interval->ToInteger();
+}
+
+
 bool GXemul::GetQuietMode() const
 {
 	return m_quietMode;
@@ -807,12 +837,35 @@ bool GXemul::ModifyStep(int64_t oldStep, int64_t newStep)
 		return true;
 
 	if (newStep < oldStep) {
-		// Run in reverse, by running forward from the most suitable
-		// snapshot.
+		// Run in reverse, by running forward from the last snapshot
+		// at or before newStep.
+		size_t n = m_snapshots.size();
+		while (n > 0 && m_snapshots[n-1].step > (uint64_t) newStep)
+			-- n;
+
+		if (n == 0) {
+			GetUI()->ShowDebugMessage("No snapshot to go back from.\n");
+			return false;
+		}
+
+		// Snapshots after newStep are thrown away. The state at newStep
+		// may be modified before the emulation continues, and then
+		// they would no longer be correct.
+		m_snapshots.resize(n);
+
+		refcount_ptr<Component> oldRoot = GetRootComponent();
+		refcount_ptr<Component> newRoot = m_snapshots[n-1].root->Clone();
 
-		// TODO: Multiple snapshots!
-		refcount_ptr<Component> newRoot = m_snapshot->Clone();
+		// The snapshot settings themselves are not rewound.
+		newRoot->GetVariable("snapshotInterval")->CopyValueFrom(
+		    *oldRoot->GetVariable("snapshotInterval"));
+		newRoot->GetVariable("maxSnapshots")->CopyValueFrom(
+		    *oldRoot->GetVariable("maxSnapshots"));
+
+		vector<Snapshot> snapshots;
+		snapshots.swap(m_snapshots);
 		SetRootComponent(newRoot);
+		m_snapshots.swap(snapshots);
 
 		// GetStep will now return the step count for the new root.
 		int64_t nrOfStepsToRunFromSnapshot = newStep - GetStep();
@@ -835,15 +888,47 @@ bool GXemul::ModifyStep(int64_t oldStep, int64_t newStep)
 
 void GXemul::TakeSnapshot()
 {
-	// TODO: Multiple snapshots!
+	uint64_t step = GetStep();
 
-	if (m_snapshot.IsNULL()) {
-		stringstream ss;
-		ss << "(snapshot at step " << GetStep() << ")\n";
-		GetUI()->ShowDebugMessage(ss.str());
+	size_t pos = m_snapshots.size();
+	while (pos > 0 && m_snapshots[pos-1].step >= step) {
+		if (m_snapshots[pos-1].step == step)
+			return;
 
-		m_snapshot = GetRootComponent()->Clone();
+		-- pos;
 	}
+
+	// The snapshot shares RAM blocks with the running emulation, until
+	// one of them writes to a block. Host pointers into RAM, cached by
+	// e.g. CPUs, would bypass that, so they must be forgotten first.
+	GetRootComponent()->FlushCachedState();
+
+	Snapshot snapshot;
+	snapshot.step = step;
+	snapshot.root = GetRootComponent()->Clone();
+	m_snapshots.insert(m_snapshots.begin() + pos, snapshot);
+
+	// Throw away the oldest snapshots, if there are too many. The one at
+	// step 0 is kept, so that it is always possible to go back all the
+	// way (at a higher cost).
+	const StateVariable* maxSnapshots =
+	    GetRootComponent()->GetVariable("maxSnapshots");
+	size_t maxNr = maxSnapshots == NULL? 1 : maxSnapshots->ToInteger();
+	while (m_snapshots.size() > maxNr && m_snapshots.size() > 1)
+		m_snapshots.erase(m_snapshots.begin() + 1);
+}
+
+
+void GXemul::TakeSnapshotIfDue()
+{
+	if (!m_snapshottingEnabled)
+		return;
+
+	uint64_t step = GetStep();
+	uint64_t interval = GetSnapshotInterval();
+
+	if (step == 0 || (interval > 0 && step % interval == 0))
+		TakeSnapshot();
 }
 
 
@@ -853,6 +938,7 @@ struct ComponentAndFrequency
 	double			frequency;
 	StateVariable*		step;
 
+	uint64_t		stepsExecuted;
 	uint64_t		nextTimeToExecute;
 };
 
@@ -872,6 +958,7 @@ static void GetComponentsAndFrequencies(refcount_ptr<Component> component,
 		caf.component = component;
 		caf.frequency = freq->ToDouble();
 		caf.step      = step;
+		caf.stepsExecuted = 0;
 		caf.nextTimeToExecute = 0;
 
 		componentsAndFrequencies.push_back(caf);
@@ -883,6 +970,128 @@ static void GetComponentsAndFrequencies(refcount_ptr<Component> component,
 }
 
 
+// Time is counted in steps of the fastest component. A component which runs
+// q times slower executes its step number n (counting from 0) at time
+// ceil((n+1) * q) - 1, i.e. at the same time as when single-stepping.
+static uint64_t NextTimeToExecute(const ComponentAndFrequency& caf,
+	double fastestFrequency)
+{
+	double q = fastestFrequency / caf.frequency;
+	return (uint64_t) ceil((caf.stepsExecuted + 1) * q) - 1;
+}
+
+
+// Returns the number of steps a component has executed before time t.
+static uint64_t StepsBeforeTime(const ComponentAndFrequency& caf,
+	double fastestFrequency, uint64_t t)
+{
+	return (uint64_t) floor(t * caf.frequency / fastestFrequency);
+}
+
+
+/*
+ *  Runs all components until they have executed all their steps before
+ *  endTime, in discrete-event fashion: the component with the earliest next
+ *  step (the first one in the list, if several are equally early) is
+ *  executed, as far as it may run in one go, and then the next one is
+ *  picked.
+ *
+ *  With syncQuantum == 0 (cycle accuracy), a component may run until the
+ *  next step of any other component. The order is then exactly the same as
+ *  when single-stepping, and e.g. a fast CPU still runs in batches between
+ *  the steps of a slow timer.
+ *
+ *  With syncQuantum > 0 (sloppy accuracy), a component runs to the end of
+ *  the current quantum (aligned to multiples of syncQuantum), even if other
+ *  components have steps in between.
+ *
+ *  Returns false if a component executed fewer steps than it was asked to.
+ */
+static bool ExecuteScheduledComponents(GXemul* gxemul,
+	vector<ComponentAndFrequency>& componentsAndFrequencies,
+	size_t fastestComponentIndex, uint64_t syncQuantum, uint64_t endTime)
+{
+	const size_t nComponents = componentsAndFrequencies.size();
+	const double fastestFrequency =
+	    componentsAndFrequencies[fastestComponentIndex].frequency;
+
+	for (size_t k=0; k<nComponents; ++k) {
+		ComponentAndFrequency& caf = componentsAndFrequencies[k];
+		caf.stepsExecuted = caf.step->ToInteger();
+		caf.nextTimeToExecute = k == fastestComponentIndex ?
+		    caf.stepsExecuted : NextTimeToExecute(caf, fastestFrequency);
+	}
+
+	while (true) {
+		size_t k = nComponents;
+		for (size_t i=0; i<nComponents; ++i)
+			if (componentsAndFrequencies[i].nextTimeToExecute < endTime &&
+			    (k == nComponents ||
+			    componentsAndFrequencies[i].nextTimeToExecute <
+			    componentsAndFrequencies[k].nextTimeToExecute))
+				k = i;
+
+		if (k == nComponents)
+			return true;
+
+		ComponentAndFrequency& caf = componentsAndFrequencies[k];
+
+		// Figure out the time until which component k may run:
+		uint64_t until = endTime;
+		if (syncQuantum > 0) {
+			uint64_t quantumEnd = (caf.nextTimeToExecute /
+			    syncQuantum + 1) * syncQuantum;
+			if (until > quantumEnd)
+				until = quantumEnd;
+		} else {
+			// At the same time, components earlier in the list
+			// execute first.
+			for (size_t j=0; j<nComponents; ++j) {
+				if (j == k)
+					continue;
+
+				uint64_t t = componentsAndFrequencies[j].
+				    nextTimeToExecute + (j > k ? 1 : 0);
+				if (until > t)
+					until = t;
+			}
+		}
+
+		uint64_t goal = k == fastestComponentIndex ? until
+		    : StepsBeforeTime(caf, fastestFrequency, until);
+
+		// (Rounding errors must not cause a component to get stuck.)
+		if (goal <= caf.stepsExecuted)
+			goal = caf.stepsExecuted + 1;
+
+		int toExecute = goal - caf.stepsExecuted;
+
+		// Execute the calculated number of steps...
+		int n = caf.component->Execute(gxemul, toExecute);
+
+		// ... and write back the number of executed steps:
+		caf.stepsExecuted += n;
+		caf.step->SetValue(caf.stepsExecuted);
+
+		if (n != toExecute) {
+			if (n > toExecute) {
+				std::cerr << "Internal error: " << n <<
+				    " steps executed, toExecute = " << toExecute << "\n";
+				throw std::exception();
+			}
+
+			stringstream ss;
+			ss << "only " << n << " steps of " << toExecute << " executed.";
+			gxemul->GetUI()->ShowDebugMessage(caf.component, ss.str());
+			return false;
+		}
+
+		caf.nextTimeToExecute = k == fastestComponentIndex ?
+		    caf.stepsExecuted : NextTimeToExecute(caf, fastestFrequency);
+	}
+}
+
+
 void GXemul::Execute(const int longestTotalRun)
 {
 	vector<ComponentAndFrequency> componentsAndFrequencies;
@@ -895,9 +1104,9 @@ void GXemul::Execute(const int longestTotalRun)
 		return;
 	}
 
-	// Take an initial snapshot at step 0, if snapshotting is enabled:
-	if (m_snapshottingEnabled && GetStep() == 0)
-		TakeSnapshot();
+	// Take the initial snapshot at step 0 (or a periodic one), if
+	// snapshotting is enabled:
+	TakeSnapshotIfDue();
 
 	// Find the fastest component:
 	double fastestFrequency = componentsAndFrequencies[0].frequency;
@@ -952,8 +1161,7 @@ void GXemul::Execute(const int longestTotalRun)
 				if (stepsExecutedSoFar < nsteps) {
 					++ stepsExecutedSoFar;
 
-					const refcount_ptr<Component> lightClone =
-					    GetRootComponent()->LightClone();
+					GetRootComponent()->RememberState();
 
 					// Execute one step...
 					int n = componentsAndFrequencies[k].component->Execute(this, 1);
@@ -966,10 +1174,9 @@ void GXemul::Execute(const int longestTotalRun)
 					// ... and write back the number of executed steps:
 					componentsAndFrequencies[k].step->SetValue(stepsExecutedSoFar);
 
-					// Now, let's compare the clone of the component tree
-					// before execution with what we have now.
+					// Now, let's see what was changed by the step.
 					stringstream changeMessages;
-					GetRootComponent()->DetectChanges(lightClone, changeMessages);
+					GetRootComponent()->DetectChangesSinceRemembered(changeMessages);
 					string msg = changeMessages.str();
 					if (msg.length() > 0)
 						GetUI()->ShowDebugMessage(msg);
@@ -977,6 +1184,7 @@ void GXemul::Execute(const int longestTotalRun)
 			}
 
 			SetStep(step);
+			TakeSnapshotIfDue();
 			-- m_nrOfSingleStepsLeft;
 		}
 
@@ -989,114 +1197,56 @@ void GXemul::Execute(const int longestTotalRun)
 		{
 			uint64_t step = GetStep();
 			uint64_t startingStep = step;
-
-			// TODO: sloppy vs cycle accuracy.
-			if (GetRootComponent()->GetVariable("accuracy")->ToString() != "cycle") {
-				std::cerr << "GXemul::Execute(): TODO: Only "
-				    "root.accuracy=\"cycle\" is currently supported\n";
-				SetRunState(Paused);
-				return;
-			}
-
-			// The following code is for cycle accurate emulation:
+			uint64_t snapshotInterval =
+			    m_snapshottingEnabled? GetSnapshotInterval() : 0;
+
+			// With "cycle" accuracy, components execute in exactly
+			// the same order as when single-stepping. With "sloppy"
+			// accuracy, each component runs a whole quantum of
+			// root.syncQuantum steps (of the fastest component)
+			// at a time, regardless of the others.
+			uint64_t syncQuantum = 0;
+			if (GetRootComponent()->GetVariable("accuracy")->ToString() == "sloppy")
+				syncQuantum = GetSyncQuantum();
 
 			while (step < startingStep + longestTotalRun) {
 				if (m_interrupting || GetRunState() != Running)
 					break;
 
-				int toExecute = -1;
-				
-				if (componentsAndFrequencies.size() == 1) {
-					toExecute = longestTotalRun;
-					componentsAndFrequencies[0].nextTimeToExecute = step;
-				} else {
-					// First, calculate the next time step when each
-					// component k will execute.
-					//
-					// For n = 0,1,2,3, ...
-					// n * fastestFrequency / componentsAndFrequencies[k].frequency
-					// are the steps at which the component executes
-					// (when rounded UP! i.e. executing at step 4.2 means that it
-					// did not execute at step 4, but will at step 5).
-				
-					for (size_t k=0; k<componentsAndFrequencies.size(); ++k) {
-						double q = (k == fastestComponentIndex ? 1.0
-						    : fastestFrequency / componentsAndFrequencies[k].frequency);
-
-						double c = (componentsAndFrequencies[k].step->ToInteger()+1) * q;
-						componentsAndFrequencies[k].nextTimeToExecute = (uint64_t) ceil(c) - 1;
-					}
-
-					// std::cerr << "step " << step << " debug:\n";
-					for (size_t k=0; k<componentsAndFrequencies.size(); ++k) {
-						// std::cerr << "  next step for component " <<
-						//    componentsAndFrequencies[k].component->GetVariable("name")->ToString()
-						//    << ": " << componentsAndFrequencies[k].nextTimeToExecute << "\n";
-
-						int diff = componentsAndFrequencies[k].nextTimeToExecute -
-						    componentsAndFrequencies[fastestComponentIndex].nextTimeToExecute;
-						if (k != fastestComponentIndex) {
-							if (toExecute == -1 || diff < toExecute)
-								toExecute = diff;
-						}
-					}
+				uint64_t endStep = startingStep + longestTotalRun;
 
-					if (toExecute < 1)
-						toExecute = 1;
+				// Stop at the next snapshot, if there is one coming up:
+				if (snapshotInterval > 0) {
+					uint64_t nextSnapshotStep = (step /
+					    snapshotInterval + 1) * snapshotInterval;
+					if (endStep > nextSnapshotStep)
+						endStep = nextSnapshotStep;
 				}
 
-				if (step + toExecute > startingStep + longestTotalRun)
-					toExecute = startingStep + longestTotalRun - step;
+				StateVariable* fastestStep =
+				    componentsAndFrequencies[fastestComponentIndex].step;
+				uint64_t fastestStepBefore = fastestStep->ToInteger();
 
-				// std::cerr << "  toExecute = " << toExecute << "\n";
+				bool completed = ExecuteScheduledComponents(this,
+				    componentsAndFrequencies, fastestComponentIndex,
+				    syncQuantum, fastestStepBefore + endStep - step);
 
-				// Run the components.
-				// If multiple components are to run at the same time (i.e.
-				// same nextTimeToExecute), toExecute will be exactly 1.
-				int maxExecuted = 0;
-				bool abort = false;
-				for (size_t k=0; k<componentsAndFrequencies.size(); ++k) {
-					if (step != componentsAndFrequencies[k].nextTimeToExecute)
-						continue;
-
-					// Execute the calculated number of steps...
-					int n = componentsAndFrequencies[k].component->Execute(this, toExecute);
-
-					// ... and write back the number of executed steps:
-					uint64_t stepsExecutedSoFar = n +
-					    componentsAndFrequencies[k].step->ToInteger();
-					componentsAndFrequencies[k].step->SetValue(stepsExecutedSoFar);
-
-					if (k == fastestComponentIndex)
-						maxExecuted = n;
-
-					if (n != toExecute) {
-						abort = true;
-
-						if (n > toExecute) {
-							std::cerr << "Internal error: " << n <<
-							    " steps executed, toExecute = " << toExecute << "\n";
-							throw std::exception();
-						}
-
-						stringstream ss;
-						ss << "only " << n << " steps of " << toExecute << " executed.";
-						GetUI()->ShowDebugMessage(componentsAndFrequencies[k].component, ss.str());
-					}
-				}
+				uint64_t executed = fastestStep->ToInteger() -
+				    fastestStepBefore;
 
-				if (abort) {
+				if (!completed) {
 					GetUI()->ShowDebugMessage("Continuous execution aborted.\n");
 					SetRunState(Paused);
 				}
 
-				if (maxExecuted == 0 && GetRunState() == Running) {
-					std::cerr << "maxExecuted=0. internal error\n";
+				if (executed == 0 && GetRunState() == Running) {
+					std::cerr << "Nothing executed. Internal error\n";
 					throw std::exception();
 				}
 
-				step += maxExecuted;
+				step += executed;
 				SetStep(step);
+				TakeSnapshotIfDue();
 			}
 
 			// Output nr of steps (and speed) every second:
@@ -27,6 +27,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "EscapedString.h"
 #include "StateVariable.h"
@@ -37,6 +38,7 @@ StateVariable::StateVariable(const string& name, string* ptrToString)
 	: m_name(name)
 	, m_type(String)
 {
+	m_remembered.vuint64 = 0;
 	m_value.pstr = ptrToString;
 }
 
@@ -45,6 +47,7 @@ StateVariable::StateVariable(const string& name, bool* ptrToVar)
 	: m_name(name)
 	, m_type(Bool)
 {
+	m_remembered.vuint64 = 0;
 	m_value.pbool = ptrToVar;
 }
 
@@ -53,6 +56,7 @@ StateVariable::StateVariable(const string& name, double* ptrToVar)
 	: m_name(name)
 	, m_type(Double)
 {
+	m_remembered.vuint64 = 0;
 	m_value.pdouble = ptrToVar;
 }
 
@@ -61,6 +65,7 @@ StateVariable::StateVariable(const string& name, uint8_t* ptrToVar)
 	: m_name(name)
 	, m_type(UInt8)
 {
+	m_remembered.vuint64 = 0;
 	m_value.puint8 = ptrToVar;
 }
 
@@ -69,6 +74,7 @@ StateVariable::StateVariable(const string& name, uint16_t* ptrToVar)
 	: m_name(name)
 	, m_type(UInt16)
 {
+	m_remembered.vuint64 = 0;
 	m_value.puint16 = ptrToVar;
 }
 
@@ -77,6 +83,7 @@ StateVariable::StateVariable(const string& name, uint32_t* ptrToVar)
 	: m_name(name)
 	, m_type(UInt32)
 {
+	m_remembered.vuint64 = 0;
 	m_value.puint32 = ptrToVar;
 }
 
@@ -85,6 +92,7 @@ StateVariable::StateVariable(const string& name, uint64_t* ptrToVar)
 	: m_name(name)
 	, m_type(UInt64)
 {
+	m_remembered.vuint64 = 0;
 	m_value.puint64 = ptrToVar;
 }
 
@@ -93,6 +101,7 @@ StateVariable::StateVariable(const string& name, int8_t* ptrToVar)
 	: m_name(name)
 	, m_type(SInt8)
 {
+	m_remembered.vuint64 = 0;
 	m_value.psint8 = ptrToVar;
 }
 
@@ -101,6 +110,7 @@ StateVariable::StateVariable(const string& name, int16_t* ptrToVar)
 	: m_name(name)
 	, m_type(SInt16)
 {
+	m_remembered.vuint64 = 0;
 	m_value.psint16 = ptrToVar;
 }
 
@@ -109,6 +119,7 @@ StateVariable::StateVariable(const string& name, int32_t* ptrToVar)
 	: m_name(name)
 	, m_type(SInt32)
 {
+	m_remembered.vuint64 = 0;
 	m_value.psint32 = ptrToVar;
 }
 
@@ -117,6 +128,7 @@ StateVariable::StateVariable(const string& name, int64_t* ptrToVar)
 	: m_name(name)
 	, m_type(SInt64)
 {
+	m_remembered.vuint64 = 0;
 	m_value.psint64 = ptrToVar;
 }
 
@@ -125,6 +137,7 @@ StateVariable::StateVariable(const string& name, CustomStateVariableHandler* ptr
 	: m_name(name)
 	, m_type(Custom)
 {
+	m_remembered.vuint64 = 0;
 	m_value.phandler = ptrToHandler;
 }
 
@@ -388,6 +401,231 @@ void StateVariable::Serialize(ostream& ss, SerializationContext& context) const
 }
 
 
+void StateVariable::SerializeBinary(BinarySerializer& serializer) const
+{
+	size_t chunk = serializer.BeginChunk("VAR ");
+	serializer.WriteUInt8(m_type);
+	serializer.WriteString(m_name);
+
+	switch (m_type) {
+
+	case String:
+		serializer.WriteString(ToString());
+		break;
+
+	case Double:
+		{
+			uint64_t bits;
+			memcpy(&bits, m_value.pdouble, sizeof(bits));
+			serializer.WriteUInt64(bits);
+		}
+		break;
+
+	case Custom:
+		m_value.phandler->SerializeBinary(serializer);
+		break;
+
+	default:
+		serializer.WriteUInt64(ToInteger());
+	}
+
+	serializer.EndChunk(chunk);
+}
+
+
+bool StateVariable::ReadBinaryHeader(BinaryDeserializer& deserializer,
+	enum Type& type, string& name)
+{
+	uint8_t t;
+	if (!deserializer.ReadUInt8(t) || t > Custom)
+		return false;
+
+	type = (enum Type) t;
+	return deserializer.ReadString(name);
+}
+
+
+bool StateVariable::DeserializeBinaryValue(enum Type type,
+	BinaryDeserializer& deserializer)
+{
+	if (type != m_type)
+		return false;
+
+	if (m_type == String)
+		return deserializer.ReadString(*m_value.pstr);
+
+	if (m_type == Custom)
+		return m_value.phandler->DeserializeBinary(deserializer);
+
+	uint64_t value;
+	if (!deserializer.ReadUInt64(value))
+		return false;
+
+	switch (m_type) {
+	case Bool:
+		*m_value.pbool = value != 0;
+		break;
+	case Double:
+		memcpy(m_value.pdouble, &value, sizeof(value));
+		break;
+	case UInt8:
+		*m_value.puint8 = value;
+		break;
+	case UInt16:
+		*m_value.puint16 = value;
+		break;
+	case UInt32:
+		*m_value.puint32 = value;
+		break;
+	case UInt64:
+		*m_value.puint64 = value;
+		break;
+	case SInt8:
+		*m_value.psint8 = value;
+		break;
+	case SInt16:
+		*m_value.psint16 = value;
+		break;
+	case SInt32:
+		*m_value.psint32 = value;
+		break;
+	case SInt64:
+		*m_value.psint64 = value;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+
+void StateVariable::RememberValue()
+{
+	switch (m_type) {
+	case String:
+		m_rememberedString = m_value.pstr == NULL? "" : *m_value.pstr;
+		break;
+	case Bool:
+		m_remembered.vbool = *m_value.pbool;
+		break;
+	case Double:
+		m_remembered.vdouble = *m_value.pdouble;
+		break;
+	case UInt8:
+		m_remembered.vuint8 = *m_value.puint8;
+		break;
+	case UInt16:
+		m_remembered.vuint16 = *m_value.puint16;
+		break;
+	case UInt32:
+		m_remembered.vuint32 = *m_value.puint32;
+		break;
+	case UInt64:
+		m_remembered.vuint64 = *m_value.puint64;
+		break;
+	case SInt8:
+		m_remembered.vsint8 = *m_value.psint8;
+		break;
+	case SInt16:
+		m_remembered.vsint16 = *m_value.psint16;
+		break;
+	case SInt32:
+		m_remembered.vsint32 = *m_value.psint32;
+		break;
+	case SInt64:
+		m_remembered.vsint64 = *m_value.psint64;
+		break;
+	case Custom:
+		break;
+	}
+}
+
+
+bool StateVariable::HasChangedSinceRemembered() const
+{
+	switch (m_type) {
+	case String:
+		return (m_value.pstr == NULL? "" : *m_value.pstr)
+		    != m_rememberedString;
+	case Bool:
+		return m_remembered.vbool != *m_value.pbool;
+	case Double:
+		// NaN is not equal to itself, but that is not a change:
+		return m_remembered.vdouble != *m_value.pdouble &&
+		    !(m_remembered.vdouble != m_remembered.vdouble &&
+		    *m_value.pdouble != *m_value.pdouble);
+	case UInt8:
+		return m_remembered.vuint8 != *m_value.puint8;
+	case UInt16:
+		return m_remembered.vuint16 != *m_value.puint16;
+	case UInt32:
+		return m_remembered.vuint32 != *m_value.puint32;
+	case UInt64:
+		return m_remembered.vuint64 != *m_value.puint64;
+	case SInt8:
+		return m_remembered.vsint8 != *m_value.psint8;
+	case SInt16:
+		return m_remembered.vsint16 != *m_value.psint16;
+	case SInt32:
+		return m_remembered.vsint32 != *m_value.psint32;
+	case SInt64:
+		return m_remembered.vsint64 != *m_value.psint64;
+	case Custom:
+		return false;
+	}
+
+	return false;
+}
+
+
+string StateVariable::RememberedValueToString() const
+{
+	// A copy of the variable, pointing to the remembered value instead
+	// of the real one, is formatted just like the real one:
+	StateVariable remembered(*this);
+
+	switch (m_type) {
+	case String:
+		return m_rememberedString;
+	case Bool:
+		remembered.m_value.pbool = &remembered.m_remembered.vbool;
+		break;
+	case Double:
+		remembered.m_value.pdouble = &remembered.m_remembered.vdouble;
+		break;
+	case UInt8:
+		remembered.m_value.puint8 = &remembered.m_remembered.vuint8;
+		break;
+	case UInt16:
+		remembered.m_value.puint16 = &remembered.m_remembered.vuint16;
+		break;
+	case UInt32:
+		remembered.m_value.puint32 = &remembered.m_remembered.vuint32;
+		break;
+	case UInt64:
+		remembered.m_value.puint64 = &remembered.m_remembered.vuint64;
+		break;
+	case SInt8:
+		remembered.m_value.psint8 = &remembered.m_remembered.vsint8;
+		break;
+	case SInt16:
+		remembered.m_value.psint16 = &remembered.m_remembered.vsint16;
+		break;
+	case SInt32:
+		remembered.m_value.psint32 = &remembered.m_remembered.vsint32;
+		break;
+	case SInt64:
+		remembered.m_value.psint64 = &remembered.m_remembered.vsint64;
+		break;
+	case Custom:
+		break;
+	}
+
+	return remembered.ToString();
+}
+
+
 string StateVariable::EvaluateExpression(const string& expression,
 	bool& success) const
 {
@@ -938,6 +1176,95 @@ static void Test_StateVariable_Numeric_SetValue()
 	// Tests for other numeric types: TODO
 }
 
+static void Test_StateVariable_RememberValue()
+{
+	uint64_t varUInt64 = 0x1234;
+	string varString = "hello";
+	StateVariable vuint64("hello", &varUInt64);
+	StateVariable vstring("world", &varString);
+
+	vuint64.RememberValue();
+	vstring.RememberValue();
+	UnitTest::Assert("uint64 should not have changed yet",
+	    vuint64.HasChangedSinceRemembered() == false);
+	UnitTest::Assert("string should not have changed yet",
+	    vstring.HasChangedSinceRemembered() == false);
+
+	// Direct writes, not via SetValue, must also be detected:
+	varUInt64 = 0x5678;
+	varString = "there";
+	UnitTest::Assert("uint64 should have changed",
+	    vuint64.HasChangedSinceRemembered() == true);
+	UnitTest::Assert("string should have changed",
+	    vstring.HasChangedSinceRemembered() == true);
+	UnitTest::Assert("remembered uint64",
+	    vuint64.RememberedValueToString(), "0x1234");
+	UnitTest::Assert("remembered string",
+	    vstring.RememberedValueToString(), "hello");
+	UnitTest::Assert("current uint64", vuint64.ToString(), "0x5678");
+
+	// Writing back the old value is not a change:
+	vuint64.SetValue("0x1234");
+	UnitTest::Assert("uint64 is back to the remembered value",
+	    vuint64.HasChangedSinceRemembered() == false);
+}
+
+static void Test_StateVariable_SerializeBinary()
+{
+	string myString = "hello\nworld";
+	double myDouble = -1.0 / 3.0;
+	int16_t mySInt16 = -1234;
+	StateVariable stringVar("s", &myString);
+	StateVariable doubleVar("d", &myDouble);
+	StateVariable sint16Var("i", &mySInt16);
+
+	BinarySerializer serializer;
+	stringVar.SerializeBinary(serializer);
+	doubleVar.SerializeBinary(serializer);
+	sint16Var.SerializeBinary(serializer);
+
+	vector<uint8_t> bytes;
+	serializer.GetBytes(bytes);
+
+	myString = "";
+	myDouble = 0.0;
+	mySInt16 = 0;
+
+	BinaryDeserializer deserializer(&bytes[0], bytes.size());
+	UnitTest::Assert("magic", deserializer.ReadMagic());
+
+	StateVariable* vars[3] = { &stringVar, &doubleVar, &sint16Var };
+	for (int i=0; i<3; ++i) {
+		string tag, name;
+		enum StateVariable::Type type = StateVariable::Custom;
+		BinaryDeserializer payload(NULL, 0);
+		UnitTest::Assert("chunk", deserializer.ReadChunk(tag, payload));
+		UnitTest::Assert("tag", tag, "VAR ");
+		UnitTest::Assert("header",
+		    StateVariable::ReadBinaryHeader(payload, type, name));
+		UnitTest::Assert("name", name, vars[i]->GetName());
+		UnitTest::Assert("value",
+		    vars[i]->DeserializeBinaryValue(type, payload));
+	}
+
+	UnitTest::Assert("string value", myString, "hello\nworld");
+	UnitTest::Assert("double value should be exact",
+	    myDouble == -1.0 / 3.0);
+	UnitTest::Assert("sint16 value", mySInt16 == -1234);
+
+	// A value of the wrong type should not be accepted:
+	BinaryDeserializer again(&bytes[0], bytes.size());
+	again.ReadMagic();
+	string tag, name;
+	enum StateVariable::Type type = StateVariable::Double;
+	BinaryDeserializer payload(NULL, 0);
+	UnitTest::Assert("chunk again", again.ReadChunk(tag, payload));
+	UnitTest::Assert("header again",
+	    StateVariable::ReadBinaryHeader(payload, type, name));
+	UnitTest::Assert("type mismatch should fail",
+	    !doubleVar.DeserializeBinaryValue(type, payload));
+}
+
 UNITTESTS(StateVariable)
 {
 	// String tests
@@ -959,6 +1286,12 @@ UNITTESTS(StateVariable)
 	//UNITTEST(Test_StateVariable_Numeric_CopyValueFrom);
 	//UNITTEST(Test_StateVariable_Numeric_Serialize);
 
+	// Change detection
+	UNITTEST(Test_StateVariable_RememberValue);
+
+	// Binary serialization
+	UNITTEST(Test_StateVariable_SerializeBinary);
+
 	// TODO: ToInteger tests.
 
 	// TODO: Custom tests.
@@ -25,9 +25,13 @@
  *  SUCH DAMAGE.
  */
 
+#include <fcntl.h>
 #include <fstream>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "commands/LoadCommand.h"
 #include "FileLoader.h"
@@ -62,8 +66,57 @@ bool LoadCommand::IsComponentTree(GXemul& gxemul, const string& filename) const
 	if (file.gcount() < 10)
 		return false;
 
-	// Saved component trees start with the string "component ".
-	return (strncmp(buf, "component ", 10) == 0);
+	// Saved component trees start with the string "component ", or
+	// with the magic value of the binary format.
+	return (strncmp(buf, "component ", 10) == 0 ||
+	    BinarySerializer::HasMagic(buf, file.gcount()));
+}
+
+
+static refcount_ptr<Component> LoadBinaryComponentTree(
+	const string& filename, ostream& messages)
+{
+	refcount_ptr<Component> component;
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		messages << "Unable to open " << filename << " for reading.\n";
+		if (fd >= 0)
+			close(fd);
+		return component;
+	}
+
+	// The file is mapped instead of read, so that RAM contents can be
+	// copied directly from the file into the RAM components.
+	size_t size = st.st_size;
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		messages << "Unable to map " << filename << " into memory.\n";
+		return component;
+	}
+
+	BinaryDeserializer deserializer(data, size);
+	if (deserializer.ReadMagic())
+		component = Component::DeserializeBinary(messages, deserializer);
+
+	munmap(data, size);
+
+	return component;
+}
+
+
+bool LoadCommand::IsBinaryComponentTree(const string& filename) const
+{
+	std::ifstream file(filename.c_str());
+	if (file.fail())
+		return false;
+
+	char buf[16];
+	file.read(buf, sizeof(buf));
+	return BinarySerializer::HasMagic(buf, file.gcount());
 }
 
 
@@ -78,6 +131,23 @@ bool LoadCommand::LoadComponentTree(GXemul& gxemul, const string&filename,
 
 	refcount_ptr<Component> component;
 
+	if (IsBinaryComponentTree(filename)) {
+		stringstream messages;
+		component = LoadBinaryComponentTree(filename, messages);
+
+		if (messages.str().length() > 0)
+			ShowMsg(gxemul, messages.str());
+
+		if (component.IsNULL()) {
+			ShowMsg(gxemul, "Loading from " + filename + " failed; "
+			    "no component found?\n");
+			return false;
+		}
+
+		return AddLoadedComponentTree(gxemul, filename, component,
+		    specifiedComponent);
+	}
+
 	// Load from the file
 	std::ifstream file(filename.c_str());
 	if (file.fail()) {
@@ -122,6 +192,15 @@ bool LoadCommand::LoadComponentTree(GXemul& gxemul, const string&filename,
 		return false;
 	}
 
+	return AddLoadedComponentTree(gxemul, filename, component,
+	    specifiedComponent);
+}
+
+
+bool LoadCommand::AddLoadedComponentTree(GXemul& gxemul,
+	const string& filename, refcount_ptr<Component> component,
+	refcount_ptr<Component> specifiedComponent) const
+{
 	if (specifiedComponent.IsNULL()) {
 		const StateVariable* name = component->GetVariable("name");
 		if (name == NULL || name->ToString() != "root")
@@ -245,7 +324,8 @@ string LoadCommand::GetLongDescription() const
 	    "\n"
 	    "   will instead replace the whole configuration tree with what's in\n"
 	    "   myMachine.gxemul. The filename may be omitted, if it is known from an\n"
-	    "   earlier save or load command.\n"
+	    "   earlier save or load command. Both the textual and the binary formats\n"
+	    "   written by the save command can be loaded.\n"
 	    "\n"
 	    "2. Loads a binary (ELF, a.out, ...) into a CPU or data bus. E.g.:\n"
 	    "\n"
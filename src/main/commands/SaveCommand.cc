@@ -28,11 +28,13 @@
 #include "commands/SaveCommand.h"
 #include "GXemul.h"
 
+#include <fcntl.h>
 #include <fstream>
+#include <unistd.h>
 
 
 SaveCommand::SaveCommand()
-	: Command("save", "[filename [component-path]]")
+	: Command("save", "[-b|-z] [filename [component-path]]")
 {
 }
 
@@ -48,26 +50,60 @@ static void ShowMsg(GXemul& gxemul, const string& msg)
 }
 
 
+static bool SaveBinary(GXemul& gxemul, refcount_ptr<Component> component,
+	const string& filename, bool compress)
+{
+	int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		ShowMsg(gxemul, "Error: Could not open " + filename +
+		    " for writing.\n");
+		return false;
+	}
+
+	BinarySerializer serializer(compress);
+	component->SerializeBinary(serializer);
+
+	bool success = serializer.WriteToFile(fd);
+	if (close(fd) != 0)
+		success = false;
+
+	if (!success)
+		ShowMsg(gxemul, "Error: Could not write to " + filename +
+		    "; saving the emulation setup failed!\n");
+
+	return success;
+}
+
+
 bool SaveCommand::Execute(GXemul& gxemul, const vector<string>& arguments)
 {
 	string filename = gxemul.GetEmulationFilename();
 	string path = "root";
+	bool binary = false;
+	bool compress = false;
+
+	vector<string> args = arguments;
+	if (args.size() > 0 && (args[0] == "-b" || args[0] == "-z")) {
+		binary = true;
+		compress = args[0] == "-z";
+		args.erase(args.begin());
+	}
 
-	if (arguments.size() > 2) {
+	if (args.size() > 2) {
 		ShowMsg(gxemul, "Too many arguments.\n");
 		return false;
 	}
 
-	if (arguments.size() > 0)
-		filename = arguments[0];
+	if (args.size() > 0)
+		filename = args[0];
 
 	if (filename == "") {
 		ShowMsg(gxemul, "No filename given.\n");
 		return false;
 	}
 
-	if (arguments.size() > 1)
-		path = arguments[1];
+	if (args.size() > 1)
+		path = args[1];
 
 	vector<string> matches = gxemul.GetRootComponent()->
 	    FindPathByPartialMatch(path);
@@ -96,7 +132,10 @@ bool SaveCommand::Execute(GXemul& gxemul, const vector<string>& arguments)
 		    " a .gxemul extension. Continuing anyway.\n");
 
 	// Write to the file:
-	{
+	if (binary) {
+		if (!SaveBinary(gxemul, component, filename, compress))
+			return false;
+	} else {
 		std::fstream outputstream(filename.c_str(),
 		    std::ios::out | std::ios::trunc);
 		if (outputstream.fail()) {
@@ -143,6 +182,11 @@ string SaveCommand::GetLongDescription() const
 	    "\n"
 	    "The filename extension should usually be .gxemul.\n"
 	    "\n"
+	    "By default, the emulation is saved as readable text. With -b, it is instead\n"
+	    "saved in a binary format, which is much faster to save and load, and smaller,\n"
+	    "when there is a lot of RAM contents. -z is like -b, but also compresses\n"
+	    "the RAM contents. The load command recognizes all of these formats.\n"
+	    "\n"
 	    "See also:  load    (to load an emulation setup)\n";
 }
 
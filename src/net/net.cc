@@ -239,6 +239,57 @@ static void net_arp(struct net *net, void *extra,
 }
 
 
+/*
+ *  ethernet_rx():
+ *
+ *  The actual implementation of net_ethernet_rx(). The caller must hold the
+ *  network's lock.
+ */
+static int ethernet_rx(struct net *net, void *extra,
+	unsigned char **packetp, int *lenp)
+{
+	struct ethernet_packet_link *lp, *prev;
+
+	/*  Find the first packet which has the right 'extra' field.  */
+
+	lp = net->first_ethernet_packet;
+	prev = NULL;
+	while (lp != NULL) {
+		if (lp->extra == extra) {
+			/*  We found a packet for this controller!  */
+			if (packetp == NULL || lenp == NULL)
+				return 1;
+
+			/*  Let's return it:  */
+			(*packetp) = lp->data;
+			(*lenp) = lp->len;
+
+			/*  Remove this link from the linked list:  */
+			if (prev == NULL)
+				net->first_ethernet_packet = lp->next;
+			else
+				prev->next = lp->next;
+
+			if (lp->next == NULL)
+				net->last_ethernet_packet = prev;
+			else
+				lp->next->prev = prev;
+
+			free(lp);
+
+			/*  ... and return successfully:  */
+			return 1;
+		}
+
+		prev = lp;
+		lp = lp->next;
+	}
+
+	/*  No packet found. :-(  */
+	return 0;
+}
+
+
 /*
  *  net_ethernet_rx_avail():
  *
@@ -252,9 +303,13 @@ static void net_arp(struct net *net, void *extra,
  */
 int net_ethernet_rx_avail(struct net *net, void *extra)
 {
+	int avail;
+
 	if (net == NULL)
 		return 0;
 
+	NET_LOCK(net);
+
 	/*
 	 *  If the network is distributed across multiple emulator processes,
 	 *  then receive incoming packets from those processes.
@@ -293,7 +348,10 @@ int net_ethernet_rx_avail(struct net *net, void *extra)
 	net_udp_rx_avail(net, extra);
 	net_tcp_rx_avail(net, extra);
 
-	return net_ethernet_rx(net, extra, NULL, NULL);
+	avail = ethernet_rx(net, extra, NULL, NULL);
+
+	NET_UNLOCK(net);
+	return avail;
 }
 
 
@@ -316,66 +374,30 @@ int net_ethernet_rx_avail(struct net *net, void *extra)
 int net_ethernet_rx(struct net *net, void *extra,
 	unsigned char **packetp, int *lenp)
 {
-	struct ethernet_packet_link *lp, *prev;
+	int res;
 
 	if (net == NULL)
 		return 0;
 
-	/*  Find the first packet which has the right 'extra' field.  */
-
-	lp = net->first_ethernet_packet;
-	prev = NULL;
-	while (lp != NULL) {
-		if (lp->extra == extra) {
-			/*  We found a packet for this controller!  */
-			if (packetp == NULL || lenp == NULL)
-				return 1;
-
-			/*  Let's return it:  */
-			(*packetp) = lp->data;
-			(*lenp) = lp->len;
-
-			/*  Remove this link from the linked list:  */
-			if (prev == NULL)
-				net->first_ethernet_packet = lp->next;
-			else
-				prev->next = lp->next;
-
-			if (lp->next == NULL)
-				net->last_ethernet_packet = prev;
-			else
-				lp->next->prev = prev;
-
-			free(lp);
-
-			/*  ... and return successfully:  */
-			return 1;
-		}
-
-		prev = lp;
-		lp = lp->next;
-	}
+	NET_LOCK(net);
+	res = ethernet_rx(net, extra, packetp, lenp);
+	NET_UNLOCK(net);
 
-	/*  No packet found. :-(  */
-	return 0;
+	return res;
 }
 
 
 /*
- *  net_ethernet_tx():
+ *  ethernet_tx():
  *
- *  Transmit an ethernet packet, as seen from the emulated ethernet controller.
- *  If the packet can be handled here, it will not necessarily be transmitted
- *  to the outside world.
+ *  The actual implementation of net_ethernet_tx(). The caller must hold the
+ *  network's lock.
  */
-void net_ethernet_tx(struct net *net, void *extra,
+static void ethernet_tx(struct net *net, void *extra,
 	unsigned char *packet, int len)
 {
 	int i, eth_type, for_the_gateway;
 
-	if (net == NULL)
-		return;
-
 	for_the_gateway = !memcmp(packet, net->gateway_ethernet_addr, 6);
 
 	/*  Drop too small packets:  */
@@ -494,6 +516,25 @@ void net_ethernet_tx(struct net *net, void *extra,
 }
 
 
+/*
+ *  net_ethernet_tx():
+ *
+ *  Transmit an ethernet packet, as seen from the emulated ethernet controller.
+ *  If the packet can be handled here, it will not necessarily be transmitted
+ *  to the outside world.
+ */
+void net_ethernet_tx(struct net *net, void *extra,
+	unsigned char *packet, int len)
+{
+	if (net == NULL)
+		return;
+
+	NET_LOCK(net);
+	ethernet_tx(net, extra, packet, len);
+	NET_UNLOCK(net);
+}
+
+
 /*
  *  parse_resolvconf():
  *
@@ -731,6 +772,10 @@ struct net *net_init(struct emul *emul, int init_flags,
 	/*  Set the back pointer:  */
 	net->emul = emul;
 
+#ifdef HAVE_PTHREADS
+	pthread_mutex_init(&net->mutex, NULL);
+#endif
+
 	/*  Sane defaults:  */
 	net->timestamp = 0;
 	net->first_ethernet_packet = net->last_ethernet_packet = NULL;
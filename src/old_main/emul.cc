@@ -52,6 +52,10 @@
 #include "timer.h"
 #include "x11.h"
 
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "thirdparty/exec_elf.h"
 
 
@@ -66,6 +70,7 @@ extern int old_show_trace_tree;
 extern int old_instruction_trace;
 extern int old_quiet_mode;
 extern int quiet_mode;
+extern int parallel_machines;
 
 
 /*
@@ -399,6 +404,13 @@ void emul_machine_setup(struct machine *m, int n_load, char **load_names,
 		}
 	}
 	m->memory = memory_new(memory_amount, m->arch);
+	if (m->contiguous_ram &&
+	    !memory_reserve_contiguous(m->memory, memory_amount))
+		fatal("\nWARNING: could not allocate %i MB of contiguous RAM;"
+		    " using memblocks.\n", (int)(memory_amount / 1048576));
+	if (m->ram_image_filename != NULL &&
+	    !memory_map_image(m->memory, m->ram_image_filename))
+		exit(1);
 	debug("\n");
 
 	/*  Create CPUs:  */
@@ -779,6 +791,146 @@ struct emul *emul_create_from_configfile(char *fname)
 }
 
 
+#ifdef HAVE_PTHREADS
+/*
+ *  Parallel execution of machines (-P):
+ *
+ *  Each machine is run in its own host thread, PARALLEL_QUANTUM_USEC
+ *  microseconds at a time. Between two quanta, the main thread takes care of
+ *  things which are not thread-safe, such as the debugger. Separate machines
+ *  share nothing but the network and the console, which have their own
+ *  locks.
+ *
+ *  The threads are started once, and then wait for the main thread to start
+ *  each quantum. At the end of a quantum, the main thread waits until all
+ *  threads have stopped (i.e. a barrier). All of this is protected by
+ *  parallel_mutex.
+ */
+#define	PARALLEL_QUANTUM_USEC	10000
+
+struct machine_thread {
+	pthread_t	thread;
+	struct machine	*machine;
+	int		running;
+};
+
+static pthread_mutex_t parallel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t parallel_cond = PTHREAD_COND_INITIALIZER;
+static int parallel_quantum;		/*  Incremented for each quantum  */
+static int parallel_stop;		/*  Set at the end of a quantum  */
+static int parallel_n_done;		/*  Threads done with the quantum  */
+static int parallel_quit;		/*  Set when the threads should exit  */
+
+
+static void *machine_thread_main(void *arg)
+{
+	struct machine_thread *mt = (struct machine_thread *) arg;
+	int quantum = 0;
+
+	pthread_mutex_lock(&parallel_mutex);
+
+	for (;;) {
+		while (parallel_quantum == quantum && !parallel_quit)
+			pthread_cond_wait(&parallel_cond, &parallel_mutex);
+		if (parallel_quit)
+			break;
+
+		quantum = parallel_quantum;
+
+		while (!parallel_stop && mt->running) {
+			pthread_mutex_unlock(&parallel_mutex);
+			if (!machine_run(mt->machine))
+				mt->running = 0;
+			pthread_mutex_lock(&parallel_mutex);
+		}
+
+		parallel_n_done ++;
+		pthread_cond_broadcast(&parallel_cond);
+	}
+
+	pthread_mutex_unlock(&parallel_mutex);
+	return NULL;
+}
+
+
+/*
+ *  emul_start_parallel_threads():
+ *
+ *  Start one host thread per machine. The threads wait for
+ *  emul_run_parallel_quantum() to run a quantum.
+ */
+static void emul_start_parallel_threads(struct emul *emul,
+	struct machine_thread *mt)
+{
+	int j;
+
+	for (j=0; j<emul->n_machines; j++) {
+		mt[j].machine = emul->machines[j];
+		mt[j].running = 1;
+		if (pthread_create(&mt[j].thread, NULL, machine_thread_main,
+		    &mt[j]) != 0) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+}
+
+
+/*
+ *  emul_stop_parallel_threads():
+ *
+ *  Tell the machine threads to exit, and wait for them to do so.
+ */
+static void emul_stop_parallel_threads(struct emul *emul,
+	struct machine_thread *mt)
+{
+	int j;
+
+	pthread_mutex_lock(&parallel_mutex);
+	parallel_quit = 1;
+	pthread_cond_broadcast(&parallel_cond);
+	pthread_mutex_unlock(&parallel_mutex);
+
+	for (j=0; j<emul->n_machines; j++)
+		pthread_join(mt[j].thread, NULL);
+}
+
+
+/*
+ *  emul_run_parallel_quantum():
+ *
+ *  Run all machines for one quantum, each in its own host thread.
+ *  Returns 1 if any machine is still running, 0 if all have stopped.
+ */
+static int emul_run_parallel_quantum(struct emul *emul,
+	struct machine_thread *mt)
+{
+	int j, anything = 0;
+
+	pthread_mutex_lock(&parallel_mutex);
+	parallel_stop = 0;
+	parallel_n_done = 0;
+	parallel_quantum ++;
+	pthread_cond_broadcast(&parallel_cond);
+	pthread_mutex_unlock(&parallel_mutex);
+
+	usleep(PARALLEL_QUANTUM_USEC);
+
+	pthread_mutex_lock(&parallel_mutex);
+	parallel_stop = 1;
+	while (parallel_n_done < emul->n_machines)
+		pthread_cond_wait(&parallel_cond, &parallel_mutex);
+	pthread_mutex_unlock(&parallel_mutex);
+
+	for (j=0; j<emul->n_machines; j++)
+		if (mt[j].running)
+			anything = 1;
+
+	return anything;
+}
+#endif
+
+
 /*
  *  emul_run():
  *
@@ -791,6 +943,9 @@ struct emul *emul_create_from_configfile(char *fname)
 void emul_run(struct emul *emul)
 {
 	int i = 0, j, go = 1, n, anything;
+#ifdef HAVE_PTHREADS
+	struct machine_thread *mthreads = NULL;
+#endif
 
 	atexit(fix_console);
 
@@ -851,6 +1006,30 @@ void emul_run(struct emul *emul)
 		cpu_functioncall_trace(emul->machines[0]->cpus[0],
 		    emul->machines[0]->cpus[0]->pc);
 
+	/*  Run each machine in its own host thread?  */
+	if (parallel_machines && emul->n_machines > 1) {
+#ifdef HAVE_PTHREADS
+		n = 0;
+		for (j=0; j<emul->n_machines; j++)
+			if (emul->machines[j]->x11_md.in_use)
+				n++;
+
+		if (n > 0)
+			fatal("WARNING: -P cannot be used together with X11."
+			    " Running the machines one at a time.\n");
+		else {
+			CHECK_ALLOCATION(mthreads = (struct machine_thread *)
+			    malloc(sizeof(struct machine_thread) *
+			    emul->n_machines));
+			emul_start_parallel_threads(emul, mthreads);
+		}
+#else
+		fatal("WARNING: -P is not available, because this binary"
+		    " was built without\npthreads support. Running the"
+		    " machines one at a time.\n");
+#endif
+	}
+
 	/*  Start emulated clocks:  */
 	timer_start();
 
@@ -897,6 +1076,14 @@ void emul_run(struct emul *emul)
 		if (single_step == SINGLE_STEPPING)
 			debugger();
 
+#ifdef HAVE_PTHREADS
+		/*  When single-stepping, the machines are run one at a time:  */
+		if (mthreads != NULL && single_step == NOT_SINGLE_STEPPING) {
+			go = emul_run_parallel_quantum(emul, mthreads);
+			continue;
+		}
+#endif
+
 		for (j=0; j<emul->n_machines; j++) {
 			anything = machine_run(emul->machines[j]);
 			if (anything)
@@ -904,6 +1091,13 @@ void emul_run(struct emul *emul)
 		}
 	}
 
+#ifdef HAVE_PTHREADS
+	if (mthreads != NULL) {
+		emul_stop_parallel_threads(emul, mthreads);
+		free(mthreads);
+	}
+#endif
+
 	/*  Stop any running timers:  */
 	timer_stop();
 
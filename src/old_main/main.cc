@@ -63,7 +63,9 @@ char **extra_argv;
 char *progname;
 
 size_t dyntrans_cache_size = DEFAULT_DYNTRANS_CACHE_SIZE;
+int parallel_machines = 0;
 static int skip_srandom_call = 0;
+static int sync_timers_to_host_clock = 0;
 
 
 /*****************************************************************************
@@ -267,6 +269,8 @@ static void usage(int longusage)
 	printf("                t      tape\n");
 	printf("                V      add an overlay\n");
 	printf("                0-7    force a specific ID\n");
+	printf("  -G        translate runs of simple MIPS instructions into"
+	    " native host code\n            (x86-64 hosts only)\n");
 	printf("  -I hz     set the main cpu frequency to hz (not used by "
 	    "all combinations\n            of machines and guest OSes)\n");
 	printf("  -i        display each instruction as it is executed\n");
@@ -281,6 +285,11 @@ static void usage(int longusage)
 	printf("            For other emulation modes, if the boot disk is an"
 	    " ISO9660\n            filesystem, -j sets the name of the"
 	    " kernel to load.\n");
+	printf("  -L        allocate the physical RAM as one contiguous "
+	    "host region, using\n            huge pages if the host "
+	    "supports them\n");
+	printf("  -l file   map a RAM image file (saved with the debugger's "
+	    "writeram command)\n            as physical RAM, copy-on-write\n");
 	printf("  -M m      emulate m MBs of physical RAM\n");
 	printf("  -N        display nr of instructions/second average, at"
 	    " regular intervals\n");
@@ -336,9 +345,15 @@ static void usage(int longusage)
 	    " size is %i MB)\n", DEFAULT_DYNTRANS_CACHE_SIZE / 1048576);
 	printf("  -K        force the debugger to be entered at the end "
 	    "of a simulation\n");
+	printf("  -P        run each machine in its own host thread (when"
+	    " more than one\n            machine is used, e.g. in a"
+	    " configuration file)\n");
 	printf("  -q        quiet mode (don't print startup messages)\n");
 	printf("  -V        start up in the single-step debugger, paused\n");
 	printf("  -v        increase debug message verbosity\n");
+	printf("  -w        let emulated clocks follow the host's real-time"
+	    " clock, instead\n            of the number of executed"
+	    " instructions\n");
 	printf("\n");
 	printf("If you are selecting a machine type to emulate directly "
 	    "on the command line,\nthen you must specify one or more names"
@@ -388,7 +403,7 @@ int get_cmd_args(int argc, char *argv[], struct emul *emul,
 	struct machine *m = emul_add_machine(emul, NULL);
 
 	const char *opts =
-	    "BC:c:Dd:E:e:HhI:iJj:k:KM:Nn:Oo:p:QqRrSs:TtUVvW:"
+	    "BC:c:Dd:E:e:GHhI:iJj:k:KLl:M:Nn:Oo:Pp:QqRrSs:TtUVvW:w"
 #ifdef WITH_X11
 	    "XxY:"
 #endif
@@ -441,6 +456,10 @@ int get_cmd_args(int argc, char *argv[], struct emul *emul,
 			subtype = optarg;
 			msopts = 1;
 			break;
+		case 'G':
+			m->native_code_translation = 1;
+			msopts = 1;
+			break;
 		case 'H':
 			GXemul::ListTemplates();
 			printf("--------------------------------------------------------------------------\n\n");
@@ -478,6 +497,15 @@ int get_cmd_args(int argc, char *argv[], struct emul *emul,
 		case 'K':
 			force_debugger_at_exit = 1;
 			break;
+		case 'L':
+			m->contiguous_ram = 1;
+			msopts = 1;
+			break;
+		case 'l':
+			CHECK_ALLOCATION(m->ram_image_filename =
+			    strdup(optarg));
+			msopts = 1;
+			break;
 		case 'M':
 			m->physical_ram_in_mb = atoi(optarg);
 			msopts = 1;
@@ -500,6 +528,9 @@ int get_cmd_args(int argc, char *argv[], struct emul *emul,
 			    strdup(optarg));
 			msopts = 1;
 			break;
+		case 'P':
+			parallel_machines = 1;
+			break;
 		case 'p':
 			machine_add_breakpoint_string(m, optarg);
 			msopts = 1;
@@ -548,6 +579,9 @@ int get_cmd_args(int argc, char *argv[], struct emul *emul,
 		case 'W':
 			internal_w(optarg);
 			exit(0);
+		case 'w':
+			sync_timers_to_host_clock = 1;
+			break;
 		case 'X':
 			m->x11_md.in_use = 1;
 			msopts = 1;
@@ -810,7 +844,6 @@ int main(int argc, char *argv[])
 	cpu_init();
 	device_init();
 	machine_init();
-	timer_init();
 
 	/*  Create a simple emulation setup:  */
 	emul = emul_new(NULL);
@@ -819,6 +852,8 @@ int main(int argc, char *argv[])
 
 	get_cmd_args(argc, argv, emul, &diskimages, &n_diskimages);
 
+	timer_init(sync_timers_to_host_clock);
+
 	if (!skip_srandom_call) {
 		struct timeval tv;
 		gettimeofday(&tv, NULL);
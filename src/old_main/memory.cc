@@ -31,8 +31,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "cpu.h"
 #include "machine.h"
@@ -177,10 +180,347 @@ struct memory *memory_new(uint64_t physical_max, int arch)
 	mem->mmap_dev_minaddr = 0xffffffffffffffffULL;
 	mem->mmap_dev_maxaddr = 0;
 
+	s = ((size_t)1 << DEVICE_INDEX_TOP_BITS) * sizeof(int32_t *);
+	mem->device_index = (int32_t **) mmap(NULL, s,
+	    PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+	if (mem->device_index == MAP_FAILED) {
+		CHECK_ALLOCATION(mem->device_index = (int32_t **) malloc(s));
+		memset(mem->device_index, 0, s);
+	}
+
 	return mem;
 }
 
 
+/*
+ *  memory_reserve_contiguous():
+ *
+ *  Back the lowest len bytes of physical memory with one contiguous host
+ *  region, instead of memblocks which are allocated on demand. hugetlbfs
+ *  pages are used if the host has any reserved, otherwise the region is
+ *  aligned to a huge page boundary and marked for transparent huge pages.
+ *
+ *  Returns 1 on success, 0 if the region could not be allocated. (Memory is
+ *  then allocated in memblocks, as usual.)
+ */
+int memory_reserve_contiguous(struct memory *mem, uint64_t len)
+{
+	void **table = (void **) mem->pagetable;
+	const char *kind = "small pages";
+	unsigned char *p = (unsigned char *) MAP_FAILED;
+	size_t alloclen, entry;
+
+	len = (len + (1 << BITS_PER_MEMBLOCK) - 1) &
+	    ~(uint64_t)((1 << BITS_PER_MEMBLOCK) - 1);
+	if (len == 0 || len > ((uint64_t)1 << MAX_BITS))
+		return 0;
+
+	/*  Memblocks which are already in use cannot be moved:  */
+	for (entry = 0; entry < (len >> BITS_PER_MEMBLOCK); entry++)
+		if (table[entry] != NULL)
+			return 0;
+
+	alloclen = (len + MEMORY_HUGE_PAGE_SIZE - 1) &
+	    ~(size_t)(MEMORY_HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+	p = (unsigned char *) mmap(NULL, alloclen, PROT_READ | PROT_WRITE,
+	    MAP_ANON | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+	if (p != MAP_FAILED)
+		kind = "hugetlbfs pages";
+#endif
+
+	if (p == MAP_FAILED) {
+		/*  Allocate one extra huge page, to be able to align:  */
+		p = (unsigned char *) mmap(NULL, alloclen +
+		    MEMORY_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+		    MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+		if (p == MAP_FAILED)
+			return 0;
+
+		p = (unsigned char *) (((size_t)p + MEMORY_HUGE_PAGE_SIZE - 1)
+		    & ~(size_t)(MEMORY_HUGE_PAGE_SIZE - 1));
+
+#ifdef MADV_HUGEPAGE
+		if (madvise(p, alloclen, MADV_HUGEPAGE) == 0)
+			kind = "transparent huge pages";
+#endif
+	}
+
+	for (entry = 0; entry < (len >> BITS_PER_MEMBLOCK); entry++)
+		table[entry] = p + (entry << BITS_PER_MEMBLOCK);
+
+	mem->contiguous_ram = p;
+	mem->contiguous_ram_len = len;
+
+	debug(" (contiguous, %s)", kind);
+	return 1;
+}
+
+
+/*
+ *  memory_map_image():
+ *
+ *  Map a RAM image file (e.g. saved with memory_save_image()) as physical
+ *  memory, starting at address 0. The mapping is private (copy-on-write), so
+ *  the file itself is never modified, and emulator instances using the same
+ *  image share its unmodified pages in the host.
+ *
+ *  Returns 1 on success, 0 on failure.
+ */
+int memory_map_image(struct memory *mem, const char *filename)
+{
+	void **table = (void **) mem->pagetable;
+	unsigned char *base, *p;
+	size_t len, entry;
+	struct stat st;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		perror(filename);
+		return 0;
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0 ||
+	    (uint64_t)st.st_size > ((uint64_t)1 << MAX_BITS)) {
+		fprintf(stderr, "%s: not a usable RAM image\n", filename);
+		close(fd);
+		return 0;
+	}
+
+	len = ((size_t)st.st_size + (1 << BITS_PER_MEMBLOCK) - 1) &
+	    ~(size_t)((1 << BITS_PER_MEMBLOCK) - 1);
+
+	if (mem->contiguous_ram != NULL && len <= mem->contiguous_ram_len) {
+		/*  Replace the first part of the contiguous region:  */
+		base = mem->contiguous_ram;
+	} else {
+		for (entry = 0; entry < (len >> BITS_PER_MEMBLOCK); entry++)
+			if (table[entry] != NULL) {
+				fprintf(stderr, "%s: the RAM image overlaps "
+				    "memory which is already in use\n",
+				    filename);
+				close(fd);
+				return 0;
+			}
+
+		/*
+		 *  Reserve whole memblocks first, so that the part of the
+		 *  last memblock which is beyond the end of the file is
+		 *  ordinary zero-filled memory:
+		 */
+		base = (unsigned char *) mmap(NULL, len, PROT_READ |
+		    PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+		if (base == MAP_FAILED) {
+			perror("mmap");
+			close(fd);
+			return 0;
+		}
+	}
+
+	p = (unsigned char *) mmap(base, st.st_size, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_FIXED, fd, 0);
+	close(fd);
+
+	if (p == MAP_FAILED) {
+		perror(filename);
+		return 0;
+	}
+
+	if (base != mem->contiguous_ram)
+		for (entry = 0; entry < (len >> BITS_PER_MEMBLOCK); entry++)
+			table[entry] = base + (entry << BITS_PER_MEMBLOCK);
+
+	mem->ram_image = base;
+	mem->ram_image_len = st.st_size;
+
+	debug(" (image %s)", filename);
+	return 1;
+}
+
+
+/*
+ *  memory_save_image():
+ *
+ *  Save physical memory 0 .. physical_max-1 to a RAM image file, which can be
+ *  mapped later using memory_map_image(). Memblocks which have never been
+ *  used are left as holes in the file.
+ *
+ *  Returns 1 on success, 0 on failure.
+ */
+int memory_save_image(struct memory *mem, const char *filename)
+{
+	void **table = (void **) mem->pagetable;
+	const size_t blocksize = 1 << BITS_PER_MEMBLOCK;
+	uint64_t ofs;
+	int fd;
+
+	fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror(filename);
+		return 0;
+	}
+
+	for (ofs = 0; ofs < mem->physical_max; ofs += blocksize) {
+		unsigned char *block = (unsigned char *)
+		    table[ofs >> BITS_PER_MEMBLOCK];
+		size_t n = mem->physical_max - ofs < blocksize?
+		    mem->physical_max - ofs : blocksize;
+
+		if (block == NULL)
+			continue;
+
+		if (pwrite(fd, block, n, ofs) != (ssize_t) n) {
+			perror(filename);
+			close(fd);
+			return 0;
+		}
+	}
+
+	if (ftruncate(fd, mem->physical_max) != 0) {
+		perror(filename);
+		close(fd);
+		return 0;
+	}
+
+	close(fd);
+	return 1;
+}
+
+
+/*  mincore() takes an unsigned char vector on Linux, char elsewhere:  */
+#ifdef __linux__
+typedef unsigned char mincore_vec_t;
+#else
+typedef char mincore_vec_t;
+#endif
+
+
+/*
+ *  memory_zero_scan():
+ *
+ *  Look at up to n_pages resident host pages of allocated memblocks, and
+ *  return the ones which contain only zeroes to the host, with
+ *  MADV_DONTNEED. This is called by idle cpus, and continues where the
+ *  previous call left off.
+ *
+ *  The memblocks stay mapped, and a released page reads as zeroes (and is
+ *  allocated again when written to), so host pointers to it held by the
+ *  dyntrans translation tables remain valid and need no invalidation.
+ *
+ *  Only memblocks below physical_max are looked at. Pages from a RAM image
+ *  file are skipped, since MADV_DONTNEED would bring back the file contents.
+ *  Contiguous RAM (-L) is also skipped, so that its huge pages are not split
+ *  up. If these cover all of the RAM, there is nothing to do.
+ */
+void memory_zero_scan(struct memory *mem, int n_pages)
+{
+	void **table = (void **) mem->pagetable;
+	const uint64_t blocksize = 1 << BITS_PER_MEMBLOCK;
+	const size_t pagesize = getpagesize();
+	uint64_t start, end;
+	int n_entries;
+	mincore_vec_t vec[256];
+
+	/*  Memblocks start .. end-1 are scanned:  */
+	start = mem->ram_image_len > mem->contiguous_ram_len?
+	    mem->ram_image_len : mem->contiguous_ram_len;
+	start = (start + blocksize - 1) & ~(blocksize - 1);
+	end = (mem->physical_max + blocksize - 1) & ~(blocksize - 1);
+	if (start >= end)
+		return;
+
+	n_entries = (end - start) >> BITS_PER_MEMBLOCK;
+
+	while (n_pages > 0 && n_entries-- > 0) {
+		uint64_t pos = mem->zero_scan_pos;
+		unsigned char *block;
+		size_t i, n, ofs;
+
+		if (pos < start || pos >= end)
+			pos = start;
+
+		block = (unsigned char *) table[pos >> BITS_PER_MEMBLOCK];
+		ofs = pos & (blocksize - 1);
+
+		/*  Next time, continue with the next memblock:  */
+		mem->zero_scan_pos = (pos + blocksize) & ~(blocksize - 1);
+
+		if (block == NULL)
+			continue;
+
+		n = (blocksize - ofs) / pagesize;
+		if (n > (size_t) n_pages)
+			n = n_pages;
+		if (n > sizeof(vec))
+			n = sizeof(vec);
+		if (ofs + n * pagesize < blocksize)
+			mem->zero_scan_pos = pos + n * pagesize;
+
+		if (mincore(block + ofs, n * pagesize, vec) != 0)
+			continue;
+
+		for (i = 0; i < n; i++) {
+			uint64_t *p = (uint64_t *) (block + ofs + i*pagesize);
+			size_t j;
+
+			if (!(vec[i] & 1))
+				continue;
+
+			n_pages --;
+
+			for (j = 0; j < pagesize / sizeof(uint64_t); j++)
+				if (p[j] != 0)
+					break;
+
+			if (j == pagesize / sizeof(uint64_t) &&
+			    madvise(p, pagesize, MADV_DONTNEED) == 0)
+				mem->zero_pages_released ++;
+		}
+	}
+}
+
+
+/*
+ *  memory_footprint():
+ *
+ *  Returns the number of bytes of physical memory which have been touched
+ *  (i.e. which belong to allocated memblocks), and how many of those bytes
+ *  are resident in the host.
+ */
+void memory_footprint(struct memory *mem, uint64_t *touchedp,
+	uint64_t *residentp)
+{
+	void **table = (void **) mem->pagetable;
+	const size_t blocksize = 1 << BITS_PER_MEMBLOCK;
+	const size_t pagesize = getpagesize();
+	mincore_vec_t vec[256];
+	size_t entry, ofs, i, n;
+
+	*touchedp = *residentp = 0;
+
+	for (entry = 0; entry < ((size_t)1 << BITS_PER_PAGETABLE); entry++) {
+		unsigned char *block = (unsigned char *) table[entry];
+		if (block == NULL)
+			continue;
+
+		*touchedp += blocksize;
+
+		for (ofs = 0; ofs < blocksize; ofs += n * pagesize) {
+			n = (blocksize - ofs) / pagesize;
+			if (n > sizeof(vec))
+				n = sizeof(vec);
+			if (mincore(block + ofs, n * pagesize, vec) != 0)
+				break;
+			for (i = 0; i < n; i++)
+				if (vec[i] & 1)
+					*residentp += pagesize;
+		}
+	}
+}
+
+
 /*
  *  memory_points_to_string():
  *
@@ -257,52 +597,134 @@ char *memory_conv_to_string(struct cpu *cpu, struct memory *mem, uint64_t addr,
 
 
 /*
- *  memory_device_dyntrans_access():
+ *  memory_device_dirty_size():
+ *
+ *  Returns the size in bytes of a device's dirty page bitmap.
+ */
+static size_t memory_device_dirty_size(struct memory_device *dev)
+{
+	return (((dev->length - 1) >> DYNTRANS_DIRTY_PAGE_SHIFT) / 64 + 1)
+	    * sizeof(uint64_t);
+}
+
+
+/*
+ *  memory_device_set_dirty():
  *
- *  Get the lowest and highest dyntrans access since last time.
+ *  Marks the pages of a DM_DYNTRANS_WRITE_OK device which contain offsets
+ *  low..high as dirty. Called by memory_rw() when a page is made writable
+ *  for dyntrans; later writes to the page do not go through memory_rw().
  */
-void memory_device_dyntrans_access(struct cpu *cpu, struct memory *mem,
+void memory_device_set_dirty(struct memory_device *dev, uint64_t low,
+	uint64_t high)
+{
+	uint64_t page, lastpage;
+
+	if (dev->dyntrans_dirty == NULL)
+		return;
+
+	if (high >= dev->length)
+		high = dev->length - 1;
+
+	lastpage = high >> DYNTRANS_DIRTY_PAGE_SHIFT;
+	for (page = low >> DYNTRANS_DIRTY_PAGE_SHIFT; page <= lastpage; page++)
+		dev->dyntrans_dirty[page / 64] |= (uint64_t)1 << (page & 63);
+
+	dev->dyntrans_dirty_any = 1;
+
+	if (dev->dirty_wakeup != NULL)
+		dev->dirty_wakeup(dev->extra);
+}
+
+
+/*
+ *  memory_device_set_dirty_wakeup():
+ *
+ *  Sets the function which memory_device_set_dirty() calls for a
+ *  DM_DYNTRANS_WRITE_OK device. A device whose tick function sleeps while
+ *  nothing is dirty uses this to be woken up again.
+ */
+void memory_device_set_dirty_wakeup(struct memory *mem, void *extra,
+	void (*f)(void *))
+{
+	int i;
+
+	for (i=0; i<mem->n_mmapped_devices; i++)
+		if (mem->devices[i].extra == extra)
+			mem->devices[i].dirty_wakeup = f;
+}
+
+
+/*
+ *  memory_device_dyntrans_dirty():
+ *
+ *  Get the next run of dirty pages of a DM_DYNTRANS_WRITE_OK device, i.e.
+ *  pages which have been written to via dyntrans since the last call.
+ *  *low and *high are set to the offsets of the first and last byte of the
+ *  run. Call this in a loop; it returns 0 when there are no more dirty
+ *  pages, so scattered writes give separate (small) runs instead of one
+ *  range spanning all of them.
+ *
+ *  The pages of the run are marked as clean, and read-only in the dyntrans
+ *  load/store cache again, so that the next write to them is noticed.
+ */
+int memory_device_dyntrans_dirty(struct cpu *cpu, struct memory *mem,
 	void *extra, uint64_t *low, uint64_t *high)
 {
-	size_t s;
-	int i, need_inval = 0;
+	struct memory_device *dev = NULL;
+	uint64_t *bits, first, last, s;
+	size_t n_words, w;
+	int j;
+
+	/*  Only devices with DM_DYNTRANS_WRITE_OK can have been written to
+	    via dyntrans, and there are usually only one or two of them.  */
+	for (j=0; j<mem->n_dyntrans_write_devices; j++) {
+		dev = &mem->devices[mem->dyntrans_write_devices[j]];
+		if (dev->extra == extra && dev->dyntrans_data != NULL)
+			break;
+	}
 
-	/*  TODO: This is O(n), so it might be good to rewrite it some day.
-	    For now, it will be enough, as long as this function is not
-	    called too often.  */
+	if (j == mem->n_dyntrans_write_devices || !dev->dyntrans_dirty_any)
+		return 0;
 
-	for (i=0; i<mem->n_mmapped_devices; i++) {
-		if (mem->devices[i].extra == extra &&
-		    mem->devices[i].flags & DM_DYNTRANS_WRITE_OK &&
-		    mem->devices[i].dyntrans_data != NULL) {
-			if (mem->devices[i].dyntrans_write_low != (uint64_t) -1)
-				need_inval = 1;
-			if (low != NULL)
-				*low = mem->devices[i].dyntrans_write_low;
-			mem->devices[i].dyntrans_write_low = (uint64_t) -1;
-
-			if (high != NULL)
-				*high = mem->devices[i].dyntrans_write_high;
-			mem->devices[i].dyntrans_write_high = 0;
-
-			if (!need_inval)
-				return;
-
-			/*  Invalidate any pages of this device that might
-			    be in the dyntrans load/store cache, by marking
-			    the pages read-only.  */
-			if (cpu->invalidate_translation_caches != NULL) {
-				for (s = *low; s <= *high;
-				    s += cpu->machine->arch_pagesize)
-					cpu->invalidate_translation_caches
-					    (cpu, mem->devices[i].baseaddr + s,
-					    JUST_MARK_AS_NON_WRITABLE
-					    | INVALIDATE_PADDR);
-			}
+	bits = dev->dyntrans_dirty;
+	n_words = memory_device_dirty_size(dev) / sizeof(uint64_t);
 
-			return;
-		}
+	for (w = 0; w < n_words; w++)
+		if (bits[w] != 0)
+			break;
+
+	if (w == n_words) {
+		dev->dyntrans_dirty_any = 0;
+		return 0;
 	}
+
+	/*  Find the first dirty page, and the end of the run which starts
+	    there. The bits of the run are cleared:  */
+	first = w * 64;
+	while (!(bits[w] & ((uint64_t)1 << (first & 63))))
+		first ++;
+
+	last = first;
+	while (last / 64 < n_words &&
+	    bits[last / 64] & ((uint64_t)1 << (last & 63))) {
+		bits[last / 64] &= ~((uint64_t)1 << (last & 63));
+		last ++;
+	}
+
+	*low = first << DYNTRANS_DIRTY_PAGE_SHIFT;
+	*high = (last << DYNTRANS_DIRTY_PAGE_SHIFT) - 1;
+	if (*high >= dev->length)
+		*high = dev->length - 1;
+
+	if (cpu->invalidate_translation_caches != NULL)
+		for (s = *low; s <= *high;
+		    s += (1 << DYNTRANS_DIRTY_PAGE_SHIFT))
+			cpu->invalidate_translation_caches(cpu,
+			    dev->baseaddr + s, JUST_MARK_AS_NON_WRITABLE
+			    | INVALIDATE_PADDR);
+
+	return 1;
 }
 
 
@@ -325,12 +747,145 @@ void memory_device_update_data(struct memory *mem, void *extra,
 			continue;
 
 		mem->devices[i].dyntrans_data = data;
-		mem->devices[i].dyntrans_write_low = (uint64_t)-1;
-		mem->devices[i].dyntrans_write_high = 0;
+		if (mem->devices[i].dyntrans_dirty != NULL)
+			memset(mem->devices[i].dyntrans_dirty, 0,
+			    memory_device_dirty_size(&mem->devices[i]));
+		mem->devices[i].dyntrans_dirty_any = 0;
 	}
 }
 
 
+/*
+ *  memory_device_index_update():
+ *
+ *  Updates the device index entries of all pages overlapped by device i,
+ *  which has just been added (adding = 1) or is about to be removed
+ *  (adding = 0). Only the first and last page of a device may be shared
+ *  with other devices, since devices do not overlap.
+ */
+static void memory_device_index_update(struct memory *mem, int i, int adding)
+{
+	const uint64_t leafmask = (1 << DEVICE_INDEX_LEAF_BITS) - 1;
+	int32_t value = mem->devices[i].index_slot + 1;
+	uint64_t page, lastpage;
+
+	page = mem->devices[i].baseaddr >> DEVICE_INDEX_PAGE_BITS;
+	lastpage = (mem->devices[i].endaddr - 1) >> DEVICE_INDEX_PAGE_BITS;
+
+	if (lastpage >= ((uint64_t)1 << (DEVICE_INDEX_MAX_BITS -
+	    DEVICE_INDEX_PAGE_BITS)))
+		lastpage = ((uint64_t)1 << (DEVICE_INDEX_MAX_BITS -
+		    DEVICE_INDEX_PAGE_BITS)) - 1;
+
+	for (; page <= lastpage; page++) {
+		int32_t **leafp = &mem->device_index[page >>
+		    DEVICE_INDEX_LEAF_BITS];
+		int32_t *entry;
+
+		if (*leafp == NULL) {
+			if (!adding) {
+				page |= leafmask;
+				continue;
+			}
+			CHECK_ALLOCATION(*leafp = (int32_t *) calloc(
+			    1 << DEVICE_INDEX_LEAF_BITS, sizeof(int32_t)));
+		}
+
+		entry = &(*leafp)[page & leafmask];
+
+		if (adding) {
+			/*  Keep entries of lower devices sharing the page:  */
+			if (*entry == 0 ||
+			    mem->device_slot_to_index[*entry - 1] > i)
+				*entry = value;
+		} else if (*entry == value) {
+			/*  The next device may start in the same page:  */
+			*entry = 0;
+			if (i + 1 < mem->n_mmapped_devices &&
+			    (mem->devices[i+1].baseaddr >>
+			    DEVICE_INDEX_PAGE_BITS) == page)
+				*entry = mem->devices[i+1].index_slot + 1;
+		}
+	}
+}
+
+
+/*
+ *  memory_device_renumber():
+ *
+ *  Updates the slot to device number mapping for devices first and up,
+ *  after devices have been inserted or removed, and rebuilds the list of
+ *  devices that may be written to via dyntrans.
+ */
+static void memory_device_renumber(struct memory *mem, int first)
+{
+	int i;
+
+	for (i=first; i<mem->n_mmapped_devices; i++)
+		mem->device_slot_to_index[mem->devices[i].index_slot] = i;
+
+	mem->n_dyntrans_write_devices = 0;
+	CHECK_ALLOCATION(mem->dyntrans_write_devices = (int *) realloc(
+	    mem->dyntrans_write_devices, sizeof(int) *
+	    (mem->n_mmapped_devices + 1)));
+
+	for (i=0; i<mem->n_mmapped_devices; i++)
+		if (mem->devices[i].flags & DM_DYNTRANS_WRITE_OK)
+			mem->dyntrans_write_devices[
+			    mem->n_dyntrans_write_devices ++] = i;
+}
+
+
+/*
+ *  memory_device_find():
+ *
+ *  Returns the index of the device which covers paddr, or -1 if there is
+ *  no such device. Pages below 1 << DEVICE_INDEX_MAX_BITS are looked up in
+ *  the page-granular device index; higher addresses use a binary search
+ *  among the (sorted) devices.
+ */
+int memory_device_find(struct memory *mem, uint64_t paddr)
+{
+	uint64_t page = paddr >> DEVICE_INDEX_PAGE_BITS;
+	int i, start, end;
+
+	if ((paddr >> DEVICE_INDEX_MAX_BITS) == 0) {
+		int32_t *leaf = mem->device_index[page >>
+		    DEVICE_INDEX_LEAF_BITS];
+
+		if (leaf == NULL)
+			return -1;
+
+		/*  Several small devices may share the same page:  */
+		i = leaf[page & ((1 << DEVICE_INDEX_LEAF_BITS) - 1)] - 1;
+		if (i < 0)
+			return -1;
+
+		i = mem->device_slot_to_index[i];
+
+		for (; i<mem->n_mmapped_devices &&
+		    paddr >= mem->devices[i].baseaddr; i++)
+			if (paddr < mem->devices[i].endaddr)
+				return i;
+
+		return -1;
+	}
+
+	start = 0; end = mem->n_mmapped_devices - 1;
+	while (start <= end) {
+		i = (start + end) >> 1;
+		if (paddr < mem->devices[i].baseaddr)
+			end = i - 1;
+		else if (paddr >= mem->devices[i].endaddr)
+			start = i + 1;
+		else
+			return i;
+	}
+
+	return -1;
+}
+
+
 /*
  *  memory_device_register():
  *
@@ -439,8 +994,16 @@ void memory_device_register(struct memory *mem, const char *device_name,
 		abort();
 	}
 
-	mem->devices[newi].dyntrans_write_low = (uint64_t)-1;
-	mem->devices[newi].dyntrans_write_high = 0;
+	mem->devices[newi].dyntrans_dirty = NULL;
+	mem->devices[newi].dyntrans_dirty_any = 0;
+	mem->devices[newi].dirty_wakeup = NULL;
+	if (flags & DM_DYNTRANS_WRITE_OK) {
+		size_t s = memory_device_dirty_size(&mem->devices[newi]);
+		CHECK_ALLOCATION(mem->devices[newi].dyntrans_dirty =
+		    (uint64_t *) malloc(s));
+		memset(mem->devices[newi].dyntrans_dirty, 0, s);
+	}
+
 	mem->devices[newi].f = f;
 	mem->devices[newi].extra = extra;
 
@@ -450,8 +1013,22 @@ void memory_device_register(struct memory *mem, const char *device_name,
 		mem->mmap_dev_maxaddr = (((baseaddr + len) - 1) |
 		    mem->dev_dyntrans_alignment) + 1;
 
-	if (newi < mem->last_accessed_device)
-		mem->last_accessed_device ++;
+	/*  Find a free index slot:  */
+	for (i=0; i<mem->n_device_slots; i++)
+		if (mem->device_slot_to_index[i] < 0)
+			break;
+	if (i == mem->n_device_slots) {
+		mem->n_device_slots ++;
+		CHECK_ALLOCATION(mem->device_slot_to_index = (int *) realloc(
+		    mem->device_slot_to_index, sizeof(int) *
+		    mem->n_device_slots));
+	}
+	mem->devices[newi].index_slot = i;
+
+	memory_device_renumber(mem, newi);
+
+	if ((baseaddr >> DEVICE_INDEX_MAX_BITS) == 0)
+		memory_device_index_update(mem, newi, 1);
 }
 
 
@@ -467,18 +1044,19 @@ void memory_device_remove(struct memory *mem, int i)
 		exit(1);
 	}
 
-	mem->n_mmapped_devices --;
+	if ((mem->devices[i].baseaddr >> DEVICE_INDEX_MAX_BITS) == 0)
+		memory_device_index_update(mem, i, 0);
 
-	if (i == mem->n_mmapped_devices)
-		return;
+	mem->device_slot_to_index[mem->devices[i].index_slot] = -1;
+	free(mem->devices[i].dyntrans_dirty);
 
-	memmove(&mem->devices[i], &mem->devices[i+1],
-	    sizeof(struct memory_device) * (mem->n_mmapped_devices - i));
+	mem->n_mmapped_devices --;
+
+	if (i != mem->n_mmapped_devices)
+		memmove(&mem->devices[i], &mem->devices[i+1],
+		    sizeof(struct memory_device) * (mem->n_mmapped_devices - i));
 
-	if (i <= mem->last_accessed_device)
-		mem->last_accessed_device --;
-	if (mem->last_accessed_device < 0)
-		mem->last_accessed_device = 0;
+	memory_device_renumber(mem, i);
 }
 
 
@@ -501,6 +1079,10 @@ unsigned char *memory_paddr_to_hostaddr(struct memory *mem,
 	const int shrcount = MAX_BITS - BITS_PER_PAGETABLE;
 	unsigned char *hostptr;
 
+	/*  Contiguous RAM doesn't need a table lookup:  */
+	if (paddr < mem->contiguous_ram_len)
+		return mem->contiguous_ram + paddr;
+
 	table = (void **) mem->pagetable;
 	entry = (paddr >> shrcount) & mask;
 
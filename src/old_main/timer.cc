@@ -26,24 +26,33 @@
  *
  *
  *  Timer framework. This is used by emulated clocks.
+ *
+ *  Each machine has its own queue of timers, kept as a binary min-heap
+ *  ordered by the (emulated) time of each timer's next tick. The queue is
+ *  serviced synchronously from machine_run(), so timer callbacks are never
+ *  called asynchronously, and adding, removing, or firing a timer is
+ *  O(log n) in the number of timers.
+ *
+ *  Emulated time is derived from the number of instructions executed by the
+ *  machine's first cpu, so timer interrupts occur at exactly the same point
+ *  in every run. With the -w command line option (timer_init(1)), emulated
+ *  time instead follows the host's wall clock, so that e.g. a 100 Hz timer
+ *  ticks 100 times per real second.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <signal.h>
 #include <string.h>
-#include <unistd.h>
 #include <sys/time.h>
 
+#include "machine.h"
 #include "misc.h"
 #include "timer.h"
 
 
-/*  #define TEST  */
-
-
 struct timer {
-	struct timer	*next;
+	struct timer_queue *queue;
+	int		heap_index;
 
 	double		freq;
 	void		(*timer_tick)(struct timer *timer, void *extra);
@@ -53,28 +62,143 @@ struct timer {
 	double		next_tick_at;
 };
 
-static struct timer *first_timer = NULL;
-struct timeval timer_start_tv;
-static double timer_freq;
-static int timer_countdown_to_next_gettimeofday;
-static double timer_current_time;
-static double timer_current_time_step;
+struct timer_queue {
+	/*  Min-heap of timers, ordered by next_tick_at:  */
+	struct timer	**heap;
+	int		n_timers;
+	int		n_allocated;
 
+	/*  Emulated time, in seconds since the emulation started:  */
+	double		current_time;
+};
+
+static int timer_sync_to_host_clock;
 static int timer_is_running;
 
-#define	SECONDS_BETWEEN_GETTIMEOFDAY_SYNCH	1.65
+/*  Host time run so far, not counting time spent with timers stopped:  */
+static struct timeval timer_start_tv;
+static double timer_elapsed_before_start;
+
+
+/*
+ *  timer_host_time():
+ *
+ *  Returns the number of seconds (of host time) that the timers have been
+ *  running.
+ */
+static double timer_host_time(void)
+{
+	struct timeval tv;
+
+	if (!timer_is_running)
+		return timer_elapsed_before_start;
+
+	gettimeofday(&tv, NULL);
+	tv.tv_sec -= timer_start_tv.tv_sec;
+	tv.tv_usec -= timer_start_tv.tv_usec;
+	if (tv.tv_usec < 0) {
+		tv.tv_usec += 1000000;
+		tv.tv_sec --;
+	}
+
+	return timer_elapsed_before_start + tv.tv_sec + tv.tv_usec * 0.000001;
+}
+
+
+/*
+ *  timer_heap_swap(), timer_heap_up(), timer_heap_down():
+ *
+ *  Helper functions for keeping the heap of a timer queue ordered.
+ */
+static void timer_heap_swap(struct timer_queue *q, int a, int b)
+{
+	struct timer *tmp = q->heap[a];
+
+	q->heap[a] = q->heap[b];
+	q->heap[b] = tmp;
+	q->heap[a]->heap_index = a;
+	q->heap[b]->heap_index = b;
+}
+
+static void timer_heap_up(struct timer_queue *q, int i)
+{
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (q->heap[parent]->next_tick_at <= q->heap[i]->next_tick_at)
+			break;
+		timer_heap_swap(q, i, parent);
+		i = parent;
+	}
+}
+
+static void timer_heap_down(struct timer_queue *q, int i)
+{
+	for (;;) {
+		int smallest = i, left = 2*i + 1, right = 2*i + 2;
+
+		if (left < q->n_timers && q->heap[left]->next_tick_at <
+		    q->heap[smallest]->next_tick_at)
+			smallest = left;
+		if (right < q->n_timers && q->heap[right]->next_tick_at <
+		    q->heap[smallest]->next_tick_at)
+			smallest = right;
+		if (smallest == i)
+			break;
+
+		timer_heap_swap(q, i, smallest);
+		i = smallest;
+	}
+}
+
+
+/*
+ *  timer_queue_new():
+ *
+ *  Creates an empty timer queue. (Every machine has one.)
+ */
+struct timer_queue *timer_queue_new(void)
+{
+	struct timer_queue *q;
+
+	CHECK_ALLOCATION(q = (struct timer_queue *)
+	    malloc(sizeof(struct timer_queue)));
+	memset(q, 0, sizeof(struct timer_queue));
+
+	return q;
+}
+
+
+/*
+ *  timer_queue_destroy():
+ *
+ *  Frees a timer queue, and all timers in it.
+ */
+void timer_queue_destroy(struct timer_queue *q)
+{
+	int i;
+
+	if (q == NULL)
+		return;
+
+	for (i=0; i<q->n_timers; i++)
+		free(q->heap[i]);
+
+	free(q->heap);
+	free(q);
+}
 
 
 /*
  *  timer_add():
  *
- *  Adds a virtual timer to the list of timers.
+ *  Adds a virtual timer to a machine's timer queue.
  *
  *  Return value is a pointer to a timer struct.
  */
-struct timer *timer_add(double freq, void (*timer_tick)(struct timer *timer,
-	void *extra), void *extra)
+struct timer *timer_add(struct machine *machine, double freq,
+	void (*timer_tick)(struct timer *timer, void *extra), void *extra)
 {
+	struct timer_queue *q = machine->timer_queue;
 	struct timer *newtimer;
 
 	CHECK_ALLOCATION(newtimer = (struct timer *) malloc(sizeof(struct timer)));
@@ -82,15 +206,26 @@ struct timer *timer_add(double freq, void (*timer_tick)(struct timer *timer,
 	if (freq <= 0.00000001)
 		freq = 0.00000001;
 
+	if (timer_sync_to_host_clock)
+		q->current_time = timer_host_time();
+
+	newtimer->queue = q;
 	newtimer->freq = freq;
 	newtimer->timer_tick = timer_tick;
 	newtimer->extra = extra;
 
 	newtimer->interval = 1.0 / freq;
-	newtimer->next_tick_at = timer_current_time + newtimer->interval;
+	newtimer->next_tick_at = q->current_time + newtimer->interval;
 
-	newtimer->next = first_timer;
-	first_timer = newtimer;
+	if (q->n_timers >= q->n_allocated) {
+		q->n_allocated = q->n_allocated == 0? 8 : q->n_allocated * 2;
+		CHECK_ALLOCATION(q->heap = (struct timer **) realloc(q->heap,
+		    sizeof(struct timer *) * q->n_allocated));
+	}
+
+	newtimer->heap_index = q->n_timers;
+	q->heap[q->n_timers ++] = newtimer;
+	timer_heap_up(q, newtimer->heap_index);
 
 	return newtimer;
 }
@@ -99,28 +234,27 @@ struct timer *timer_add(double freq, void (*timer_tick)(struct timer *timer,
 /*
  *  timer_remove():
  *
- *  Removes a virtual timer from the list of timers.
+ *  Removes a virtual timer from its timer queue.
  */
 void timer_remove(struct timer *t)
 {
-	struct timer *prev = NULL, *cur = first_timer;
-
-	while (cur != NULL && cur != t) {
-		prev = cur;
-		cur = cur->next;
-	}
+	struct timer_queue *q = t->queue;
+	int i = t->heap_index;
 
-	if (cur == t) {
-		if (prev == NULL)
-			first_timer = cur->next;
-		else
-			prev->next = cur->next;
-		free(cur);
-	} else {
+	if (i < 0 || i >= q->n_timers || q->heap[i] != t) {
 		fprintf(stderr, "attempt to remove timer %p which "
 		    "doesn't exist. aborting\n", t);
 		exit(1);
 	}
+
+	q->n_timers --;
+	if (i != q->n_timers) {
+		timer_heap_swap(q, i, q->n_timers);
+		timer_heap_up(q, i);
+		timer_heap_down(q, i);
+	}
+
+	free(t);
 }
 
 
@@ -131,6 +265,8 @@ void timer_remove(struct timer *t)
  */
 void timer_update_frequency(struct timer *t, double new_freq)
 {
+	struct timer_queue *q = t->queue;
+
 	if (t->freq == new_freq)
 		return;
 
@@ -139,163 +275,121 @@ void timer_update_frequency(struct timer *t, double new_freq)
 	if (new_freq <= 0.00000001)
 		new_freq = 0.00000001;
 
+	if (timer_sync_to_host_clock)
+		q->current_time = timer_host_time();
+
 	t->interval = 1.0 / new_freq;
-	t->next_tick_at = timer_current_time + t->interval;
+	t->next_tick_at = q->current_time + t->interval;
+
+	timer_heap_up(q, t->heap_index);
+	timer_heap_down(q, t->heap_index);
 }
 
 
 /*
- *  timer_tick():
+ *  timer_run():
  *
- *  Timer tick handler. This is where the interesting stuff happens.
+ *  Advances a machine's emulated time, and calls the tick functions of all
+ *  timers that have become due. Called from machine_run(), with the number
+ *  of instructions that the machine's first cpu has just executed.
  */
-static void timer_tick(int signal_nr)
+void timer_run(struct machine *machine, int ninstrs)
 {
-	struct timer *timer = first_timer;
-	struct timeval tv;
+	struct timer_queue *q = machine->timer_queue;
+
+	if (timer_sync_to_host_clock) {
+		/*  Only bother asking the host when there is a timer:  */
+		if (q->n_timers == 0)
+			return;
 
-	timer_current_time += timer_current_time_step;
-
-	if ((--timer_countdown_to_next_gettimeofday) < 0) {
-		gettimeofday(&tv, NULL);
-		tv.tv_sec -= timer_start_tv.tv_sec;
-		tv.tv_usec -= timer_start_tv.tv_usec;
-		if (tv.tv_usec < 0) {
-			tv.tv_usec += 1000000;
-			tv.tv_sec --;
-		}
-
-#ifdef TIMER_DEBUG
-		/*  For debugging/testing:  */
-		{
-			double diff = tv.tv_usec * 0.000001 + tv.tv_sec
-			    - timer_current_time;
-			printf("timer: lagging behind %f seconds\n", diff);
-		}
-#endif
-
-		/*  Get exponentially closer to the real time, instead of
-		    just changing to it directly:  */
-		timer_current_time = ( (tv.tv_usec * 0.000001 + tv.tv_sec) +
-		    timer_current_time ) / 2;
-
-		timer_countdown_to_next_gettimeofday = (int64_t) (timer_freq *
-		    SECONDS_BETWEEN_GETTIMEOFDAY_SYNCH);
+		q->current_time = timer_host_time();
+	} else {
+		double hz = machine->emulated_hz > 0?
+		    machine->emulated_hz : TIMER_DEFAULT_EMULATED_HZ;
+
+		q->current_time += ninstrs / hz;
 	}
 
-	while (timer != NULL) {
-		while (timer_current_time >= timer->next_tick_at) {
-			timer->timer_tick(timer, timer->extra);
-			timer->next_tick_at += timer->interval;
-		}
+	while (q->n_timers > 0 &&
+	    q->heap[0]->next_tick_at <= q->current_time) {
+		struct timer *t = q->heap[0];
+
+		/*  Reschedule before the tick, since the tick function may
+		    remove or change the timer:  */
+		t->next_tick_at += t->interval;
+		timer_heap_down(q, 0);
 
-		timer = timer->next;
+		t->timer_tick(t, t->extra);
 	}
+}
+
 
-#ifdef TEST
-	printf("T"); fflush(stdout);
-#endif
+/*
+ *  timer_cycles_until_next():
+ *
+ *  Returns the number of cycles (cpu0 instructions) until the next timer of
+ *  a machine is due, or -1 if the machine has no timers.
+ */
+int64_t timer_cycles_until_next(struct machine *machine)
+{
+	struct timer_queue *q = machine->timer_queue;
+	double hz = machine->emulated_hz > 0?
+	    machine->emulated_hz : TIMER_DEFAULT_EMULATED_HZ;
+	double seconds;
+
+	if (q->n_timers == 0)
+		return -1;
+
+	seconds = q->heap[0]->next_tick_at - q->current_time;
+	if (seconds <= 0.0)
+		return 0;
+
+	return (int64_t) (seconds * hz) + 1;
 }
 
 
 /*
  *  timer_start():
  *
- *  Set the interval timer to timer_freq Hz, and install the signal handler.
+ *  Let emulated time follow the host's clock again, after timer_stop().
  */
 void timer_start(void)
 {
-	struct timer *timer = first_timer;
-	struct itimerval val;
-	struct sigaction saction;
-
 	if (timer_is_running)
 		return;
 
-	timer_is_running = 1;
-
 	gettimeofday(&timer_start_tv, NULL);
-	timer_current_time = 0.0;
-
-	/*  Reset all timers:  */
-	while (timer != NULL) {
-		timer->next_tick_at = timer->interval;
-		timer = timer->next;
-	}
-	val.it_interval.tv_sec = 0;
-	val.it_interval.tv_usec = (int) (1000000.0 / timer_freq);
-	val.it_value.tv_sec = 0;
-	val.it_value.tv_usec = (int) (1000000.0 / timer_freq);
-
-	memset(&saction, 0, sizeof(saction));
-	saction.sa_handler = timer_tick;
-	saction.sa_flags = SA_RESTART;
-
-	sigaction(SIGALRM, &saction, NULL);
-
-	setitimer(ITIMER_REAL, &val, NULL);
+	timer_is_running = 1;
 }
 
 
 /*
  *  timer_stop():
  *
- *  Deinstall the signal handler, and disable the interval timer.
+ *  Stop emulated time from following the host's clock, e.g. while the user
+ *  is interacting with the debugger.
  */
 void timer_stop(void)
 {
-	struct itimerval val;
-	struct sigaction saction;
-
 	if (!timer_is_running)
 		return;
 
+	timer_elapsed_before_start = timer_host_time();
 	timer_is_running = 0;
-
-	val.it_interval.tv_sec = 0;
-	val.it_interval.tv_usec = 0;
-	val.it_value.tv_sec = 0;
-	val.it_value.tv_usec = 0;
-
-	setitimer(ITIMER_REAL, &val, NULL);
-
-	memset(&saction, 0, sizeof(saction));
-	saction.sa_handler = NULL;
-
-	sigaction(SIGALRM, &saction, NULL);
-}
-
-
-#ifdef TEST
-static void timer_tick_test(struct timer *t, void *extra)
-{
-	printf((char *) extra); fflush(stdout);
 }
-#endif
 
 
 /*
  *  timer_init():
  *
- *  Initialize the timer framework.
+ *  Initialize the timer framework. If sync_to_host_clock is non-zero,
+ *  emulated time follows the host's wall clock instead of the number of
+ *  executed instructions.
  */
-void timer_init(void)
+void timer_init(int sync_to_host_clock)
 {
-	first_timer = NULL;
-	timer_current_time = 0.0;
+	timer_sync_to_host_clock = sync_to_host_clock;
 	timer_is_running = 0;
-	timer_countdown_to_next_gettimeofday = 0;
-
-	timer_freq = TIMER_BASE_FREQUENCY;
-	timer_current_time_step = 1.0 / timer_freq;
-
-#ifdef TEST
-	timer_add(0.5, timer_tick_test, "X");
-	timer_add(10.0, timer_tick_test, ".");
-	timer_add(200.0, timer_tick_test, " ");
-	timer_start();
-	while (1)
-		sleep(999999);
-#endif
+	timer_elapsed_before_start = 0.0;
 }
 
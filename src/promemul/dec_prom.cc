@@ -96,8 +96,7 @@ static unsigned char mem_readchar(struct cpu *cpu, int regbase, int offset)
 int dec_jumptable_func(struct cpu *cpu, int vector)
 {
 	int i;
-	static int file_opened = 0;
-	static int current_file_offset = 0;
+	struct machine_pmax *md = cpu->machine->md.pmax;
 
 	switch (vector) {
 	case 0x0:	/*  reset()  */
@@ -121,12 +120,12 @@ int dec_jumptable_func(struct cpu *cpu, int vector)
 		 *  code to load /vmsprite. The filename argument (in A0)
 		 *  is ignored, and a file handle value of 1 is returned.
 		 */
-		if (file_opened) {
+		if (md->prom_file_opened) {
 			fatal("\ndec_jumptable_func(): opening more than one "
 			    "file isn't supported yet.\n");
 			cpu->running = 0;
 		}
-		file_opened = 1;
+		md->prom_file_opened = 1;
 		cpu->cd.mips.gpr[MIPS_GPR_V0] = 1;
 		break;
 	case 0x38:	/*  read(handle, ptr, length)  */
@@ -140,7 +139,7 @@ int dec_jumptable_func(struct cpu *cpu, int vector)
 			    malloc(cpu->cd.mips.gpr[MIPS_GPR_A2]));
 
 			res = diskimage_access(cpu->machine, disk_id,
-			    DISKIMAGE_SCSI, 0, current_file_offset, tmp_buf,
+			    DISKIMAGE_SCSI, 0, md->prom_file_offset, tmp_buf,
 			    cpu->cd.mips.gpr[MIPS_GPR_A2]);
 
 			/*  If the transfer was successful, transfer the data
@@ -151,7 +150,7 @@ int dec_jumptable_func(struct cpu *cpu, int vector)
 				    cpu->cd.mips.gpr[MIPS_GPR_A2]);
 				cpu->cd.mips.gpr[MIPS_GPR_V0] =
 				    cpu->cd.mips.gpr[MIPS_GPR_A2];
-				current_file_offset +=
+				md->prom_file_offset +=
 				    cpu->cd.mips.gpr[MIPS_GPR_A2];
 			}
 
@@ -161,7 +160,7 @@ int dec_jumptable_func(struct cpu *cpu, int vector)
 	case 0x58:	/*  lseek(handle, offset[, whence])  */
 		/*  TODO  */
 		if (cpu->cd.mips.gpr[MIPS_GPR_A2] == 0)
-			current_file_offset = cpu->cd.mips.gpr[MIPS_GPR_A1];
+			md->prom_file_offset = cpu->cd.mips.gpr[MIPS_GPR_A1];
 		else
 			fatal("WARNING! Unimplemented whence in "
 			    "dec_jumptable_func()\n");
@@ -176,8 +176,6 @@ int playstation2_sifbios_emul(struct cpu *cpu)
 
 		{
 			uint32_t tmpaddr;
-			static uint32_t return_addr = 0x1000;
-				/*  0xbc000000;  */
 			uint32_t size;
 
 			tmpaddr = load_32bit_word(cpu,
@@ -208,12 +206,13 @@ int playstation2_sifbios_emul(struct cpu *cpu)
 
 			/*  Result:  */
 			store_32bit_word(cpu,
-			    cpu->cd.mips.gpr[MIPS_GPR_A1] + 0, return_addr);
+			    cpu->cd.mips.gpr[MIPS_GPR_A1] + 0,
+			    cpu->machine->ps2_iop_heap_addr);
 
-			return_addr += size;
+			cpu->machine->ps2_iop_heap_addr += size;
 			/*  Round up to next page:  */
-			return_addr += 4095;
-			return_addr &= ~4095;
+			cpu->machine->ps2_iop_heap_addr += 4095;
+			cpu->machine->ps2_iop_heap_addr &= ~4095;
 		}
 		cpu->cd.mips.gpr[MIPS_GPR_V0] = 0;
 		break;
@@ -0,0 +1,151 @@
+#!/bin/sh
+#
+#  Micro-benchmarks of the dyntrans CPU cores.
+#
+#  1. Build the bare-metal benchmark kernels in demos/bench/ for the CPU
+#     families you have cross-compilers for (see demos/bench/README).
+#
+#  2. Run the benchmarks with:
+#
+#	make bench		(or test/bench.sh directly)
+#
+#  Each demos/bench/bench_ARCH_KERNEL binary is run on the test machine for
+#  that architecture, with -N. The checksum it prints is compared against
+#  test/bench.reference, and the average number of instructions per second
+#  against test/bench.baseline. The first run (or a run with -u) stores the
+#  results as the new baseline. A kernel which runs more than
+#  BENCH_TOLERANCE percent (default 10) slower than its baseline, or which
+#  prints the wrong checksum, is reported as a failure. It is also an error
+#  if no kernels were found at all.
+#
+#  Extra emulator options can be given in BENCH_FLAGS, e.g. BENCH_FLAGS=-G
+#  to compare native code translation against a baseline made without it.
+#
+#  The reference checksums do not depend on the emulated architecture. They
+#  are regenerated with -r, by running the kernels natively on the host (as
+#  needed e.g. after building the kernels with a different BENCH_N; use
+#  BENCH_CFLAGS=-DBENCH_N=... in that case). The baseline depends on the
+#  host, so it is not part of the source tree.
+#
+
+GXEMUL=${GXEMUL:-./gxemul}
+BENCH_DIR=${BENCH_DIR:-demos/bench}
+BASELINE=${BENCH_BASELINE:-test/bench.baseline}
+REFERENCE=${BENCH_REFERENCE:-test/bench.reference}
+TOLERANCE=${BENCH_TOLERANCE:-10}
+KERNELS="alu loadstore branch pages mmio devices codedata"
+
+UPDATE=0
+if [ z$1 = z-u ]; then
+	UPDATE=1
+fi
+
+if [ z$1 = z-r ]; then
+	${CC:-cc} -O2 -DBENCH_HOST $BENCH_CFLAGS $BENCH_DIR/bench.c \
+	    -o tmp_bench_host || exit 1
+	./tmp_bench_host > $REFERENCE || exit 1
+	rm -f tmp_bench_host
+	echo "Reference checksums saved to $REFERENCE."
+	exit 0
+fi
+
+if [ ! -f $BASELINE ]; then
+	UPDATE=1
+fi
+
+machine_args()
+{
+	case $1 in
+	alpha)	echo "-E testalpha" ;;
+	arm)	echo "-E testarm" ;;
+	m88k)	echo "-E oldtestm88k" ;;
+	mips)	echo "-E testmips" ;;
+	ppc)	echo "-E testppc -C PPC750" ;;
+	sh)	echo "-E testsh" ;;
+	esac
+}
+
+rm -f tmp_bench.out tmp_bench_new.baseline
+
+ANYERRORS=0
+NRUN=0
+
+printf "%-6s %-10s %14s %14s  %-8s  %s\n" arch kernel "instrs/sec" \
+    "baseline" checksum result
+
+for arch in alpha arm m88k mips ppc sh; do
+	for kernel in $KERNELS; do
+		binary=$BENCH_DIR/bench_${arch}_$kernel
+		if [ ! -f $binary ]; then
+			continue
+		fi
+
+		#  (stdin is /dev/zero, not /dev/null, since end-of-file on
+		#  the console input makes the emulator wait forever.)
+		$GXEMUL -q -N $BENCH_FLAGS `machine_args $arch` $binary \
+		    < /dev/zero > tmp_bench.out 2>&1
+
+		ips=`grep "avg=" tmp_bench.out | tail -n 1 | \
+		    sed 's/.*avg=\([0-9]*\).*/\1/'`
+		checksum=`grep "checksum=" tmp_bench.out | tail -n 1 | \
+		    sed 's/.*checksum=\([0-9a-f]*\).*/\1/'`
+		if [ z$ips = z ]; then
+			ips=0
+		fi
+		if [ z$checksum = z ]; then
+			checksum=none
+		fi
+
+		echo "$arch $kernel $ips $checksum" >> tmp_bench_new.baseline
+		NRUN=`expr $NRUN + 1`
+
+		ref_checksum=`grep "^$kernel " $REFERENCE | cut -d " " -f 2`
+		old=`grep "^$arch $kernel " $BASELINE 2> /dev/null`
+		old_ips=`echo $old | cut -d " " -f 3`
+
+		result=ok
+		if [ z$ips = z0 ]; then
+			result="FAIL: did not run to completion"
+			ANYERRORS=1
+		elif [ z$checksum != z$ref_checksum ]; then
+			result="FAIL: checksum should be $ref_checksum"
+			ANYERRORS=1
+		elif [ z$UPDATE = z1 ]; then
+			result=saved
+		elif [ "z$old" = z ]; then
+			result="no baseline"
+		elif [ `expr $ips \* 100` -lt \
+		    `expr $old_ips \* \( 100 - $TOLERANCE \)` ]; then
+			result="FAIL: `expr \( $old_ips - $ips \) \* 100 / \
+			    $old_ips`% slower"
+			ANYERRORS=1
+		elif [ `expr $ips \* 100` -gt \
+		    `expr $old_ips \* \( 100 + $TOLERANCE \)` ]; then
+			result="ok, `expr \( $ips - $old_ips \) \* 100 / \
+			    $old_ips`% faster"
+		fi
+
+		printf "%-6s %-10s %14s %14s  %-8s  %s\n" $arch $kernel $ips \
+		    "${old_ips:--}" $checksum "$result"
+	done
+done
+
+rm -f tmp_bench.out
+
+if [ z$NRUN = z0 ]; then
+	echo "FAIL: No benchmark kernels found in $BENCH_DIR;" \
+	    "see $BENCH_DIR/README." >&2
+	rm -f tmp_bench_new.baseline
+	exit 1
+fi
+
+if [ z$UPDATE = z1 ]; then
+	mv tmp_bench_new.baseline $BASELINE
+	echo "Baseline saved to $BASELINE."
+else
+	rm -f tmp_bench_new.baseline
+fi
+
+if [ z$ANYERRORS = z1 ]; then
+	false
+fi
@@ -0,0 +1,125 @@
+#!/bin/sh
+#
+#  Regression tests for guest code which writes to its own code page.
+#
+#  Each test is a small raw binary, generated below, which is run on a test
+#  machine. It prints Y if the result is correct, and N otherwise.
+#
+#    sh_literal	SH code which increments a 32-bit literal in its own
+#		literal pool, 0x1f8 bytes after the MOV.L @(disp,PC) which
+#		loads it. The translator folds such loads into immediate
+#		moves, so the write must invalidate the whole page, not
+#		only the part of the page around the literal.
+#
+#    mips_patch	MIPS code which overwrites an addiu two instructions
+#		after the store, in the same run of straight-line code.
+#		(Also run with -G and -J.)
+#
+
+GXEMUL=${GXEMUL:-./gxemul}
+TMPBIN=tmp_code_writes.bin
+
+ANYERRORS=0
+
+#  emit16le word ...  and  emit32le/emit32be word ...
+emit16le()
+{
+	for w in "$@"; do
+		printf "\\$(printf %o $((w & 255)))"
+		printf "\\$(printf %o $(((w >> 8) & 255)))"
+	done
+}
+
+emit32le()
+{
+	for w in "$@"; do
+		emit16le $((w & 65535)) $(((w >> 16) & 65535))
+	done
+}
+
+emit32be()
+{
+	for w in "$@"; do
+		printf "\\$(printf %o $(((w >> 24) & 255)))"
+		printf "\\$(printf %o $(((w >> 16) & 255)))"
+		printf "\\$(printf %o $(((w >> 8) & 255)))"
+		printf "\\$(printf %o $((w & 255)))"
+	done
+}
+
+#  run name args...
+run()
+{
+	name=$1
+	shift
+
+	#  (stdin is /dev/zero, not /dev/null, since end-of-file on the
+	#  console input makes the emulator wait forever.)
+	result=`$GXEMUL -q "$@" < /dev/zero 2>&1 | tail -n 1`
+	if [ "z$result" = zY ]; then
+		echo "$name: ok"
+	else
+		echo "$name: FAIL ($result)"
+		ANYERRORS=1
+	fi
+}
+
+
+#  SH (little-endian), loaded at 0x80010000:
+{
+	emit16le 0xd10b	0xe503	0xe000	0xd30b	# mov.l cons,r1; mov #3,r5
+						# mov #0,r0; mov.l litaddr,r3
+	emit16le 0xd27d	0x302c			# 1: mov.l lit,r2; add r2,r0
+	emit16le 0x6432	0x7401	0x2342		# lit = lit + 1
+	emit16le 0x4510	0x8bf8			# dt r5; bf 1b
+	emit16le 0xd608	0x3060			# mov.l expected,r6; cmp/eq
+	emit16le 0xe74e	0x8b00	0xe759		# r7 = equal? 'Y' : 'N'
+	emit16le 0x2170	0xe70a	0x2170		# print r7, newline
+	emit16le 0xe000	0x7110	0x2100		# halt
+	emit16le 0xaffe	0x0009			# 2: bra 2b; nop
+	emit32le 0xb0000000			# cons
+	emit32le 0x80010200			# litaddr
+	emit32le 0x00000033			# expected (0x10 + 0x11 + 0x12)
+	i=0
+	while [ $i -lt 113 ]; do
+		emit32le 0
+		i=`expr $i + 1`
+	done
+	emit32le 0x00000010			# lit, at 0x80010200
+} > $TMPBIN
+
+run sh_literal -E testsh 0x80010000:0:0x80010000:$TMPBIN
+
+
+#  MIPS (big-endian), loaded at 0x80010000:
+{
+	emit32be 0x3c10b000			# lui s0,0xb000
+	emit32be 0x3c088001 0x3508002c		# la t0,patch
+	emit32be 0x3c0a8001 0x354a006c		# la t2,newinsn
+	emit32be 0x8d490000			# lw t1,0(t2)
+	emit32be 0x00001021 0x240b0003		# move v0,zero; li t3,3
+	emit32be 0x24420001 0x24420001		# 1: addiu v0,v0,1 (twice)
+	emit32be 0xad090000			# sw t1,0(t0)
+	emit32be 0x24420002			# patch: addiu v0,v0,2
+	emit32be 0x24420001 0x256bffff		# addiu v0,v0,1; t3 --
+	emit32be 0x1560fff9 0x00000000		# bnez t3,1b; nop
+	emit32be 0x240c0135			# li t4,0x135 (3 * 103)
+	emit32be 0x240d004e			# t5 = v0 == t4? 'Y' : 'N'
+	emit32be 0x144c0002 0x00000000 0x240d0059
+	emit32be 0xa20d0000			# print t5, newline
+	emit32be 0x240d000a 0xa20d0000
+	emit32be 0xa2000010			# halt
+	emit32be 0x1000ffff 0x00000000		# 2: b 2b; nop
+	emit32be 0x24420064			# newinsn: addiu v0,v0,100
+} > $TMPBIN
+
+run mips_patch -E testmips 0x80010000:0:0x80010000:$TMPBIN
+run mips_patch_G -G -E testmips 0x80010000:0:0x80010000:$TMPBIN
+run mips_patch_J -J -E testmips 0x80010000:0:0x80010000:$TMPBIN
+
+
+rm -f $TMPBIN
+
+if [ z$ANYERRORS = z1 ]; then
+	false
+fi